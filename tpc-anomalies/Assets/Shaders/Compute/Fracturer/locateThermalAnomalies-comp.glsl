@@ -5,7 +5,8 @@
 
 layout(local_size_variable) in;
 
-#define MIN 0
+#define NONE 0
+#define MIN 1
 #define MAX 2
 
 layout(std430, binding = 0) buffer GridBuffer		{ uint16_t		grid[]; };
@@ -34,7 +35,7 @@ void main()
 	ivec3 index3 = ivec3(getPosition(index));
 
 	stat[index] = vec2(.0f);
-	peak[index] = 0;
+	peak[index] = NONE;
 
 	if (grid[index] == VOXEL_EMPTY) return;
 
@@ -0,0 +1,639 @@
+#include "stdafx.h"
+#include "BVH.h"
+
+#include "Geometry/3D/Intersections3D.h"
+#include "Utilities/ThreadPool.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define BVH_SSE2
+#include <emmintrin.h>
+#endif
+
+// Initialization of static attributes
+const unsigned BVH::BUILD_BLOCK_SIZE = 1 << 14;
+const unsigned BVH::MAX_DEPTH = 60;
+const unsigned BVH::MAX_LEAF_SIZE = 8;
+const unsigned BVH::NUM_BINS = 16;
+const unsigned BVH::PARALLEL_SUBTREE_SIZE = 1 << 15;
+const unsigned BVH::QUERY_BLOCK_SIZE = 4096;
+const float BVH::TRAVERSAL_COST = 1.0f;
+
+/// [Public methods]
+
+BVH::QueryStats& BVH::QueryStats::operator+=(const QueryStats& stats)
+{
+	_visitedNodes += stats._visitedNodes;
+	_visitedLeaves += stats._visitedLeaves;
+	_triangleTests += stats._triangleTests;
+	_numHits += stats._numHits;
+
+	return *this;
+}
+
+BVH::BVH(const std::vector<Triangle3D>& triangles)
+{
+	ThreadPool* threadPool = ThreadPool::getInstance();
+	const unsigned numTriangles = unsigned(triangles.size());
+	const size_t numBlocks = (numTriangles + BUILD_BLOCK_SIZE - 1) / BUILD_BLOCK_SIZE;
+	std::vector<vec3> minPoint(numTriangles), maxPoint(numTriangles), centroid(numTriangles);
+
+	_triangleIndex.resize(numTriangles);
+	std::iota(_triangleIndex.begin(), _triangleIndex.end(), 0);
+	if (!numTriangles) return;
+
+	threadPool->parallelFor(numBlocks, [&](size_t blockIdx)
+	{
+		for (size_t triangleIdx = blockIdx * BUILD_BLOCK_SIZE; triangleIdx < std::min(size_t(numTriangles), (blockIdx + 1) * BUILD_BLOCK_SIZE); ++triangleIdx)
+		{
+			const Triangle3D& triangle = triangles[triangleIdx];
+
+			minPoint[triangleIdx] = glm::min(triangle.getP1(), glm::min(triangle.getP2(), triangle.getP3()));
+			maxPoint[triangleIdx] = glm::max(triangle.getP1(), glm::max(triangle.getP2(), triangle.getP3()));
+			centroid[triangleIdx] = (minPoint[triangleIdx] + maxPoint[triangleIdx]) * .5f;
+		}
+	});
+
+	// Large nodes are split on this thread with parallel binning, whereas smaller subtrees are built by separate tasks
+	std::vector<BuildTask> deferred;
+	_node.resize(1);
+	this->buildSubtree(BuildTask{ 0, 0, numTriangles, 0 }, minPoint, maxPoint, centroid, _node, &deferred);
+
+	std::vector<std::vector<Node>> subtreeNodes(deferred.size());
+	threadPool->parallelFor(deferred.size(), [&](size_t subtreeIdx)
+	{
+		const BuildTask& task = deferred[subtreeIdx];
+
+		subtreeNodes[subtreeIdx].resize(1);
+		this->buildSubtree(BuildTask{ 0, task._first, task._last, task._depth }, minPoint, maxPoint, centroid, subtreeNodes[subtreeIdx], nullptr);
+	});
+
+	// The root of each subtree replaces its placeholder, and the rest of its nodes are appended with their child indices shifted accordingly
+	for (size_t subtreeIdx = 0; subtreeIdx < deferred.size(); ++subtreeIdx)
+	{
+		const unsigned shift = unsigned(_node.size()) - 1;
+
+		for (size_t nodeIdx = 0; nodeIdx < subtreeNodes[subtreeIdx].size(); ++nodeIdx)
+		{
+			Node node = subtreeNodes[subtreeIdx][nodeIdx];
+			if (!node._count) node._offset += shift;
+
+			if (nodeIdx) _node.push_back(node);
+			else _node[deferred[subtreeIdx]._node] = node;
+		}
+	}
+
+	_vertex.resize(size_t(numTriangles) * 3);
+	threadPool->parallelFor(numBlocks, [&](size_t blockIdx)
+	{
+		for (size_t triangleIdx = blockIdx * BUILD_BLOCK_SIZE; triangleIdx < std::min(size_t(numTriangles), (blockIdx + 1) * BUILD_BLOCK_SIZE); ++triangleIdx)
+		{
+			const Triangle3D& triangle = triangles[_triangleIndex[triangleIdx]];
+
+			_vertex[triangleIdx * 3 + 0] = triangle.getP1();
+			_vertex[triangleIdx * 3 + 1] = triangle.getP2();
+			_vertex[triangleIdx * 3 + 2] = triangle.getP3();
+		}
+	});
+}
+
+BVH::~BVH()
+{
+}
+
+bool BVH::allHits(Ray3D& ray, std::vector<vec3>& points, std::vector<unsigned>& triangles, QueryStats* stats) const
+{
+	QueryStats queryStats;
+	unsigned stack[64], stackSize = 0;
+	std::vector<std::pair<unsigned, vec3>> hits;
+
+	const vec3 origin = ray.getOrigin(), direction = glm::normalize(ray.getDest() - ray.getOrigin()), inverseDirection = 1.0f / direction;
+	const float maxDistance = std::numeric_limits<float>::max();
+	float distance;
+
+	if (!_node.empty() && BVH::intersect(_node[0], origin, inverseDirection, maxDistance, distance)) stack[stackSize++] = 0;
+
+	while (stackSize)
+	{
+		const Node& node = _node[stack[--stackSize]];
+		++queryStats._visitedNodes;
+
+		if (node._count)
+		{
+			++queryStats._visitedLeaves;
+
+			for (unsigned triangleIdx = node._offset; triangleIdx < node._offset + node._count; ++triangleIdx)
+			{
+				Triangle3D triangle(_vertex[triangleIdx * 3 + 0], _vertex[triangleIdx * 3 + 1], _vertex[triangleIdx * 3 + 2]);
+				vec3 point;
+				++queryStats._triangleTests;
+
+				if (Intersections3D::intersect(triangle, ray, point)) hits.emplace_back(_triangleIndex[triangleIdx], point);
+			}
+		}
+		else
+		{
+			for (unsigned childIdx = node._offset; childIdx < node._offset + 2; ++childIdx)
+			{
+				if (BVH::intersect(_node[childIdx], origin, inverseDirection, maxDistance, distance)) stack[stackSize++] = childIdx;
+			}
+		}
+	}
+
+	std::sort(hits.begin(), hits.end(), [](const std::pair<unsigned, vec3>& hit1, const std::pair<unsigned, vec3>& hit2) { return hit1.first < hit2.first; });
+
+	for (const std::pair<unsigned, vec3>& hit : hits)
+	{
+		triangles.push_back(hit.first);
+		points.push_back(hit.second);
+	}
+
+	queryStats._numHits = unsigned(hits.size());
+	if (stats) *stats = queryStats;
+
+	return !hits.empty();
+}
+
+bool BVH::closestHit(Ray3D& ray, vec3& point, unsigned& triangle, QueryStats* stats) const
+{
+	struct StackEntry
+	{
+		unsigned	_node;
+		float		_distance;
+	};
+
+	QueryStats queryStats;
+	StackEntry stack[64];
+	unsigned stackSize = 0;
+
+	const vec3 origin = ray.getOrigin(), direction = glm::normalize(ray.getDest() - ray.getOrigin()), inverseDirection = 1.0f / direction;
+	float closestDistance = std::numeric_limits<float>::max(), distance;
+
+	if (!_node.empty() && BVH::intersect(_node[0], origin, inverseDirection, closestDistance, distance)) stack[stackSize++] = StackEntry{ 0, distance };
+
+	while (stackSize)
+	{
+		const StackEntry entry = stack[--stackSize];
+		if (entry._distance > closestDistance) continue;
+
+		const Node& node = _node[entry._node];
+		++queryStats._visitedNodes;
+
+		if (node._count)
+		{
+			++queryStats._visitedLeaves;
+
+			for (unsigned triangleIdx = node._offset; triangleIdx < node._offset + node._count; ++triangleIdx)
+			{
+				Triangle3D leafTriangle(_vertex[triangleIdx * 3 + 0], _vertex[triangleIdx * 3 + 1], _vertex[triangleIdx * 3 + 2]);
+				vec3 intersection;
+				++queryStats._triangleTests;
+
+				if (!Intersections3D::intersect(leafTriangle, ray, intersection)) continue;
+
+				const float hitDistance = glm::dot(intersection - origin, direction);
+				if (hitDistance < closestDistance)
+				{
+					closestDistance = hitDistance;
+					point = intersection;
+					triangle = _triangleIndex[triangleIdx];
+					queryStats._numHits = 1;
+				}
+			}
+		}
+		else
+		{
+			// The nearest child is pushed last, so that it is visited first and tightens the distance used to cull the other one
+			float distance1, distance2;
+			const bool hit1 = BVH::intersect(_node[node._offset], origin, inverseDirection, closestDistance, distance1);
+			const bool hit2 = BVH::intersect(_node[node._offset + 1], origin, inverseDirection, closestDistance, distance2);
+
+			if (hit1 && hit2 && distance2 < distance1)
+			{
+				stack[stackSize++] = StackEntry{ node._offset, distance1 };
+				stack[stackSize++] = StackEntry{ node._offset + 1, distance2 };
+			}
+			else
+			{
+				if (hit2) stack[stackSize++] = StackEntry{ node._offset + 1, distance2 };
+				if (hit1) stack[stackSize++] = StackEntry{ node._offset, distance1 };
+			}
+		}
+	}
+
+	if (stats) *stats = queryStats;
+
+	return queryStats._numHits > 0;
+}
+
+bool BVH::isVisible(const vec3& origin, const vec3& target, QueryStats* stats) const
+{
+	QueryStats queryStats;
+	unsigned stack[64], stackSize = 0;
+
+	const vec3 direction = target - origin, inverseDirection = 1.0f / direction;
+	bool visible = true;
+	float distance;
+
+	// Segments are parameterized in [0, 1], so that their length bounds the slab test
+	if (!_node.empty() && BVH::intersect(_node[0], origin, inverseDirection, 1.0f, distance)) stack[stackSize++] = 0;
+
+	while (stackSize && visible)
+	{
+		const Node& node = _node[stack[--stackSize]];
+		++queryStats._visitedNodes;
+
+		if (node._count)
+		{
+			++queryStats._visitedLeaves;
+
+			for (unsigned triangleIdx = node._offset; triangleIdx < node._offset + node._count && visible; ++triangleIdx)
+			{
+				const vec3& v0 = _vertex[triangleIdx * 3];
+				const float t = BVH::intersectSegment(origin, direction, v0, _vertex[triangleIdx * 3 + 1] - v0, _vertex[triangleIdx * 3 + 2] - v0);
+				++queryStats._triangleTests;
+
+				visible = !(t > .0f && t < 1.0f);
+			}
+		}
+		else
+		{
+			for (unsigned childIdx = node._offset; childIdx < node._offset + 2; ++childIdx)
+			{
+				if (BVH::intersect(_node[childIdx], origin, inverseDirection, 1.0f, distance)) stack[stackSize++] = childIdx;
+			}
+		}
+	}
+
+	queryStats._numHits = !visible;
+	if (stats) *stats = queryStats;
+
+	return visible;
+}
+
+void BVH::isVisible(const std::vector<vec3>& origins, const std::vector<vec3>& targets, std::vector<uint8_t>& visible, QueryStats* stats) const
+{
+	const size_t numRays = targets.size(), numBlocks = (numRays + QUERY_BLOCK_SIZE - 1) / QUERY_BLOCK_SIZE, originStride = origins.size() == 1 ? 0 : 1;
+	std::vector<QueryStats> blockStats(numBlocks);
+
+	visible.resize(numRays);
+
+	ThreadPool::getInstance()->parallelFor(numBlocks, [&](size_t blockIdx)
+	{
+		for (size_t rayIdx = blockIdx * QUERY_BLOCK_SIZE; rayIdx < std::min(numRays, (blockIdx + 1) * QUERY_BLOCK_SIZE); rayIdx += 4)
+		{
+			this->testPacket(&origins[rayIdx * originStride], originStride, &targets[rayIdx], unsigned(std::min(numRays - rayIdx, size_t(4))), &visible[rayIdx], blockStats[blockIdx]);
+		}
+	});
+
+	if (stats)
+	{
+		*stats = QueryStats();
+		for (const QueryStats& partialStats : blockStats) *stats += partialStats;
+	}
+}
+
+size_t BVH::getMemoryFootprint() const
+{
+	return _node.size() * sizeof(Node) + _triangleIndex.size() * sizeof(unsigned) + _vertex.size() * sizeof(vec3);
+}
+
+/// [Protected methods]
+
+void BVH::buildSubtree(const BuildTask& root, const std::vector<vec3>& minPoint, const std::vector<vec3>& maxPoint, const std::vector<vec3>& centroid,
+					   std::vector<Node>& nodes, std::vector<BuildTask>* deferred)
+{
+	struct Bounds
+	{
+		vec3		_minPoint, _maxPoint;						//!< Bounding box of triangles
+		vec3		_minCentroid, _maxCentroid;					//!< Bounding box of their centroids
+	};
+
+	struct Bins
+	{
+		vec3		_minPoint[3][NUM_BINS], _maxPoint[3][NUM_BINS];
+		unsigned	_count[3][NUM_BINS];
+	};
+
+	ThreadPool* threadPool = ThreadPool::getInstance();
+	const float infinity = std::numeric_limits<float>::infinity();
+	const Bounds emptyBounds{ vec3(infinity), vec3(-infinity), vec3(infinity), vec3(-infinity) };
+	std::vector<BuildTask> pending(1, root);
+
+	while (!pending.empty())
+	{
+		const BuildTask task = pending.back();
+		pending.pop_back();
+
+		// Only nodes split before deferring subtrees are large enough to be worth binning in parallel
+		const unsigned numTriangles = task._last - task._first;
+		const bool parallel = deferred && numTriangles > PARALLEL_SUBTREE_SIZE;
+		const unsigned blockSize = parallel ? BUILD_BLOCK_SIZE : std::max(numTriangles, 1u);
+		const size_t numBlocks = (numTriangles + blockSize - 1) / blockSize;
+
+		auto reduceBlocks = [&](const auto& identity, auto map, auto combine)
+		{
+			if (numBlocks <= 1) return numBlocks ? map(0) : identity;
+			return threadPool->parallelReduce(numBlocks, identity, map, combine);
+		};
+
+		const Bounds bounds = reduceBlocks(emptyBounds, [&](size_t blockIdx)
+		{
+			Bounds blockBounds = emptyBounds;
+
+			for (unsigned idx = task._first + unsigned(blockIdx) * blockSize; idx < std::min(task._last, task._first + unsigned(blockIdx + 1) * blockSize); ++idx)
+			{
+				const unsigned triangleIdx = _triangleIndex[idx];
+
+				blockBounds._minPoint = glm::min(blockBounds._minPoint, minPoint[triangleIdx]);
+				blockBounds._maxPoint = glm::max(blockBounds._maxPoint, maxPoint[triangleIdx]);
+				blockBounds._minCentroid = glm::min(blockBounds._minCentroid, centroid[triangleIdx]);
+				blockBounds._maxCentroid = glm::max(blockBounds._maxCentroid, centroid[triangleIdx]);
+			}
+
+			return blockBounds;
+		}, [](Bounds& accumulated, const Bounds& partial)
+		{
+			accumulated._minPoint = glm::min(accumulated._minPoint, partial._minPoint);
+			accumulated._maxPoint = glm::max(accumulated._maxPoint, partial._maxPoint);
+			accumulated._minCentroid = glm::min(accumulated._minCentroid, partial._minCentroid);
+			accumulated._maxCentroid = glm::max(accumulated._maxCentroid, partial._maxCentroid);
+		});
+
+		Node& node = nodes[task._node];
+		node = Node{ bounds._minPoint, task._first, bounds._maxPoint, numTriangles };
+
+		if (numTriangles <= 1 || task._depth >= MAX_DEPTH) continue;
+
+		// Centroids are binned along every axis, and the split with the lowest surface area heuristic is chosen among their boundaries
+		const vec3 centroidExtent = bounds._maxCentroid - bounds._minCentroid;
+		vec3 binScale(.0f);
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (centroidExtent[axis] > .0f) binScale[axis] = std::min(NUM_BINS / centroidExtent[axis], std::numeric_limits<float>::max());
+		}
+
+		auto getBin = [&](const vec3& point, int axis)
+		{
+			return unsigned(std::min((point[axis] - bounds._minCentroid[axis]) * binScale[axis], float(NUM_BINS - 1)));
+		};
+
+		Bins emptyBins;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			std::fill(emptyBins._minPoint[axis], emptyBins._minPoint[axis] + NUM_BINS, vec3(infinity));
+			std::fill(emptyBins._maxPoint[axis], emptyBins._maxPoint[axis] + NUM_BINS, vec3(-infinity));
+			std::fill(emptyBins._count[axis], emptyBins._count[axis] + NUM_BINS, 0);
+		}
+
+		const Bins bins = reduceBlocks(emptyBins, [&](size_t blockIdx)
+		{
+			Bins blockBins = emptyBins;
+
+			for (unsigned idx = task._first + unsigned(blockIdx) * blockSize; idx < std::min(task._last, task._first + unsigned(blockIdx + 1) * blockSize); ++idx)
+			{
+				const unsigned triangleIdx = _triangleIndex[idx];
+
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					const unsigned binIdx = getBin(centroid[triangleIdx], axis);
+
+					blockBins._minPoint[axis][binIdx] = glm::min(blockBins._minPoint[axis][binIdx], minPoint[triangleIdx]);
+					blockBins._maxPoint[axis][binIdx] = glm::max(blockBins._maxPoint[axis][binIdx], maxPoint[triangleIdx]);
+					++blockBins._count[axis][binIdx];
+				}
+			}
+
+			return blockBins;
+		}, [](Bins& accumulated, const Bins& partial)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				for (unsigned binIdx = 0; binIdx < NUM_BINS; ++binIdx)
+				{
+					accumulated._minPoint[axis][binIdx] = glm::min(accumulated._minPoint[axis][binIdx], partial._minPoint[axis][binIdx]);
+					accumulated._maxPoint[axis][binIdx] = glm::max(accumulated._maxPoint[axis][binIdx], partial._maxPoint[axis][binIdx]);
+					accumulated._count[axis][binIdx] += partial._count[axis][binIdx];
+				}
+			}
+		});
+
+		float bestCost = infinity;
+		int bestAxis = -1;
+		unsigned bestBin = 0;
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (centroidExtent[axis] <= .0f) continue;
+
+			// Costs of the right side are swept from the last bin, and then combined with the left side while sweeping from the first one
+			float rightCost[NUM_BINS];
+			vec3 sideMin(infinity), sideMax(-infinity);
+			unsigned sideCount = 0;
+
+			for (unsigned binIdx = NUM_BINS - 1; binIdx > 0; --binIdx)
+			{
+				sideMin = glm::min(sideMin, bins._minPoint[axis][binIdx]);
+				sideMax = glm::max(sideMax, bins._maxPoint[axis][binIdx]);
+				sideCount += bins._count[axis][binIdx];
+				rightCost[binIdx] = sideCount ? BVH::getHalfArea(sideMin, sideMax) * sideCount : infinity;
+			}
+
+			sideMin = vec3(infinity);
+			sideMax = vec3(-infinity);
+			sideCount = 0;
+
+			for (unsigned binIdx = 0; binIdx < NUM_BINS - 1; ++binIdx)
+			{
+				sideMin = glm::min(sideMin, bins._minPoint[axis][binIdx]);
+				sideMax = glm::max(sideMax, bins._maxPoint[axis][binIdx]);
+				sideCount += bins._count[axis][binIdx];
+
+				const float cost = sideCount ? BVH::getHalfArea(sideMin, sideMax) * sideCount + rightCost[binIdx + 1] : infinity;
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = binIdx;
+				}
+			}
+		}
+
+		const float nodeArea = BVH::getHalfArea(bounds._minPoint, bounds._maxPoint);
+		if (numTriangles <= MAX_LEAF_SIZE && (bestAxis < 0 || nodeArea * numTriangles <= TRAVERSAL_COST * nodeArea + bestCost)) continue;
+
+		// Triangles whose centroids cannot be told apart are split in halves
+		unsigned middle = task._first + numTriangles / 2;
+		if (bestAxis >= 0)
+		{
+			middle = unsigned(std::partition(_triangleIndex.begin() + task._first, _triangleIndex.begin() + task._last, [&](unsigned triangleIdx)
+			{
+				return getBin(centroid[triangleIdx], bestAxis) <= bestBin;
+			}) - _triangleIndex.begin());
+		}
+
+		const unsigned firstChild = unsigned(nodes.size());
+		node._offset = firstChild;
+		node._count = 0;
+		nodes.resize(nodes.size() + 2);
+
+		const BuildTask children[2] = { BuildTask{ firstChild, task._first, middle, task._depth + 1 }, BuildTask{ firstChild + 1, middle, task._last, task._depth + 1 } };
+		for (int childIdx = 1; childIdx >= 0; --childIdx)
+		{
+			if (deferred && children[childIdx]._last - children[childIdx]._first <= PARALLEL_SUBTREE_SIZE) deferred->push_back(children[childIdx]);
+			else pending.push_back(children[childIdx]);
+		}
+	}
+}
+
+float BVH::getHalfArea(const vec3& minPoint, const vec3& maxPoint)
+{
+	const vec3 size = maxPoint - minPoint;
+
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+bool BVH::intersect(const Node& node, const vec3& origin, const vec3& inverseDirection, float maxDistance, float& distance)
+{
+	float entry = .0f, exit = maxDistance;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		// Rays parallel to a slab are only checked against its bounds, since their distances are undefined if the origin lies on the slab
+		if (std::isinf(inverseDirection[axis]))
+		{
+			if (origin[axis] < node._minPoint[axis] || origin[axis] > node._maxPoint[axis]) return false;
+			continue;
+		}
+
+		const float distance1 = (node._minPoint[axis] - origin[axis]) * inverseDirection[axis], distance2 = (node._maxPoint[axis] - origin[axis]) * inverseDirection[axis];
+		entry = std::max(entry, std::min(distance1, distance2));
+		exit = std::min(exit, std::max(distance1, distance2));
+	}
+
+	distance = entry;
+
+	// Rounding may place a grazing hit on a face of the box slightly beyond the exit
+	return entry <= exit * (1.0f + 4.0f * std::numeric_limits<float>::epsilon());
+}
+
+float BVH::intersectSegment(const vec3& origin, const vec3& direction, const vec3& v0, const vec3& edge1, const vec3& edge2)
+{
+	// Moller-Trumbore. A null determinant turns the barycentric coordinates into infinite or undefined values, which fail every comparison
+	const vec3 p = glm::cross(direction, edge2), s = origin - v0, q = glm::cross(s, edge1);
+	const float inverseDeterminant = 1.0f / glm::dot(edge1, p);
+	const float u = glm::dot(s, p) * inverseDeterminant, v = glm::dot(direction, q) * inverseDeterminant;
+
+	if (!(u >= .0f && v >= .0f && u + v <= 1.0f)) return -1.0f;
+
+	return glm::dot(edge2, q) * inverseDeterminant;
+}
+
+void BVH::testPacket(const vec3* origin, size_t originStride, const vec3* target, unsigned numRays, uint8_t* visible, QueryStats& stats) const
+{
+#ifdef BVH_SSE2
+	// Rays are transposed into lanes, and missing lanes repeat the last ray but start inactive
+	alignas(16) float lane[9][4];
+
+	for (unsigned laneIdx = 0; laneIdx < 4; ++laneIdx)
+	{
+		const unsigned rayIdx = std::min(laneIdx, numRays - 1);
+		const vec3 direction = target[rayIdx] - origin[rayIdx * originStride];
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			// Null components are replaced by the smallest normal value with the same sign, so that slab distances are huge rather than undefined
+			const float component = std::abs(direction[axis]) >= std::numeric_limits<float>::min() ? direction[axis] : std::copysign(std::numeric_limits<float>::min(), direction[axis]);
+
+			lane[axis][laneIdx] = origin[rayIdx * originStride][axis];
+			lane[3 + axis][laneIdx] = direction[axis];
+			lane[6 + axis][laneIdx] = 1.0f / component;
+		}
+	}
+
+	const __m128 originX = _mm_load_ps(lane[0]), originY = _mm_load_ps(lane[1]), originZ = _mm_load_ps(lane[2]);
+	const __m128 directionX = _mm_load_ps(lane[3]), directionY = _mm_load_ps(lane[4]), directionZ = _mm_load_ps(lane[5]);
+	const __m128 inverseX = _mm_load_ps(lane[6]), inverseY = _mm_load_ps(lane[7]), inverseZ = _mm_load_ps(lane[8]);
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), tolerance = _mm_set1_ps(1.0f + 4.0f * std::numeric_limits<float>::epsilon());
+
+	__m128 active = _mm_castsi128_ps(_mm_cmplt_epi32(_mm_set_epi32(3, 2, 1, 0), _mm_set1_epi32(int(numRays))));
+	unsigned stack[64], stackSize = 0;
+
+	if (!_node.empty()) stack[stackSize++] = 0;
+
+	while (stackSize)
+	{
+		const Node& node = _node[stack[--stackSize]];
+
+		// Slab test of the node against every ray not yet occluded
+		const __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node._minPoint.x), originX), inverseX), x2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node._maxPoint.x), originX), inverseX);
+		const __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node._minPoint.y), originY), inverseY), y2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node._maxPoint.y), originY), inverseY);
+		const __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node._minPoint.z), originZ), inverseZ), z2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node._maxPoint.z), originZ), inverseZ);
+		const __m128 entry = _mm_max_ps(_mm_max_ps(_mm_min_ps(x1, x2), _mm_min_ps(y1, y2)), _mm_max_ps(_mm_min_ps(z1, z2), zero));
+		const __m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(x1, x2), _mm_max_ps(y1, y2)), _mm_min_ps(_mm_max_ps(z1, z2), one));
+
+		__m128 pending = _mm_and_ps(active, _mm_cmple_ps(entry, _mm_mul_ps(exit, tolerance)));
+		if (!_mm_movemask_ps(pending)) continue;
+
+		++stats._visitedNodes;
+
+		if (!node._count)
+		{
+			stack[stackSize++] = node._offset + 1;
+			stack[stackSize++] = node._offset;
+			continue;
+		}
+
+		++stats._visitedLeaves;
+
+		for (unsigned triangleIdx = node._offset; triangleIdx < node._offset + node._count; ++triangleIdx)
+		{
+			const vec3& v0 = _vertex[triangleIdx * 3];
+			const vec3 edge1 = _vertex[triangleIdx * 3 + 1] - v0, edge2 = _vertex[triangleIdx * 3 + 2] - v0;
+			++stats._triangleTests;
+
+			// Same operations as intersectSegment, one ray per lane
+			const __m128 edge1X = _mm_set1_ps(edge1.x), edge1Y = _mm_set1_ps(edge1.y), edge1Z = _mm_set1_ps(edge1.z);
+			const __m128 edge2X = _mm_set1_ps(edge2.x), edge2Y = _mm_set1_ps(edge2.y), edge2Z = _mm_set1_ps(edge2.z);
+			const __m128 sX = _mm_sub_ps(originX, _mm_set1_ps(v0.x)), sY = _mm_sub_ps(originY, _mm_set1_ps(v0.y)), sZ = _mm_sub_ps(originZ, _mm_set1_ps(v0.z));
+
+			const __m128 pX = _mm_sub_ps(_mm_mul_ps(directionY, edge2Z), _mm_mul_ps(edge2Y, directionZ));
+			const __m128 pY = _mm_sub_ps(_mm_mul_ps(directionZ, edge2X), _mm_mul_ps(edge2Z, directionX));
+			const __m128 pZ = _mm_sub_ps(_mm_mul_ps(directionX, edge2Y), _mm_mul_ps(edge2X, directionY));
+			const __m128 qX = _mm_sub_ps(_mm_mul_ps(sY, edge1Z), _mm_mul_ps(edge1Y, sZ));
+			const __m128 qY = _mm_sub_ps(_mm_mul_ps(sZ, edge1X), _mm_mul_ps(edge1Z, sX));
+			const __m128 qZ = _mm_sub_ps(_mm_mul_ps(sX, edge1Y), _mm_mul_ps(edge1X, sY));
+
+			const __m128 inverseDeterminant = _mm_div_ps(one, _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1X, pX), _mm_mul_ps(edge1Y, pY)), _mm_mul_ps(edge1Z, pZ)));
+			const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sX, pX), _mm_mul_ps(sY, pY)), _mm_mul_ps(sZ, pZ)), inverseDeterminant);
+			const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qX), _mm_mul_ps(directionY, qY)), _mm_mul_ps(directionZ, qZ)), inverseDeterminant);
+			const __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2X, qX), _mm_mul_ps(edge2Y, qY)), _mm_mul_ps(edge2Z, qZ)), inverseDeterminant);
+
+			const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero)), _mm_cmple_ps(_mm_add_ps(u, v), one));
+			const __m128 hit = _mm_and_ps(_mm_and_ps(inside, pending), _mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmplt_ps(t, one)));
+
+			pending = _mm_andnot_ps(hit, pending);
+			active = _mm_andnot_ps(hit, active);
+			if (!_mm_movemask_ps(pending)) break;
+		}
+
+		if (!_mm_movemask_ps(active)) break;
+	}
+
+	const int visibleMask = _mm_movemask_ps(active);
+
+	for (unsigned rayIdx = 0; rayIdx < numRays; ++rayIdx)
+	{
+		visible[rayIdx] = uint8_t((visibleMask >> rayIdx) & 1);
+		stats._numHits += !visible[rayIdx];
+	}
+#else
+	for (unsigned rayIdx = 0; rayIdx < numRays; ++rayIdx)
+	{
+		QueryStats rayStats;
+
+		visible[rayIdx] = this->isVisible(origin[rayIdx * originStride], target[rayIdx], &rayStats);
+		stats += rayStats;
+	}
+#endif
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "Geometry/3D/Ray3D.h"
+#include "Geometry/3D/Triangle3D.h"
+
+/**
+*	@file BVH.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Bounding volume hierarchy over the triangles of a mesh, built with a binned surface area heuristic. Nodes are flattened into a single
+*	array where siblings are adjacent, and leaf triangles are kept as a contiguous array of vertices in leaf order.
+*/
+class BVH
+{
+public:
+	/**
+	*	@brief Flattened node of 32 bytes.
+	*/
+	struct Node
+	{
+		vec3		_minPoint;									//!< Bounding box corner
+		unsigned	_offset;									//!< First triangle of a leaf, or first child of an internal node, whose sibling follows it
+
+		vec3		_maxPoint;									//!< Bounding box corner
+		unsigned	_count;										//!< Triangles of a leaf, zero for internal nodes
+	};
+
+	/**
+	*	@brief Work done by a single query.
+	*/
+	struct QueryStats
+	{
+		unsigned	_visitedNodes;								//!< Nodes popped from the traversal stack
+		unsigned	_visitedLeaves;								//!< Leaves whose triangles were tested
+		unsigned	_triangleTests;								//!< Ray-triangle tests
+		unsigned	_numHits;									//!< Intersections returned
+
+		/**
+		*	@brief Default constructor.
+		*/
+		QueryStats() : _visitedNodes(0), _visitedLeaves(0), _triangleTests(0), _numHits(0) {}
+
+		/**
+		*	@brief Accumulates the work of another query.
+		*/
+		QueryStats& operator+=(const QueryStats& stats);
+	};
+
+protected:
+	const static unsigned	BUILD_BLOCK_SIZE;					//!< Triangles processed by a single task while building
+	const static unsigned	MAX_DEPTH;							//!< Deeper nodes are leaves, which bounds the traversal stack
+	const static unsigned	MAX_LEAF_SIZE;						//!< Larger nodes are always split, unless they cannot be
+	const static unsigned	NUM_BINS;							//!< Candidate split planes per axis are NUM_BINS - 1
+	const static unsigned	PARALLEL_SUBTREE_SIZE;				//!< Nodes with fewer triangles are built as a whole by a single task
+	const static unsigned	QUERY_BLOCK_SIZE;					//!< Number of rays solved by a single task in batched queries, multiple of the packet size
+	const static float		TRAVERSAL_COST;						//!< Cost of visiting a node relative to a ray-triangle test
+
+	/**
+	*	@brief Triangle range to be turned into a node.
+	*/
+	struct BuildTask
+	{
+		unsigned	_node;										//!< Index of the node
+		unsigned	_first, _last;								//!< Range of the triangle index array
+		unsigned	_depth;										//!< Depth of the node
+	};
+
+protected:
+	std::vector<Node>		_node;								//!< Nodes in depth-first order of their first child, with the root at 0
+	std::vector<unsigned>	_triangleIndex;						//!< Index of each leaf triangle in the original mesh
+	std::vector<vec3>		_vertex;							//!< Vertices of leaf triangles, three per triangle
+
+protected:
+	/**
+	*	@brief Builds the nodes below a task, appending them to the given array. Children with fewer than PARALLEL_SUBTREE_SIZE triangles are
+	*	deferred, if an array for them is provided; otherwise, the whole subtree is built.
+	*/
+	void buildSubtree(const BuildTask& root, const std::vector<vec3>& minPoint, const std::vector<vec3>& maxPoint, const std::vector<vec3>& centroid,
+					  std::vector<Node>& nodes, std::vector<BuildTask>* deferred);
+
+	/**
+	*	@brief Tests up to four consecutive segments at once, sharing the traversal among them so that SIMD slab and ray-triangle tests are used
+	*	where available. Segments go from their origin to their target point, both excluded.
+	*	@param originStride Distance between the origins of consecutive segments, zero if all of them share the same origin.
+	*/
+	void testPacket(const vec3* origin, size_t originStride, const vec3* target, unsigned numRays, uint8_t* visible, QueryStats& stats) const;
+
+	/**
+	*	@brief Computes the entry distance of a ray into a node, using the inverse of its direction.
+	*	@return True if the ray enters the node before maxDistance.
+	*/
+	static bool intersect(const Node& node, const vec3& origin, const vec3& inverseDirection, float maxDistance, float& distance);
+
+	/**
+	*	@return Half the surface area of a box.
+	*/
+	static float getHalfArea(const vec3& minPoint, const vec3& maxPoint);
+
+	/**
+	*	@return Parametric distance of the hit between the segment from origin to origin + direction and the triangle (v0, v0 + edge1, v0 + edge2),
+	*	or a value out of (0, 1) if they do not intersect. Same operations as the SIMD kernel, hence both agree.
+	*/
+	static float intersectSegment(const vec3& origin, const vec3& direction, const vec3& v0, const vec3& edge1, const vec3& edge2);
+
+public:
+	/**
+	*	@brief Builds the hierarchy over the given triangles, whose indices are those reported by queries.
+	*/
+	BVH(const std::vector<Triangle3D>& triangles);
+
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~BVH();
+
+	/**
+	*	@brief Retrieves every triangle intersected by a ray, sorted by triangle index as an exhaustive traversal would.
+	*	@return True if any triangle was intersected.
+	*/
+	bool allHits(Ray3D& ray, std::vector<vec3>& points, std::vector<unsigned>& triangles, QueryStats* stats = nullptr) const;
+
+	/**
+	*	@brief Retrieves the closest triangle intersected by a ray, e.g., for picking.
+	*	@return True if any triangle was intersected.
+	*/
+	bool closestHit(Ray3D& ray, vec3& point, unsigned& triangle, QueryStats* stats = nullptr) const;
+
+	/**
+	*	@return True if no triangle crosses the open segment from origin to target, e.g., whether a point is seen from a viewpoint.
+	*/
+	bool isVisible(const vec3& origin, const vec3& target, QueryStats* stats = nullptr) const;
+
+	/**
+	*	@brief Batched visibility across threads, where consecutive segments are traversed together as packets of four. Hence, targets should be
+	*	sorted so that neighbouring segments are close to each other, e.g., in grid order.
+	*	@param origins Either one origin shared by every segment, such as a scanner station, or one origin per target.
+	*	@param visible Stores 1 for segments not crossed by any triangle and 0 otherwise.
+	*	@param stats Work done by every packet, where each node and ray-triangle test is counted once per packet.
+	*/
+	void isVisible(const std::vector<vec3>& origins, const std::vector<vec3>& targets, std::vector<uint8_t>& visible, QueryStats* stats = nullptr) const;
+
+	/**
+	*	@return Resident memory of the hierarchy, in bytes.
+	*/
+	size_t getMemoryFootprint() const;
+
+	/**
+	*	@return Nodes of the hierarchy.
+	*/
+	const std::vector<Node>& getNodes() const { return _node; }
+
+	/**
+	*	@return Number of indexed triangles.
+	*/
+	size_t getNumTriangles() const { return _triangleIndex.size(); }
+};
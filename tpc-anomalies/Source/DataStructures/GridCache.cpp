@@ -0,0 +1,245 @@
+#include "stdafx.h"
+#include "GridCache.h"
+
+#include <filesystem>
+#include "DataStructures/VoxelPass.h"
+#include "Utilities/ThreadPool.h"
+
+// Initialization of static attributes
+const std::string GridCache::CACHE_FOLDER = "Cache/Grids/";
+const uintmax_t GridCache::MAX_CACHE_SIZE = uintmax_t(2) << 30;
+const std::string GridCache::CACHE_EXTENSION = ".grid";
+const uint32_t GridCache::CACHE_VERSION = 2;
+const std::string GridCache::TEMPORARY_EXTENSION = ".tmp";
+const unsigned GridCache::TEMPORARY_LIFETIME = 60;
+
+/// [Public methods]
+
+void GridCache::evict()
+{
+	struct CachedFile
+	{
+		std::filesystem::path				_path;
+		std::filesystem::file_time_type		_lastUse;
+		uintmax_t							_size;
+	};
+
+	std::error_code error;
+	std::vector<CachedFile> files;
+	uintmax_t cacheSize = 0;
+
+	const std::filesystem::file_time_type staleTime = std::filesystem::file_time_type::clock::now() - std::chrono::minutes(TEMPORARY_LIFETIME);
+
+	for (const std::filesystem::directory_entry& entry: std::filesystem::directory_iterator(CACHE_FOLDER, error))
+	{
+		if (!entry.is_regular_file(error)) continue;
+
+		// Temporary files which are no longer being written were left by failed writes or by interrupted processes
+		if (entry.path().extension() == TEMPORARY_EXTENSION)
+		{
+			if (entry.last_write_time(error) < staleTime) std::filesystem::remove(entry.path(), error);
+			continue;
+		}
+
+		if (entry.path().extension() != CACHE_EXTENSION) continue;
+
+		files.push_back(CachedFile{ entry.path(), entry.last_write_time(error), entry.file_size(error) });
+		cacheSize += files.back()._size;
+	}
+
+	// Hits refresh the modification time, so the oldest files are the least recently used ones
+	std::sort(files.begin(), files.end(), [](const CachedFile& file1, const CachedFile& file2) { return file1._lastUse < file2._lastUse; });
+
+	for (size_t fileIdx = 0; fileIdx < files.size() && cacheSize > MAX_CACHE_SIZE; ++fileIdx)
+	{
+		if (std::filesystem::remove(files[fileIdx]._path, error)) cacheSize -= files[fileIdx]._size;
+	}
+}
+
+uint64_t GridCache::getKey(uint64_t cloudHash, const AABB& aabb, const mat4& frame, const uvec3& subdivisions, int neighbors, float stdFactor, bool fillUnderVoxels, int detector)
+{
+	const vec3 minPoint = aabb.min(), maxPoint = aabb.max();
+	const uint8_t fillUnder = fillUnderVoxels;
+	uint64_t key = GridCache::hash(&cloudHash, sizeof(uint64_t));
+
+	key = GridCache::hash(&minPoint, sizeof(vec3), key);
+	key = GridCache::hash(&maxPoint, sizeof(vec3), key);
+	key = GridCache::hash(&frame[0][0], sizeof(mat4), key);
+	key = GridCache::hash(&subdivisions, sizeof(uvec3), key);
+	key = GridCache::hash(&neighbors, sizeof(int), key);
+	key = GridCache::hash(&stdFactor, sizeof(float), key);
+	key = GridCache::hash(&fillUnder, sizeof(uint8_t), key);
+	key = GridCache::hash(&detector, sizeof(int), key);
+
+	return key;
+}
+
+uint64_t GridCache::hash(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	for (size_t byteIdx = 0; byteIdx < size; ++byteIdx)
+	{
+		seed = (seed ^ bytes[byteIdx]) * 1099511628211ull;
+	}
+
+	return seed;
+}
+
+RegularGrid* GridCache::read(uint64_t key, const uvec3& subdivisions)
+{
+	const std::string path = GridCache::getPath(key);
+	std::ifstream fin(path, std::ios::in | std::ios::binary);
+	if (!fin.is_open()) return nullptr;
+
+	std::error_code error;
+	const uintmax_t fileSize = std::filesystem::file_size(path, error);
+
+	// Corrupted files are removed and reported as a miss, before their header drives any allocation or write
+	const auto discard = [&]() -> RegularGrid*
+	{
+		fin.close();
+		std::filesystem::remove(path, error);
+
+		return nullptr;
+	};
+
+	FileHeader header;
+	fin.read((char*)&header, sizeof(FileHeader));
+
+	if (!fin || std::strncmp(header._magic, "TPCG", 4) != 0 || header._version != CACHE_VERSION || header._key != key) return nullptr;
+
+	const uint64_t numOccupied = header._numOccupied;
+	const uvec3 numDivs(header._numDivs[0], header._numDivs[1], header._numDivs[2]);
+	if (error || numDivs != subdivisions) return discard();
+
+	const uint64_t numCells = uint64_t(numDivs.x) * numDivs.y * numDivs.z;
+	if (numOccupied > numCells) return discard();
+
+	const uint64_t dataSize = GridCache::getSectionSize(numOccupied, sizeof(uint32_t)) * 2 + GridCache::getSectionSize(numOccupied, sizeof(float)) + numOccupied * sizeof(uint8_t);
+	if (sizeof(FileHeader) + dataSize > fileSize) return discard();
+
+	std::vector<uint32_t> cellIndex(numOccupied), pointCount(numOccupied);
+	std::vector<float> thermal(numOccupied);
+	std::vector<uint8_t> localPeak(numOccupied);
+
+	fin.read((char*)cellIndex.data(), numOccupied * sizeof(uint32_t));			fin.seekg(GridCache::getSectionSize(numOccupied, sizeof(uint32_t)) - numOccupied * sizeof(uint32_t), std::ios::cur);
+	fin.read((char*)thermal.data(), numOccupied * sizeof(float));				fin.seekg(GridCache::getSectionSize(numOccupied, sizeof(float)) - numOccupied * sizeof(float), std::ios::cur);
+	fin.read((char*)pointCount.data(), numOccupied * sizeof(uint32_t));			fin.seekg(GridCache::getSectionSize(numOccupied, sizeof(uint32_t)) - numOccupied * sizeof(uint32_t), std::ios::cur);
+	fin.read((char*)localPeak.data(), numOccupied * sizeof(uint8_t));
+
+	if (!fin || std::any_of(cellIndex.begin(), cellIndex.end(), [numCells](uint32_t index) { return index >= numCells; })) return discard();
+	fin.close();
+
+	mat4 frame;
+	std::memcpy(&frame[0][0], header._frame, sizeof(mat4));
+
+	RegularGrid* grid = new RegularGrid(AABB(vec3(header._aabbMin[0], header._aabbMin[1], header._aabbMin[2]), vec3(header._aabbMax[0], header._aabbMax[1], header._aabbMax[2])), numDivs, frame);
+	grid->_localPeak = std::vector<float>(grid->length(), LOCAL_PEAK_NONE);
+
+	ThreadPool::getInstance()->parallelFor((numOccupied + 0xFFFF) >> 16, [&](size_t blockIdx)
+	{
+		for (size_t occupiedIdx = blockIdx << 16; occupiedIdx < std::min(numOccupied, uint64_t(blockIdx + 1) << 16); ++occupiedIdx)
+		{
+			const uint32_t index = cellIndex[occupiedIdx];
+
+			grid->_grid[index] = VOXEL_FREE;
+			grid->_thermal[index] = thermal[occupiedIdx];
+			grid->_pointCount[index] = pointCount[occupiedIdx];
+			grid->_localPeak[index] = localPeak[occupiedIdx];
+		}
+	});
+
+	// Hits are recorded as modifications, which drives the eviction order
+	std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+	return grid;
+}
+
+bool GridCache::write(uint64_t key, RegularGrid* grid)
+{
+	std::error_code error;
+	std::filesystem::create_directories(CACHE_FOLDER, error);
+
+	// Occupied voxels are gathered in grid order
+	std::vector<size_t> slabOffset;
+	grid->getSlabOffsets(slabOffset);
+
+	const uint64_t numOccupied = slabOffset.back();
+	std::vector<uint32_t> cellIndex(numOccupied), pointCount(numOccupied);
+	std::vector<float> thermal(numOccupied);
+	std::vector<uint8_t> localPeak(numOccupied);
+
+	VoxelPass::forEachSlab(grid->_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		size_t occupiedIdx = slabOffset[x];
+
+		for (unsigned index = firstIndex; index < lastIndex; ++index)
+		{
+			if (grid->_grid[index] == VOXEL_EMPTY) continue;
+
+			cellIndex[occupiedIdx] = index;
+			thermal[occupiedIdx] = grid->_thermal[index];
+			pointCount[occupiedIdx] = grid->_pointCount[index];
+			localPeak[occupiedIdx] = grid->_localPeak.empty() ? LOCAL_PEAK_NONE : uint8_t(grid->_localPeak[index]);
+			++occupiedIdx;
+		}
+	});
+
+	FileHeader header;
+	std::memset(&header, 0, sizeof(FileHeader));
+	std::memcpy(header._magic, "TPCG", 4);
+	header._version = CACHE_VERSION;
+	header._key = key;
+	header._numDivs[0] = grid->_numDivs.x; header._numDivs[1] = grid->_numDivs.y; header._numDivs[2] = grid->_numDivs.z;
+	header._aabbMin[0] = grid->_aabb.min().x; header._aabbMin[1] = grid->_aabb.min().y; header._aabbMin[2] = grid->_aabb.min().z;
+	header._aabbMax[0] = grid->_aabb.max().x; header._aabbMax[1] = grid->_aabb.max().y; header._aabbMax[2] = grid->_aabb.max().z;
+	std::memcpy(header._frame, &grid->_frame[0][0], sizeof(mat4));
+	header._numOccupied = numOccupied;
+
+	// Written under a temporary name, so that an interrupted write never leaves a truncated grid behind
+	const std::string path = GridCache::getPath(key), temporaryPath = path + TEMPORARY_EXTENSION;
+	const uint64_t zeros = 0;
+
+	{
+		std::ofstream fout(temporaryPath, std::ios::out | std::ios::binary);
+		if (!fout.is_open()) return false;
+
+		fout.write((char*)&header, sizeof(FileHeader));
+		fout.write((char*)cellIndex.data(), numOccupied * sizeof(uint32_t));		fout.write((char*)&zeros, GridCache::getSectionSize(numOccupied, sizeof(uint32_t)) - numOccupied * sizeof(uint32_t));
+		fout.write((char*)thermal.data(), numOccupied * sizeof(float));			fout.write((char*)&zeros, GridCache::getSectionSize(numOccupied, sizeof(float)) - numOccupied * sizeof(float));
+		fout.write((char*)pointCount.data(), numOccupied * sizeof(uint32_t));		fout.write((char*)&zeros, GridCache::getSectionSize(numOccupied, sizeof(uint32_t)) - numOccupied * sizeof(uint32_t));
+		fout.write((char*)localPeak.data(), numOccupied * sizeof(uint8_t));
+
+		if (!fout)
+		{
+			fout.close();
+			std::filesystem::remove(temporaryPath, error);
+
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporaryPath, path, error);
+
+	if (error)
+	{
+		std::filesystem::remove(temporaryPath, error);
+
+		return false;
+	}
+
+	GridCache::evict();
+
+	return true;
+}
+
+/// [Protected methods]
+
+std::string GridCache::getPath(uint64_t key)
+{
+	std::ostringstream stream;
+	stream << CACHE_FOLDER << std::hex << std::setw(16) << std::setfill('0') << key << CACHE_EXTENSION;
+
+	return stream.str();
+}
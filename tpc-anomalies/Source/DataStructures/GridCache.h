@@ -0,0 +1,81 @@
+#pragma once
+
+#include "DataStructures/RegularGrid.h"
+
+/**
+*	@file GridCache.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Persistent cache of point cloud grids and their anomalies. Each grid is stored sparsely in its own file,
+*	named after a key which combines the cloud content and every parameter the grid depends on.
+*/
+class GridCache
+{
+public:
+	const static std::string	CACHE_FOLDER;						//!< Folder where cached grids are written
+	const static uintmax_t		MAX_CACHE_SIZE;						//!< Total size of the cache before older grids are evicted
+
+protected:
+	const static std::string	CACHE_EXTENSION;					//!< Extension of cached grids
+	const static uint32_t		CACHE_VERSION;						//!< Version of the file layout; files from other versions are ignored
+	const static std::string	TEMPORARY_EXTENSION;				//!< Extension appended to grids while they are being written
+	const static unsigned		TEMPORARY_LIFETIME;					//!< Minutes after which temporary files are considered to be left by failed writes
+
+	/**
+	*	@brief Beginning of every cached grid. The sections which follow are arrays of numOccupied elements, each starting at an 8-byte boundary:
+	*	grid indices (uint32), temperatures (float), point counts (uint32) and peak types (uint8). The layout can therefore be memory-mapped.
+	*/
+	struct FileHeader
+	{
+		char		_magic[4];										//!< Always TPCG
+		uint32_t	_version;										//!< CACHE_VERSION
+		uint64_t	_key;											//!< Key of the cached grid
+		uint32_t	_numDivs[3];									//!< Grid dimensions
+		uint32_t	_padding;										//!< Keeps the following fields aligned
+		float		_aabbMin[3], _aabbMax[3];						//!< Space covered by the grid, in grid space
+		float		_frame[16];										//!< Column-major transformation from grid space to world space
+		uint64_t	_numOccupied;									//!< Number of non-empty voxels
+	};
+
+protected:
+	/**
+	*	@return Path of the file of a key.
+	*/
+	static std::string getPath(uint64_t key);
+
+	/**
+	*	@return Size of a section of numOccupied elements, rounded to 8 bytes.
+	*/
+	static size_t getSectionSize(uint64_t numOccupied, size_t elementSize) { return (numOccupied * elementSize + 7) & ~size_t(7); }
+
+public:
+	/**
+	*	@brief Removes stale temporary files and the least recently used grids until the cache fits within MAX_CACHE_SIZE.
+	*/
+	static void evict();
+
+	/**
+	*	@return Key of a grid built from a cloud with the given content hash and parameters.
+	*/
+	static uint64_t getKey(uint64_t cloudHash, const AABB& aabb, const mat4& frame, const uvec3& subdivisions, int neighbors, float stdFactor, bool fillUnderVoxels, int detector);
+
+	/**
+	*	@brief Mixes raw bytes into a 64-bit FNV-1a hash.
+	*/
+	static uint64_t hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+	/**
+	*	@return Cached grid of the given key, or null if it is not cached. Files whose header does not match the subdivisions or the file size,
+	*	or whose voxels lie outside the grid, are deleted.
+	*/
+	static RegularGrid* read(uint64_t key, const uvec3& subdivisions);
+
+	/**
+	*	@brief Stores a grid with its anomalies under the given key, evicting older grids if needed.
+	*	@return Success of writing process.
+	*/
+	static bool write(uint64_t key, RegularGrid* grid);
+};
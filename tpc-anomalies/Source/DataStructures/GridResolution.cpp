@@ -0,0 +1,91 @@
+#include "stdafx.h"
+#include "GridResolution.h"
+
+// Initialization of static attributes
+const float GridResolution::DEFAULT_THROUGHPUT = 5e7f;
+const unsigned GridResolution::BYTES_PER_VOXEL = sizeof(uint16_t) + 3 * sizeof(float) + sizeof(int64_t) + sizeof(unsigned);
+const unsigned GridResolution::MAX_SUBDIVISIONS = 1024;
+const size_t GridResolution::MAX_VOXELS = size_t(1) << 27;
+const float GridResolution::MIN_SAMPLE_POINTS_PER_CELL = 8.0f;
+const unsigned GridResolution::SAMPLE_SIZE = 1 << 17;
+
+/// [Public methods]
+
+GridResolution::Estimate GridResolution::estimate(const PackedPoints& points, const AABB& aabb, float targetPointsPerVoxel, float throughput, const mat4& frame)
+{
+	const size_t numPoints = points.size(), sampleSize = std::min(numPoints, size_t(SAMPLE_SIZE));
+	const vec3 extent = aabb.size();
+	const float maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+	Estimate estimate{ uvec3(1), maxExtent, maxExtent, 2.0f, std::min(numPoints, size_t(1)), BYTES_PER_VOXEL, .0f };
+
+	if (!sampleSize || maxExtent <= .0f) return estimate;
+
+	// Evenly strided sample in grid space, so that the estimate is deterministic
+	const mat4 inverseFrame = glm::inverse(frame);
+	std::vector<vec4> sample(sampleSize);
+	for (size_t sampleIdx = 0; sampleIdx < sampleSize; ++sampleIdx) sample[sampleIdx] = inverseFrame * vec4(points.getPoint(sampleIdx * numPoints / sampleSize), 1.0f);
+
+	// Cells are halved while the sample is still dense enough to occupy the same cells as the whole cloud
+	float cellSize = maxExtent, finestCellSize = maxExtent;
+	size_t occupiedCells = 1, finestOccupiedCells = 1;
+
+	while (true)
+	{
+		const float nextCellSize = cellSize * .5f;
+		const size_t nextOccupiedCells = GridResolution::countOccupiedCells(sample, aabb.min(), nextCellSize);
+
+		if (float(sampleSize) / nextOccupiedCells < MIN_SAMPLE_POINTS_PER_CELL || nextCellSize * MAX_SUBDIVISIONS < maxExtent) break;
+
+		finestCellSize = cellSize;
+		finestOccupiedCells = occupiedCells;
+		cellSize = nextCellSize;
+		occupiedCells = nextOccupiedCells;
+	}
+
+	if (cellSize < finestCellSize) estimate._dimension = glm::clamp(std::log2(float(occupiedCells) / finestOccupiedCells), 1.0f, 3.0f);
+
+	// occupied(size) = occupiedCells * (cellSize / size) ^ dimension, solved for numPoints / occupied(size) = target
+	const auto getCellSize = [&](float pointsPerCell) { return cellSize * std::pow(pointsPerCell * occupiedCells / numPoints, 1.0f / estimate._dimension); };
+
+	estimate._cellSize = getCellSize(std::max(targetPointsPerVoxel, 1.0f));
+	estimate._pointSpacing = getCellSize(1.0f);
+
+	// Cells grow uniformly if the grid would exceed the voxel budget
+	const vec3 numCells = glm::max(extent / estimate._cellSize, vec3(1.0f));
+	const float numVoxelsUnbounded = numCells.x * numCells.y * numCells.z;
+	if (numVoxelsUnbounded > MAX_VOXELS) estimate._cellSize *= std::cbrt(numVoxelsUnbounded / MAX_VOXELS);
+
+	estimate._subdivisions = glm::clamp(uvec3(glm::ceil(extent / estimate._cellSize)), uvec3(1), uvec3(MAX_SUBDIVISIONS));
+
+	// Clamped axes have larger cells than requested, hence occupancy is predicted from the edge of a cube with the actual cell volume
+	const vec3 effectiveCellSize = extent / vec3(estimate._subdivisions);
+	estimate._cellSize = std::cbrt(effectiveCellSize.x * effectiveCellSize.y * effectiveCellSize.z);
+
+	const size_t numVoxels = size_t(estimate._subdivisions.x) * estimate._subdivisions.y * estimate._subdivisions.z;
+	const float occupiedVoxels = occupiedCells * std::pow(cellSize / estimate._cellSize, estimate._dimension);
+
+	estimate._occupiedVoxels = std::min(numVoxels, std::min(numPoints, size_t(occupiedVoxels)));
+	estimate._memoryBytes = numVoxels * BYTES_PER_VOXEL;
+	estimate._seconds = (numPoints + numVoxels) / std::max(throughput, 1.0f);
+
+	return estimate;
+}
+
+/// [Protected methods]
+
+size_t GridResolution::countOccupiedCells(const std::vector<vec4>& points, const vec3& origin, float cellSize)
+{
+	// Cell coordinates are packed into a single key, hence distinct cells are those with distinct keys
+	std::vector<uint64_t> cellKey(points.size());
+
+	std::transform(std::execution::par_unseq, points.begin(), points.end(), cellKey.begin(), [&](const vec4& point)
+	{
+		const uvec3 cell = uvec3(glm::clamp((vec3(point) - origin) / cellSize, vec3(.0f), vec3(float((1 << 21) - 1))));
+
+		return (uint64_t(cell.x) << 42) | (uint64_t(cell.y) << 21) | uint64_t(cell.z);
+	});
+
+	std::sort(std::execution::par_unseq, cellKey.begin(), cellKey.end());
+
+	return std::unique(cellKey.begin(), cellKey.end()) - cellKey.begin();
+}
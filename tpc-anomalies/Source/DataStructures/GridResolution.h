@@ -0,0 +1,59 @@
+#pragma once
+
+#include "DataStructures/PackedPoints.h"
+#include "Geometry/3D/AABB.h"
+
+/**
+*	@file GridResolution.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Chooses grid subdivisions from the point density of a cloud. The number of occupied cells of a sample is measured at halving cell sizes
+*	through a spatial hash, and the resulting scaling law (about two for scanned surfaces) is extrapolated down to the cell size which holds the
+*	requested number of points per occupied voxel.
+*/
+class GridResolution
+{
+public:
+	/**
+	*	@brief Proposed resolution and its predicted cost.
+	*/
+	struct Estimate
+	{
+		uvec3		_subdivisions;									//!< Proposed grid dimensions
+		float		_cellSize;										//!< Edge of a cube with the volume of the proposed cells
+		float		_pointSpacing;									//!< Cell size at which a voxel would hold a single point
+		float		_dimension;										//!< Growth exponent of occupied cells as cells shrink
+		size_t		_occupiedVoxels;								//!< Predicted number of non-empty voxels
+		size_t		_memoryBytes;									//!< Predicted peak memory of the build
+		float		_seconds;										//!< Predicted build time
+	};
+
+public:
+	const static float		DEFAULT_THROUGHPUT;						//!< Points plus voxels processed per second before any build is measured
+
+protected:
+	const static unsigned	BYTES_PER_VOXEL;						//!< Peak memory per voxel of a CPU build: dense channels plus binning accumulators
+	const static unsigned	MAX_SUBDIVISIONS;						//!< Upper bound of the subdivisions along each axis
+	const static size_t		MAX_VOXELS;								//!< Upper bound of the total number of voxels
+	const static float		MIN_SAMPLE_POINTS_PER_CELL;				//!< Sample density below which the occupied cells of a sample no longer match those of the cloud
+	const static unsigned	SAMPLE_SIZE;							//!< Maximum number of sampled points
+
+protected:
+	/**
+	*	@return Number of distinct cells of the given size which hold any point.
+	*/
+	static size_t countOccupiedCells(const std::vector<vec4>& points, const vec3& origin, float cellSize);
+
+public:
+	/**
+	*	@brief Proposes a resolution for a cloud.
+	*	@param aabb Space covered by the grid.
+	*	@param targetPointsPerVoxel Desired average number of points in occupied voxels.
+	*	@param throughput Points plus voxels processed per second, e.g., measured in a previous build.
+	*	@param frame Transformation from grid space, where the box is given, to world space.
+	*/
+	static Estimate estimate(const PackedPoints& points, const AABB& aabb, float targetPointsPerVoxel, float throughput = DEFAULT_THROUGHPUT, const mat4& frame = mat4(1.0f));
+};
@@ -0,0 +1,241 @@
+#include "stdafx.h"
+#include "HotspotLabeling.h"
+
+#include "DataStructures/VoxelPass.h"
+
+/// [Public methods]
+
+void HotspotLabeling::label(RegularGrid* grid, Connectivity connectivity, std::vector<Hotspot>& hotspots)
+{
+	typedef std::unordered_map<unsigned, Hotspot> HotspotMap;
+
+	const uvec3 numDivs = grid->getNumSubdivisions();
+	const ivec3 iNumDivs = ivec3(numDivs);
+	const VoxelPass::Strides strides = VoxelPass::getStrides(numDivs);
+	const std::vector<float>& localPeak = *grid->localPeak();
+	const std::vector<float>& thermal = *grid->thermalData();
+	const std::vector<unsigned>& pointCount = *grid->pointCount();
+	const uint16_t* occupancy = grid->data();
+	const std::vector<ivec3> offsets = HotspotLabeling::getBackwardOffsets(connectivity);
+	const vec3 aabbMin = grid->getAABB().min(), cellSize = grid->getCellSize();
+	const mat4 frame = grid->getFrame();
+
+	auto isAnomalous = [&](unsigned cellIndex) -> bool
+	{
+		return occupancy[cellIndex] != VOXEL_EMPTY && localPeak[cellIndex] != LOCAL_PEAK_NONE;
+	};
+
+	hotspots.clear();
+	if (localPeak.size() != grid->length()) return;
+
+	// Every voxel starts as its own component
+	std::vector<std::atomic<unsigned>> parent(grid->length());
+	VoxelPass::forEachSlab(numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		for (unsigned cellIndex = firstIndex; cellIndex < lastIndex; ++cellIndex) parent[cellIndex].store(cellIndex, std::memory_order_relaxed);
+	});
+
+	// Union with backward neighbours of the same peak type; slabs are united concurrently through CAS
+	VoxelPass::forEachSlab(numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		for (unsigned cellIndex = firstIndex; cellIndex < lastIndex; ++cellIndex)
+		{
+			if (!isAnomalous(cellIndex)) continue;
+
+			const int y = (cellIndex - firstIndex) / strides._y, z = (cellIndex - firstIndex) % strides._y;
+
+			for (const ivec3& offset: offsets)
+			{
+				const ivec3 neighbor = ivec3(x, y, z) + offset;
+				if (neighbor.x < 0 || neighbor.y < 0 || neighbor.z < 0 || neighbor.y >= iNumDivs.y || neighbor.z >= iNumDivs.z) continue;
+
+				const unsigned neighborIndex = neighbor.x * strides._x + neighbor.y * strides._y + neighbor.z;
+				if (isAnomalous(neighborIndex) && localPeak[neighborIndex] == localPeak[cellIndex])
+				{
+					HotspotLabeling::unite(parent, cellIndex, neighborIndex);
+				}
+			}
+		}
+	});
+
+	// Per-slab summaries, merged in slab order so that the result does not depend on scheduling
+	HotspotMap hotspotMap = VoxelPass::reduceSlabs(numDivs, HotspotMap(), [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		HotspotMap slabMap;
+
+		for (unsigned cellIndex = firstIndex; cellIndex < lastIndex; ++cellIndex)
+		{
+			if (!isAnomalous(cellIndex)) continue;
+
+			const unsigned root = HotspotLabeling::find(parent, cellIndex);
+			const uvec3 cell(x, (cellIndex - firstIndex) / strides._y, (cellIndex - firstIndex) % strides._y);
+			const float temperature = thermal[cellIndex];
+			auto hotspotIt = slabMap.find(root);
+
+			if (hotspotIt == slabMap.end())
+			{
+				Hotspot hotspot;
+				hotspot._peakType = int(localPeak[cellIndex]);
+				hotspot._numVoxels = 1;
+				hotspot._numPoints = pointCount.empty() ? 0 : pointCount[cellIndex];
+				hotspot._minCell = hotspot._maxCell = cell;
+				hotspot._centroid = vec3(cell);
+				hotspot._peakTemperature = hotspot._meanTemperature = temperature;
+
+				slabMap[root] = hotspot;
+			}
+			else
+			{
+				Hotspot& hotspot = hotspotIt->second;
+				++hotspot._numVoxels;
+				hotspot._numPoints += pointCount.empty() ? 0 : pointCount[cellIndex];
+				hotspot._minCell = glm::min(hotspot._minCell, cell);
+				hotspot._maxCell = glm::max(hotspot._maxCell, cell);
+				hotspot._centroid += vec3(cell);
+				hotspot._peakTemperature = hotspot._peakType == LOCAL_PEAK_MAX ? std::max(hotspot._peakTemperature, temperature) : std::min(hotspot._peakTemperature, temperature);
+				hotspot._meanTemperature += temperature;
+			}
+		}
+
+		return slabMap;
+	}, [](HotspotMap& accumulated, HotspotMap& partial)
+	{
+		for (auto& pair: partial)
+		{
+			auto hotspotIt = accumulated.find(pair.first);
+
+			if (hotspotIt == accumulated.end())
+			{
+				accumulated[pair.first] = pair.second;
+			}
+			else
+			{
+				Hotspot& hotspot = hotspotIt->second;
+				hotspot._numVoxels += pair.second._numVoxels;
+				hotspot._numPoints += pair.second._numPoints;
+				hotspot._minCell = glm::min(hotspot._minCell, pair.second._minCell);
+				hotspot._maxCell = glm::max(hotspot._maxCell, pair.second._maxCell);
+				hotspot._centroid += pair.second._centroid;
+				hotspot._peakTemperature = hotspot._peakType == LOCAL_PEAK_MAX ? std::max(hotspot._peakTemperature, pair.second._peakTemperature) : std::min(hotspot._peakTemperature, pair.second._peakTemperature);
+				hotspot._meanTemperature += pair.second._meanTemperature;
+			}
+		}
+	});
+
+	// Sums are turned into averages and grid coordinates into world coordinates
+	hotspots.reserve(hotspotMap.size());
+
+	for (auto& pair: hotspotMap)
+	{
+		Hotspot& hotspot = pair.second;
+		hotspot._centroid = vec3(frame * vec4(aabbMin + (hotspot._centroid / float(hotspot._numVoxels) + vec3(.5f)) * cellSize, 1.0f));
+		hotspot._meanTemperature /= hotspot._numVoxels;
+		hotspot._aabb = AABB(aabbMin + vec3(hotspot._minCell) * cellSize, aabbMin + vec3(hotspot._maxCell + uvec3(1)) * cellSize).transform(frame);
+
+		hotspots.push_back(hotspot);
+	}
+
+	HotspotLabeling::sort(hotspots, NUM_VOXELS);
+}
+
+void HotspotLabeling::filter(std::vector<Hotspot>& hotspots, unsigned minVoxels, int peakType)
+{
+	hotspots.erase(std::remove_if(hotspots.begin(), hotspots.end(), [&](const Hotspot& hotspot)
+	{
+		return hotspot._numVoxels < minVoxels || (peakType >= 0 && hotspot._peakType != peakType);
+	}), hotspots.end());
+}
+
+void HotspotLabeling::sort(std::vector<Hotspot>& hotspots, SortCriterion criterion)
+{
+	// Ties are broken by position so that the order is deterministic
+	auto tieBreak = [](const Hotspot& hotspot1, const Hotspot& hotspot2)
+	{
+		if (hotspot1._minCell.x != hotspot2._minCell.x) return hotspot1._minCell.x < hotspot2._minCell.x;
+		if (hotspot1._minCell.y != hotspot2._minCell.y) return hotspot1._minCell.y < hotspot2._minCell.y;
+		return hotspot1._minCell.z < hotspot2._minCell.z;
+	};
+
+	std::sort(hotspots.begin(), hotspots.end(), [&](const Hotspot& hotspot1, const Hotspot& hotspot2)
+	{
+		switch (criterion)
+		{
+		case NUM_POINTS:
+			if (hotspot1._numPoints != hotspot2._numPoints) return hotspot1._numPoints > hotspot2._numPoints;
+			break;
+		case PEAK_TEMPERATURE:
+			// Hot spots come first, and each type is ordered from its most extreme peak
+			if (hotspot1._peakType != hotspot2._peakType) return hotspot1._peakType == LOCAL_PEAK_MAX;
+			if (hotspot1._peakTemperature != hotspot2._peakTemperature)
+				return hotspot1._peakType == LOCAL_PEAK_MIN ? hotspot1._peakTemperature < hotspot2._peakTemperature : hotspot1._peakTemperature > hotspot2._peakTemperature;
+			break;
+		default:
+			break;
+		}
+
+		if (hotspot1._numVoxels != hotspot2._numVoxels) return hotspot1._numVoxels > hotspot2._numVoxels;
+
+		return tieBreak(hotspot1, hotspot2);
+	});
+}
+
+/// [Protected methods]
+
+unsigned HotspotLabeling::find(std::vector<std::atomic<unsigned>>& parent, unsigned cellIndex)
+{
+	unsigned cellParent = parent[cellIndex].load();
+
+	while (cellParent != cellIndex)
+	{
+		const unsigned grandParent = parent[cellParent].load();
+
+		// Path halving; a failed exchange only means another thread already shortened the path
+		parent[cellIndex].compare_exchange_weak(cellParent, grandParent);
+
+		cellIndex = cellParent;
+		cellParent = parent[cellIndex].load();
+	}
+
+	return cellIndex;
+}
+
+std::vector<ivec3> HotspotLabeling::getBackwardOffsets(Connectivity connectivity)
+{
+	std::vector<ivec3> offsets;
+
+	for (int x = -1; x <= 1; ++x)
+	{
+		for (int y = -1; y <= 1; ++y)
+		{
+			for (int z = -1; z <= 1; ++z)
+			{
+				const int numNonZero = (x != 0) + (y != 0) + (z != 0);
+				const bool isBackward = x < 0 || (x == 0 && (y < 0 || (y == 0 && z < 0)));
+
+				if (!isBackward) continue;
+				if (connectivity == FACES && numNonZero > 1) continue;
+				if (connectivity == EDGES && numNonZero > 2) continue;
+
+				offsets.push_back(ivec3(x, y, z));
+			}
+		}
+	}
+
+	return offsets;
+}
+
+void HotspotLabeling::unite(std::vector<std::atomic<unsigned>>& parent, unsigned cellIndex1, unsigned cellIndex2)
+{
+	while (true)
+	{
+		cellIndex1 = HotspotLabeling::find(parent, cellIndex1);
+		cellIndex2 = HotspotLabeling::find(parent, cellIndex2);
+
+		if (cellIndex1 == cellIndex2) return;
+		if (cellIndex1 < cellIndex2) std::swap(cellIndex1, cellIndex2);
+
+		// Only a root can be linked; retry if it stopped being one in the meantime
+		unsigned expected = cellIndex1;
+		if (parent[cellIndex1].compare_exchange_strong(expected, cellIndex2)) return;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "DataStructures/RegularGrid.h"
+
+/**
+*	@file HotspotLabeling.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Groups anomalous voxels of a regular grid into connected hotspots.
+*/
+class HotspotLabeling
+{
+public:
+	enum Connectivity : int
+	{
+		FACES = 6, EDGES = 18, VERTICES = 26
+	};
+
+	enum SortCriterion : int
+	{
+		NUM_VOXELS = 0, NUM_POINTS = 1, PEAK_TEMPERATURE = 2
+	};
+
+	/**
+	*	@brief Summary of a connected set of anomalous voxels sharing the same peak type.
+	*/
+	struct Hotspot
+	{
+		int			_peakType;								//!< LOCAL_PEAK_MIN or LOCAL_PEAK_MAX
+		unsigned	_numVoxels;								//!< Number of voxels in the component
+		unsigned	_numPoints;								//!< Number of points binned into those voxels
+		uvec3		_minCell, _maxCell;						//!< Bounding box in grid coordinates (both inclusive)
+		AABB		_aabb;									//!< Bounding box in world coordinates
+		vec3		_centroid;								//!< Average of voxel centres
+		float		_peakTemperature;						//!< Highest (MAX) or lowest (MIN) voxel temperature
+		float		_meanTemperature;						//!< Average voxel temperature
+	};
+
+protected:
+	/**
+	*	@brief Finds the root of a voxel while halving its path.
+	*/
+	static unsigned find(std::vector<std::atomic<unsigned>>& parent, unsigned cellIndex);
+
+	/**
+	*	@brief Backward neighbour offsets of the given connectivity, so that every pair of voxels is visited once.
+	*/
+	static std::vector<ivec3> getBackwardOffsets(Connectivity connectivity);
+
+	/**
+	*	@brief Merges the components of two voxels, linking the larger root to the smaller one.
+	*/
+	static void unite(std::vector<std::atomic<unsigned>>& parent, unsigned cellIndex1, unsigned cellIndex2);
+
+public:
+	/**
+	*	@brief Labels MAX and MIN voxels of the grid into connected components and summarizes each one.
+	*/
+	static void label(RegularGrid* grid, Connectivity connectivity, std::vector<Hotspot>& hotspots);
+
+	/**
+	*	@brief Removes hotspots with fewer voxels than minVoxels or a different peak type (negative peakType keeps both).
+	*/
+	static void filter(std::vector<Hotspot>& hotspots, unsigned minVoxels, int peakType = -1);
+
+	/**
+	*	@brief Sorts hotspots in descending order of the given criterion. By peak temperature, MAX hotspots are listed first from the hottest peak,
+	*	followed by MIN hotspots from the coldest one.
+	*/
+	static void sort(std::vector<Hotspot>& hotspots, SortCriterion criterion);
+};
@@ -0,0 +1,345 @@
+#include "stdafx.h"
+#include "KdTree.h"
+
+#include "Utilities/ThreadPool.h"
+
+// Initialization of static attributes
+const unsigned KdTree::LEAF_SIZE = 32;
+const unsigned KdTree::INVALID_INDEX = std::numeric_limits<unsigned>::max();
+const unsigned KdTree::QUERY_BLOCK_SIZE = 4096;
+
+/// [Public methods]
+
+KdTree::QueryStats& KdTree::QueryStats::operator+=(const QueryStats& stats)
+{
+	_visitedNodes += stats._visitedNodes;
+	_visitedLeaves += stats._visitedLeaves;
+	_distanceTests += stats._distanceTests;
+	_numNeighbors += stats._numNeighbors;
+
+	return *this;
+}
+
+KdTree::KdTree(const std::vector<vec4>& points)
+{
+	this->build(points.size(), [&points](size_t pointIdx) { return vec3(points[pointIdx]); });
+}
+
+KdTree::KdTree(const PackedPoints& points)
+{
+	this->build(points.size(), [&points](size_t pointIdx) { return points.getPoint(pointIdx); });
+}
+
+KdTree::~KdTree()
+{
+}
+
+void KdTree::knnSearch(const vec3& query, unsigned k, unsigned* neighbors, float* distances2, QueryStats* stats) const
+{
+	struct StackEntry
+	{
+		unsigned	_node;
+		float		_minDistance2;
+	};
+
+	QueryStats queryStats;
+	StackEntry stack[64];
+	unsigned stackSize = 0, numFound = 0;
+	const float queryCoord[3] = { query.x, query.y, query.z };
+
+	// Max-heap on distance over the first numFound slots
+	auto worstDistance2 = [&]() { return numFound < k ? std::numeric_limits<float>::max() : distances2[0]; };
+
+	stack[stackSize++] = StackEntry{ 0, .0f };
+
+	while (stackSize && k)
+	{
+		const StackEntry entry = stack[--stackSize];
+		if (entry._minDistance2 > worstDistance2()) continue;
+
+		++queryStats._visitedNodes;
+
+		if (entry._node >= _firstLeaf)
+		{
+			const unsigned leafIdx = entry._node - _firstLeaf;
+			++queryStats._visitedLeaves;
+
+			for (size_t pointIdx = _leafOffset[leafIdx]; pointIdx < _leafOffset[leafIdx + 1]; ++pointIdx)
+			{
+				const float dx = _x[pointIdx] - query.x, dy = _y[pointIdx] - query.y, dz = _z[pointIdx] - query.z;
+				const float distance2 = dx * dx + dy * dy + dz * dz;
+				++queryStats._distanceTests;
+
+				if (distance2 >= worstDistance2()) continue;
+
+				// Sift up into the heap, or replace its root and sift down
+				unsigned slot;
+				if (numFound < k)
+				{
+					slot = numFound++;
+					while (slot > 0 && distances2[(slot - 1) / 2] < distance2)
+					{
+						distances2[slot] = distances2[(slot - 1) / 2]; neighbors[slot] = neighbors[(slot - 1) / 2];
+						slot = (slot - 1) / 2;
+					}
+				}
+				else
+				{
+					slot = 0;
+					while (true)
+					{
+						unsigned child = slot * 2 + 1;
+						if (child >= numFound) break;
+						if (child + 1 < numFound && distances2[child + 1] > distances2[child]) ++child;
+						if (distances2[child] <= distance2) break;
+
+						distances2[slot] = distances2[child]; neighbors[slot] = neighbors[child];
+						slot = child;
+					}
+				}
+
+				distances2[slot] = distance2;
+				neighbors[slot] = _pointIndex[pointIdx];
+			}
+		}
+		else
+		{
+			const float difference = queryCoord[_splitAxis[entry._node]] - _splitValue[entry._node];
+			const unsigned nearChild = entry._node * 2 + (difference < .0f ? 1 : 2), farChild = entry._node * 2 + (difference < .0f ? 2 : 1);
+
+			stack[stackSize++] = StackEntry{ farChild, std::max(entry._minDistance2, difference * difference) };
+			stack[stackSize++] = StackEntry{ nearChild, entry._minDistance2 };
+		}
+	}
+
+	// Heap is sorted in place by popping its root to the back
+	for (unsigned heapSize = numFound; heapSize > 1; --heapSize)
+	{
+		std::swap(distances2[0], distances2[heapSize - 1]); std::swap(neighbors[0], neighbors[heapSize - 1]);
+
+		unsigned slot = 0;
+		while (true)
+		{
+			unsigned child = slot * 2 + 1;
+			if (child >= heapSize - 1) break;
+			if (child + 1 < heapSize - 1 && distances2[child + 1] > distances2[child]) ++child;
+			if (distances2[child] <= distances2[slot]) break;
+
+			std::swap(distances2[slot], distances2[child]); std::swap(neighbors[slot], neighbors[child]);
+			slot = child;
+		}
+	}
+
+	for (unsigned slot = numFound; slot < k; ++slot)
+	{
+		neighbors[slot] = INVALID_INDEX;
+		distances2[slot] = std::numeric_limits<float>::max();
+	}
+
+	queryStats._numNeighbors = numFound;
+	if (stats) *stats = queryStats;
+}
+
+void KdTree::knnSearch(const std::vector<vec4>& queries, unsigned k, std::vector<unsigned>& neighbors, std::vector<float>& distances2, std::vector<QueryStats>* stats) const
+{
+	neighbors.resize(queries.size() * k);
+	distances2.resize(queries.size() * k);
+	if (stats) stats->resize(queries.size());
+
+	ThreadPool::getInstance()->parallelFor((queries.size() + QUERY_BLOCK_SIZE - 1) / QUERY_BLOCK_SIZE, [&](size_t blockIdx)
+	{
+		for (size_t queryIdx = blockIdx * QUERY_BLOCK_SIZE; queryIdx < std::min(queries.size(), (blockIdx + 1) * QUERY_BLOCK_SIZE); ++queryIdx)
+		{
+			this->knnSearch(vec3(queries[queryIdx]), k, &neighbors[queryIdx * k], &distances2[queryIdx * k], stats ? &(*stats)[queryIdx] : nullptr);
+		}
+	});
+}
+
+void KdTree::radiusSearch(const vec3& query, float radius, std::vector<unsigned>& neighbors, QueryStats* stats) const
+{
+	struct StackEntry
+	{
+		unsigned	_node;
+		float		_minDistance2;
+	};
+
+	QueryStats queryStats;
+	StackEntry stack[64];
+	unsigned stackSize = 0;
+	const float radius2 = radius * radius;
+	const float queryCoord[3] = { query.x, query.y, query.z };
+	const size_t numNeighbors = neighbors.size();
+
+	stack[stackSize++] = StackEntry{ 0, .0f };
+
+	while (stackSize)
+	{
+		const StackEntry entry = stack[--stackSize];
+		if (entry._minDistance2 > radius2) continue;
+
+		++queryStats._visitedNodes;
+
+		if (entry._node >= _firstLeaf)
+		{
+			this->scanLeaf(entry._node - _firstLeaf, query, radius2, neighbors, queryStats);
+		}
+		else
+		{
+			const float difference = queryCoord[_splitAxis[entry._node]] - _splitValue[entry._node];
+			const unsigned nearChild = entry._node * 2 + (difference < .0f ? 1 : 2), farChild = entry._node * 2 + (difference < .0f ? 2 : 1);
+
+			stack[stackSize++] = StackEntry{ farChild, std::max(entry._minDistance2, difference * difference) };
+			stack[stackSize++] = StackEntry{ nearChild, entry._minDistance2 };
+		}
+	}
+
+	queryStats._numNeighbors = unsigned(neighbors.size() - numNeighbors);
+	if (stats) *stats = queryStats;
+}
+
+void KdTree::radiusSearch(const std::vector<vec4>& queries, float radius, std::vector<size_t>& neighborOffset, std::vector<unsigned>& neighbors, std::vector<QueryStats>* stats) const
+{
+	const size_t numBlocks = (queries.size() + QUERY_BLOCK_SIZE - 1) / QUERY_BLOCK_SIZE;
+	std::vector<std::vector<unsigned>> blockNeighbors(numBlocks);
+
+	neighborOffset.resize(queries.size() + 1);
+	neighborOffset[0] = 0;
+	if (stats) stats->resize(queries.size());
+
+	// Each block gathers its own results; counts are then scanned to place them in a single array
+	ThreadPool::getInstance()->parallelFor(numBlocks, [&](size_t blockIdx)
+	{
+		for (size_t queryIdx = blockIdx * QUERY_BLOCK_SIZE; queryIdx < std::min(queries.size(), (blockIdx + 1) * QUERY_BLOCK_SIZE); ++queryIdx)
+		{
+			const size_t previousSize = blockNeighbors[blockIdx].size();
+			this->radiusSearch(vec3(queries[queryIdx]), radius, blockNeighbors[blockIdx], stats ? &(*stats)[queryIdx] : nullptr);
+			neighborOffset[queryIdx + 1] = blockNeighbors[blockIdx].size() - previousSize;
+		}
+	});
+
+	std::partial_sum(neighborOffset.begin(), neighborOffset.end(), neighborOffset.begin());
+	neighbors.resize(neighborOffset.back());
+
+	ThreadPool::getInstance()->parallelFor(numBlocks, [&](size_t blockIdx)
+	{
+		std::copy(blockNeighbors[blockIdx].begin(), blockNeighbors[blockIdx].end(), neighbors.begin() + neighborOffset[blockIdx * QUERY_BLOCK_SIZE]);
+		std::vector<unsigned>().swap(blockNeighbors[blockIdx]);
+	});
+}
+
+size_t KdTree::getMemoryFootprint() const
+{
+	return _leafOffset.size() * sizeof(size_t) + _splitAxis.size() * sizeof(uint8_t) + _splitValue.size() * sizeof(float) +
+		(_x.size() + _y.size() + _z.size()) * sizeof(float) + _pointIndex.size() * sizeof(unsigned);
+}
+
+/// [Protected methods]
+
+void KdTree::build(size_t numPoints, const std::function<vec3(size_t)>& getPoint)
+{
+	struct BuildPoint
+	{
+		float		_position[3];
+		unsigned	_index;
+	};
+
+	ThreadPool* threadPool = ThreadPool::getInstance();
+
+	_depth = 0;
+	while ((size_t(LEAF_SIZE) << _depth) < numPoints) ++_depth;
+
+	const unsigned numLeaves = 1u << _depth;
+	_firstLeaf = numLeaves - 1;
+	_splitAxis.resize(_firstLeaf);
+	_splitValue.resize(_firstLeaf);
+
+	// Points are partitioned as 16-byte records, which is friendlier than indirect access through an index array
+	std::vector<BuildPoint> buildPoints(numPoints);
+	threadPool->parallelFor((numPoints + QUERY_BLOCK_SIZE - 1) / QUERY_BLOCK_SIZE, [&](size_t blockIdx)
+	{
+		for (size_t pointIdx = blockIdx * QUERY_BLOCK_SIZE; pointIdx < std::min(numPoints, (blockIdx + 1) * QUERY_BLOCK_SIZE); ++pointIdx)
+		{
+			const vec3 position = getPoint(pointIdx);
+			buildPoints[pointIdx] = BuildPoint{ { position.x, position.y, position.z }, unsigned(pointIdx) };
+		}
+	});
+
+	// Level by level, every node of a level is an independent task
+	std::vector<size_t> levelBegin{ 0 }, levelEnd{ numPoints }, nextBegin, nextEnd;
+
+	for (unsigned level = 0; level < _depth; ++level)
+	{
+		const unsigned numNodes = 1u << level, firstNode = numNodes - 1;
+		nextBegin.resize(numNodes * 2); nextEnd.resize(numNodes * 2);
+
+		threadPool->parallelFor(numNodes, [&](size_t nodeIdx)
+		{
+			const size_t begin = levelBegin[nodeIdx], end = levelEnd[nodeIdx], mid = begin + (end - begin) / 2;
+			const unsigned node = firstNode + unsigned(nodeIdx);
+			vec3 minPoint(std::numeric_limits<float>::max()), maxPoint(-std::numeric_limits<float>::max());
+
+			for (size_t pointIdx = begin; pointIdx < end; ++pointIdx)
+			{
+				const vec3 position(buildPoints[pointIdx]._position[0], buildPoints[pointIdx]._position[1], buildPoints[pointIdx]._position[2]);
+				minPoint = glm::min(minPoint, position);
+				maxPoint = glm::max(maxPoint, position);
+			}
+
+			const vec3 extent = maxPoint - minPoint;
+			const uint8_t axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+			auto compare = [axis](const BuildPoint& point1, const BuildPoint& point2) { return point1._position[axis] < point2._position[axis]; };
+
+			if (mid < end)
+			{
+				if (numNodes < threadPool->getNumThreads())
+					std::nth_element(std::execution::par, buildPoints.begin() + begin, buildPoints.begin() + mid, buildPoints.begin() + end, compare);
+				else
+					std::nth_element(buildPoints.begin() + begin, buildPoints.begin() + mid, buildPoints.begin() + end, compare);
+			}
+
+			_splitAxis[node] = axis;
+			_splitValue[node] = mid < end ? buildPoints[mid]._position[axis] : .0f;
+			nextBegin[nodeIdx * 2] = begin; nextEnd[nodeIdx * 2] = mid;
+			nextBegin[nodeIdx * 2 + 1] = mid; nextEnd[nodeIdx * 2 + 1] = end;
+		});
+
+		std::swap(levelBegin, nextBegin);
+		std::swap(levelEnd, nextEnd);
+	}
+
+	_leafOffset.resize(numLeaves + 1);
+	std::copy(levelBegin.begin(), levelBegin.end(), _leafOffset.begin());
+	_leafOffset[numLeaves] = numPoints;
+
+	// Leaf order is final, so coordinates are split into separate arrays
+	_x.resize(numPoints); _y.resize(numPoints); _z.resize(numPoints); _pointIndex.resize(numPoints);
+
+	threadPool->parallelFor((numPoints + QUERY_BLOCK_SIZE - 1) / QUERY_BLOCK_SIZE, [&](size_t blockIdx)
+	{
+		for (size_t pointIdx = blockIdx * QUERY_BLOCK_SIZE; pointIdx < std::min(numPoints, (blockIdx + 1) * QUERY_BLOCK_SIZE); ++pointIdx)
+		{
+			_x[pointIdx] = buildPoints[pointIdx]._position[0];
+			_y[pointIdx] = buildPoints[pointIdx]._position[1];
+			_z[pointIdx] = buildPoints[pointIdx]._position[2];
+			_pointIndex[pointIdx] = buildPoints[pointIdx]._index;
+		}
+	});
+}
+
+void KdTree::scanLeaf(unsigned leafIdx, const vec3& query, float radius2, std::vector<unsigned>& neighbors, QueryStats& stats) const
+{
+	const size_t begin = _leafOffset[leafIdx], end = _leafOffset[leafIdx + 1];
+	++stats._visitedLeaves;
+	stats._distanceTests += unsigned(end - begin);
+
+	// Coordinates are stored as separate contiguous arrays, so a leaf is scanned without gathering whole points
+	for (size_t pointIdx = begin; pointIdx < end; ++pointIdx)
+	{
+		const float dx = _x[pointIdx] - query.x, dy = _y[pointIdx] - query.y, dz = _z[pointIdx] - query.z;
+
+		if (dx * dx + dy * dy + dz * dz <= radius2)
+		{
+			neighbors.push_back(_pointIndex[pointIdx]);
+		}
+	}
+}
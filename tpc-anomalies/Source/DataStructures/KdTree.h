@@ -0,0 +1,119 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include "DataStructures/PackedPoints.h"
+
+/**
+*	@file KdTree.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Implicit k-d tree over a point cloud. Nodes are stored in breadth-first order (children of i are 2i + 1 and 2i + 2),
+*	every leaf is at the same depth and leaf points are kept as separate coordinate arrays.
+*/
+class KdTree
+{
+public:
+	const static unsigned	LEAF_SIZE;							//!< Maximum number of points per leaf
+	const static unsigned	INVALID_INDEX;						//!< Marks empty slots of k-NN results
+
+	/**
+	*	@brief Work done by a single query.
+	*/
+	struct QueryStats
+	{
+		unsigned	_visitedNodes;								//!< Internal nodes and leaves popped from the traversal stack
+		unsigned	_visitedLeaves;								//!< Leaves whose points were tested
+		unsigned	_distanceTests;								//!< Point-to-query distances computed
+		unsigned	_numNeighbors;								//!< Points returned
+
+		/**
+		*	@brief Default constructor.
+		*/
+		QueryStats() : _visitedNodes(0), _visitedLeaves(0), _distanceTests(0), _numNeighbors(0) {}
+
+		/**
+		*	@brief Accumulates the work of another query.
+		*/
+		QueryStats& operator+=(const QueryStats& stats);
+	};
+
+protected:
+	const static unsigned	QUERY_BLOCK_SIZE;					//!< Number of queries solved by a single task in batched queries
+
+protected:
+	unsigned				_depth;								//!< Depth of leaves
+	unsigned				_firstLeaf;							//!< Node index of the first leaf
+	std::vector<size_t>		_leafOffset;						//!< Range of each leaf within the point arrays (numLeaves + 1)
+	std::vector<uint8_t>	_splitAxis;							//!< Split axis of internal nodes
+	std::vector<float>		_splitValue;						//!< Split coordinate of internal nodes
+
+	// Points in leaf order
+	std::vector<float>		_x, _y, _z;							//!< Coordinates
+	std::vector<unsigned>	_pointIndex;						//!< Index of each point in the original cloud
+
+protected:
+	/**
+	*	@brief Builds the tree over the positions returned for each point index.
+	*/
+	void build(size_t numPoints, const std::function<vec3(size_t)>& getPoint);
+
+	/**
+	*	@brief Tests every point of a leaf against a radius and appends those within it.
+	*/
+	void scanLeaf(unsigned leafIdx, const vec3& query, float radius2, std::vector<unsigned>& neighbors, QueryStats& stats) const;
+
+public:
+	/**
+	*	@brief Builds the tree over the xyz coordinates of the given points.
+	*/
+	KdTree(const std::vector<vec4>& points);
+
+	/**
+	*	@brief Builds the tree over packed points, which are expanded while they are copied into the tree.
+	*/
+	KdTree(const PackedPoints& points);
+
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~KdTree();
+
+	/**
+	*	@brief Retrieves the k nearest points to the query, sorted by distance. Missing neighbours are filled with INVALID_INDEX.
+	*/
+	void knnSearch(const vec3& query, unsigned k, unsigned* neighbors, float* distances2, QueryStats* stats = nullptr) const;
+
+	/**
+	*	@brief Batched k-NN across threads. Results of query i are stored at [i * k, (i + 1) * k).
+	*/
+	void knnSearch(const std::vector<vec4>& queries, unsigned k, std::vector<unsigned>& neighbors, std::vector<float>& distances2, std::vector<QueryStats>* stats = nullptr) const;
+
+	/**
+	*	@brief Retrieves every point within the given radius of the query (unsorted).
+	*/
+	void radiusSearch(const vec3& query, float radius, std::vector<unsigned>& neighbors, QueryStats* stats = nullptr) const;
+
+	/**
+	*	@brief Batched radius search across threads. Neighbours of query i are stored at [neighborOffset[i], neighborOffset[i + 1]).
+	*/
+	void radiusSearch(const std::vector<vec4>& queries, float radius, std::vector<size_t>& neighborOffset, std::vector<unsigned>& neighbors, std::vector<QueryStats>* stats = nullptr) const;
+
+	/**
+	*	@return Number of indexed points.
+	*/
+	size_t getNumPoints() const { return _pointIndex.size(); }
+
+	/**
+	*	@return Number of leaves.
+	*/
+	size_t getNumLeaves() const { return _leafOffset.size() - 1; }
+
+	/**
+	*	@return Resident memory of the tree, in bytes.
+	*/
+	size_t getMemoryFootprint() const;
+};
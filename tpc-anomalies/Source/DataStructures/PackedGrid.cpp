@@ -0,0 +1,246 @@
+#include "stdafx.h"
+#include "PackedGrid.h"
+
+#include "Utilities/ThreadPool.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define PACKED_GRID_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Initialization of static attributes
+const unsigned PackedGrid::WORDS_PER_RANK_BLOCK = 8;
+const unsigned PackedGrid::PEAKS_PER_WORD = 32;
+const unsigned PackedGrid::QUANTIZATION_LEVELS = 65535;
+
+/// [Public methods]
+
+PackedGrid::PackedGrid(RegularGrid* grid, bool quantizeThermal) :
+	_aabb(grid->getAABB()), _frame(grid->getFrame()), _offset(grid->getOffset()), _numDivs(grid->getNumSubdivisions()), _thermalMin(.0f), _thermalStep(.0f)
+{
+	// Tasks cover whole rank blocks, and every occupancy word maps to two peak words
+	const size_t numVoxels = this->length(), numWords = (numVoxels + 63) / 64, numRankBlocks = (numWords + WORDS_PER_RANK_BLOCK - 1) / WORDS_PER_RANK_BLOCK;
+	const size_t wordsPerTask = WORDS_PER_RANK_BLOCK * 128, numTasks = (numWords + wordsPerTask - 1) / wordsPerTask;
+	const uint16_t* voxel = grid->data();
+	const std::vector<float>& localPeak = *grid->localPeak();
+	const std::vector<float>& thermal = *grid->thermalData();
+	const std::vector<unsigned>& pointCount = *grid->pointCount();
+
+	_occupancy.resize(numWords);
+	_peak.resize(numWords * 2);
+	_rank.resize(numRankBlocks + 1);
+
+	ThreadPool::getInstance()->parallelFor(numTasks, [&](size_t taskIdx)
+	{
+		for (size_t wordIdx = taskIdx * wordsPerTask; wordIdx < std::min(numWords, (taskIdx + 1) * wordsPerTask); ++wordIdx)
+		{
+			const size_t firstVoxel = wordIdx * 64, lastVoxel = std::min(numVoxels, firstVoxel + 64);
+			uint64_t occupancy = 0, peak[2] = { 0, 0 };
+
+			for (size_t voxelIdx = firstVoxel; voxelIdx < lastVoxel; ++voxelIdx)
+			{
+				const size_t bit = voxelIdx - firstVoxel;
+
+				occupancy |= uint64_t(voxel[voxelIdx] != VOXEL_EMPTY) << bit;
+				if (!localPeak.empty()) peak[bit / PEAKS_PER_WORD] |= (uint64_t(localPeak[voxelIdx]) & 3) << (bit % PEAKS_PER_WORD * 2);
+			}
+
+			_occupancy[wordIdx] = occupancy;
+			_peak[wordIdx * 2] = peak[0];
+			_peak[wordIdx * 2 + 1] = peak[1];
+		}
+
+		for (size_t rankBlockIdx = taskIdx * wordsPerTask / WORDS_PER_RANK_BLOCK; rankBlockIdx < std::min(numRankBlocks, (taskIdx + 1) * wordsPerTask / WORDS_PER_RANK_BLOCK); ++rankBlockIdx)
+		{
+			uint32_t blockCount = 0;
+			for (size_t wordIdx = rankBlockIdx * WORDS_PER_RANK_BLOCK; wordIdx < std::min(numWords, (rankBlockIdx + 1) * WORDS_PER_RANK_BLOCK); ++wordIdx)
+				blockCount += PackedGrid::popcount(_occupancy[wordIdx]);
+
+			_rank[rankBlockIdx + 1] = blockCount;
+		}
+	});
+
+	for (size_t rankBlockIdx = 1; rankBlockIdx <= numRankBlocks; ++rankBlockIdx) _rank[rankBlockIdx] += _rank[rankBlockIdx - 1];
+
+	// Per-voxel values of occupied voxels are stored at their rank
+	const size_t numOccupied = this->count();
+	std::vector<float> occupiedThermal(numOccupied);
+	_pointCount.resize(numOccupied);
+
+	ThreadPool::getInstance()->parallelFor(numTasks, [&](size_t taskIdx)
+	{
+		size_t rank = _rank[taskIdx * wordsPerTask / WORDS_PER_RANK_BLOCK];
+
+		for (size_t wordIdx = taskIdx * wordsPerTask; wordIdx < std::min(numWords, (taskIdx + 1) * wordsPerTask); ++wordIdx)
+		{
+			for (uint64_t word = _occupancy[wordIdx]; word; word &= word - 1, ++rank)
+			{
+				const size_t voxelIdx = wordIdx * 64 + PackedGrid::lowestBit(word);
+
+				occupiedThermal[rank] = thermal[voxelIdx];
+				_pointCount[rank] = pointCount[voxelIdx];
+			}
+		}
+	});
+
+	if (!quantizeThermal)
+	{
+		_thermal = std::move(occupiedThermal);
+		return;
+	}
+
+	if (numOccupied)
+	{
+		const auto range = std::minmax_element(occupiedThermal.begin(), occupiedThermal.end());
+		_thermalMin = *range.first;
+		_thermalStep = (*range.second - *range.first) / QUANTIZATION_LEVELS;
+	}
+
+	_quantizedThermal.resize(numOccupied);
+	std::transform(std::execution::par_unseq, occupiedThermal.begin(), occupiedThermal.end(), _quantizedThermal.begin(), [this](float value)
+	{
+		return _thermalStep > .0f ? uint16_t(std::min(float(QUANTIZATION_LEVELS), (value - _thermalMin) / _thermalStep + .5f)) : uint16_t(0);
+	});
+}
+
+PackedGrid::~PackedGrid()
+{
+}
+
+size_t PackedGrid::getMemoryFootprint() const
+{
+	return _occupancy.size() * sizeof(uint64_t) + _peak.size() * sizeof(uint64_t) + _pointCount.size() * sizeof(unsigned) + _quantizedThermal.size() * sizeof(uint16_t) +
+		_rank.size() * sizeof(uint32_t) + _thermal.size() * sizeof(float);
+}
+
+size_t PackedGrid::rank(size_t index) const
+{
+	const size_t wordIdx = index >> 6;
+	size_t rank = _rank[wordIdx / WORDS_PER_RANK_BLOCK];
+
+	for (size_t previousWordIdx = wordIdx / WORDS_PER_RANK_BLOCK * WORDS_PER_RANK_BLOCK; previousWordIdx < wordIdx; ++previousWordIdx)
+		rank += PackedGrid::popcount(_occupancy[previousWordIdx]);
+
+	if (index & 63) rank += PackedGrid::popcount(_occupancy[wordIdx] & ((uint64_t(1) << (index & 63)) - 1));
+
+	return rank;
+}
+
+size_t PackedGrid::select(size_t rank) const
+{
+	// Last rank block which starts at or before the requested rank
+	const size_t rankBlockIdx = std::upper_bound(_rank.begin(), _rank.end() - 1, uint32_t(rank)) - _rank.begin() - 1;
+	size_t wordIdx = rankBlockIdx * WORDS_PER_RANK_BLOCK, remaining = rank - _rank[rankBlockIdx];
+
+	for (unsigned wordCount; remaining >= (wordCount = PackedGrid::popcount(_occupancy[wordIdx])); ++wordIdx) remaining -= wordCount;
+
+	uint64_t word = _occupancy[wordIdx];
+	for (; remaining; --remaining) word &= word - 1;
+
+	return wordIdx * 64 + PackedGrid::lowestBit(word);
+}
+
+RegularGrid* PackedGrid::unpack() const
+{
+	RegularGrid* grid = new RegularGrid(_aabb, _numDivs, _frame);
+	grid->setOffset(_offset);
+	grid->_localPeak = std::vector<float>(grid->length(), LOCAL_PEAK_NONE);
+
+	ThreadPool::getInstance()->parallelFor(_rank.size() - 1, [&](size_t rankBlockIdx)
+	{
+		size_t rank = _rank[rankBlockIdx];
+
+		for (size_t wordIdx = rankBlockIdx * WORDS_PER_RANK_BLOCK; wordIdx < std::min(_occupancy.size(), (rankBlockIdx + 1) * WORDS_PER_RANK_BLOCK); ++wordIdx)
+		{
+			for (uint64_t word = _occupancy[wordIdx]; word; word &= word - 1, ++rank)
+			{
+				const size_t voxelIdx = wordIdx * 64 + PackedGrid::lowestBit(word);
+
+				grid->_grid[voxelIdx] = VOXEL_FREE;
+				grid->_thermal[voxelIdx] = this->getThermal(rank);
+				grid->_pointCount[voxelIdx] = _pointCount[rank];
+				grid->_localPeak[voxelIdx] = this->getPeak(voxelIdx);
+			}
+		}
+	});
+
+	return grid;
+}
+
+void PackedGrid::unpackPeaks(std::vector<float>& compactValues) const
+{
+	compactValues.resize(this->count());
+
+	ThreadPool::getInstance()->parallelFor(_rank.size() - 1, [&](size_t rankBlockIdx)
+	{
+		size_t rank = _rank[rankBlockIdx];
+
+		for (size_t wordIdx = rankBlockIdx * WORDS_PER_RANK_BLOCK; wordIdx < std::min(_occupancy.size(), (rankBlockIdx + 1) * WORDS_PER_RANK_BLOCK); ++wordIdx)
+		{
+			for (uint64_t word = _occupancy[wordIdx]; word; word &= word - 1, ++rank)
+				compactValues[rank] = this->getPeak(wordIdx * 64 + PackedGrid::lowestBit(word));
+		}
+	});
+}
+
+void PackedGrid::unpackThermal(std::vector<float>& compactValues) const
+{
+	if (_quantizedThermal.empty())
+	{
+		compactValues = _thermal;
+		return;
+	}
+
+	// Occupied voxels are already stored in grid order, so this is a plain dequantization of the whole array
+	const size_t numOccupied = _quantizedThermal.size(), blockSize = 1 << 16;
+	compactValues.resize(numOccupied);
+
+	ThreadPool::getInstance()->parallelFor((numOccupied + blockSize - 1) / blockSize, [&](size_t blockIdx)
+	{
+		const size_t lastIdx = std::min(numOccupied, (blockIdx + 1) * blockSize);
+		size_t valueIdx = blockIdx * blockSize;
+
+#ifdef PACKED_GRID_SSE2
+		const __m128 minValue = _mm_set1_ps(_thermalMin), step = _mm_set1_ps(_thermalStep);
+		const __m128i zero = _mm_setzero_si128();
+
+		for (; valueIdx + 8 <= lastIdx; valueIdx += 8)
+		{
+			const __m128i levels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&_quantizedThermal[valueIdx]));
+			const __m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(levels, zero)), high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(levels, zero));
+
+			_mm_storeu_ps(&compactValues[valueIdx], _mm_add_ps(minValue, _mm_mul_ps(low, step)));
+			_mm_storeu_ps(&compactValues[valueIdx + 4], _mm_add_ps(minValue, _mm_mul_ps(high, step)));
+		}
+#endif
+
+		for (; valueIdx < lastIdx; ++valueIdx) compactValues[valueIdx] = this->getThermal(valueIdx);
+	});
+}
+
+/// [Protected methods]
+
+unsigned PackedGrid::lowestBit(uint64_t word)
+{
+#ifdef _MSC_VER
+	unsigned long bit;
+	_BitScanForward64(&bit, word);
+
+	return unsigned(bit);
+#else
+	return unsigned(__builtin_ctzll(word));
+#endif
+}
+
+unsigned PackedGrid::popcount(uint64_t word)
+{
+#ifdef _MSC_VER
+	return unsigned(__popcnt64(word));
+#else
+	return unsigned(__builtin_popcountll(word));
+#endif
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "DataStructures/RegularGrid.h"
+
+/**
+*	@file PackedGrid.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Compact, read-only copy of a point cloud grid. Occupancy is a bitset with rank/select support, peak types take 2 bits per voxel,
+*	and temperatures and point counts are only kept for occupied voxels, indexed by their rank. Temperatures may also be quantized to 16 bits.
+*/
+class PackedGrid
+{
+protected:
+	const static unsigned		WORDS_PER_RANK_BLOCK;				//!< Occupancy words covered by each rank entry
+	const static unsigned		PEAKS_PER_WORD;						//!< Peak types packed into a word
+	const static unsigned		QUANTIZATION_LEVELS;				//!< Highest quantized temperature
+
+protected:
+	AABB						_aabb;								//!< Space covered by the grid, in grid space
+	mat4						_frame;								//!< Transformation from grid space to world space
+	glm::dvec3					_offset;							//!< Translation from world space to georeferenced coordinates
+	uvec3						_numDivs;							//!< Grid dimensions
+	std::vector<uint64_t>		_occupancy;							//!< One bit per voxel, set if it is not empty
+	std::vector<uint64_t>		_peak;								//!< Two bits per voxel, LOCAL_PEAK_NONE, LOCAL_PEAK_MIN or LOCAL_PEAK_MAX
+	std::vector<unsigned>		_pointCount;						//!< Points binned into each occupied voxel
+	std::vector<uint16_t>		_quantizedThermal;					//!< Temperature of each occupied voxel, if quantized
+	std::vector<uint32_t>		_rank;								//!< Occupied voxels before each block of WORDS_PER_RANK_BLOCK words, plus the total
+	std::vector<float>			_thermal;							//!< Temperature of each occupied voxel, if not quantized
+	float						_thermalMin;						//!< Temperature of quantized level zero
+	float						_thermalStep;						//!< Temperature difference between consecutive quantized levels
+
+protected:
+	/**
+	*	@return Number of set bits.
+	*/
+	static unsigned popcount(uint64_t word);
+
+	/**
+	*	@return Position of the lowest set bit of a non-zero word.
+	*/
+	static unsigned lowestBit(uint64_t word);
+
+public:
+	/**
+	*	@brief Packs the channels of a filled grid.
+	*	@param quantizeThermal Temperatures are stored as 16-bit levels between the grid minimum and maximum.
+	*/
+	PackedGrid(RegularGrid* grid, bool quantizeThermal);
+
+	/**
+	*	@brief Invalid copy constructor.
+	*/
+	PackedGrid(const PackedGrid& packedGrid) = delete;
+
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~PackedGrid();
+
+	/**
+	*	@return Number of occupied voxels.
+	*/
+	size_t count() const { return _rank.back(); }
+
+	/**
+	*	@return Bounding box of the grid.
+	*/
+	AABB getAABB() const { return _aabb; }
+
+	/**
+	*	@return Transformation from grid space to world space.
+	*/
+	mat4 getFrame() const { return _frame; }
+
+	/**
+	*	@return Translation from world space to georeferenced coordinates.
+	*/
+	glm::dvec3 getOffset() const { return _offset; }
+
+	/**
+	*	@return Bytes held by the packed channels.
+	*/
+	size_t getMemoryFootprint() const;
+
+	/**
+	*	@return Grid dimensions.
+	*/
+	uvec3 getNumSubdivisions() const { return _numDivs; }
+
+	/**
+	*	@return Peak type of a voxel.
+	*/
+	uint8_t getPeak(size_t index) const { return uint8_t((_peak[index / PEAKS_PER_WORD] >> (index % PEAKS_PER_WORD * 2)) & 3); }
+
+	/**
+	*	@return Temperature of an occupied voxel, given its rank.
+	*/
+	float getThermal(size_t rank) const { return _quantizedThermal.empty() ? _thermal[rank] : _thermalMin + _quantizedThermal[rank] * _thermalStep; }
+
+	/**
+	*	@return True if the voxel is not empty.
+	*/
+	bool isOccupied(size_t index) const { return (_occupancy[index >> 6] >> (index & 63)) & 1; }
+
+	/**
+	*	@return True if temperatures are quantized.
+	*/
+	bool isQuantized() const { return !_quantizedThermal.empty(); }
+
+	/**
+	*	@return Number of voxels.
+	*/
+	size_t length() const { return size_t(_numDivs.x) * _numDivs.y * _numDivs.z; }
+
+	/**
+	*	@return Number of occupied voxels before the given index.
+	*/
+	size_t rank(size_t index) const;
+
+	/**
+	*	@return Index of the occupied voxel with the given rank, which must be lower than count().
+	*/
+	size_t select(size_t rank) const;
+
+	/**
+	*	@return Full grid with the packed channels, e.g., to be exported.
+	*/
+	RegularGrid* unpack() const;
+
+	/**
+	*	@brief Retrieves the peak type of occupied voxels in grid order, i.e., the order of RegularGrid::compact.
+	*/
+	void unpackPeaks(std::vector<float>& compactValues) const;
+
+	/**
+	*	@brief Retrieves the temperature of occupied voxels in grid order, i.e., the order of RegularGrid::compact.
+	*/
+	void unpackThermal(std::vector<float>& compactValues) const;
+};
@@ -0,0 +1,208 @@
+#include "stdafx.h"
+#include "PackedPoints.h"
+
+#include "DataStructures/GridCache.h"
+#include "Utilities/ThreadPool.h"
+
+// Initialization of static attributes
+const unsigned PackedPoints::BLOCK_BITS = 16;
+const size_t PackedPoints::BLOCK_SIZE = size_t(1) << PackedPoints::BLOCK_BITS;
+const unsigned PackedPoints::COORDINATE_BITS = 21;
+const uint64_t PackedPoints::COORDINATE_MASK = (uint64_t(1) << PackedPoints::COORDINATE_BITS) - 1;
+const uint32_t PackedPoints::FILE_MAGIC = 0x50435054;				// TPCP
+const uint32_t PackedPoints::FILE_VERSION = 1;
+const unsigned PackedPoints::THERMAL_LEVELS = 65535;
+
+/// [Public methods]
+
+PackedPoints::PackedPoints()
+{
+}
+
+PackedPoints::~PackedPoints()
+{
+}
+
+void PackedPoints::clear()
+{
+	std::vector<Block>().swap(_block);
+	std::vector<uint64_t>().swap(_position);
+	std::vector<uint8_t>().swap(_rgb);
+	std::vector<uint16_t>().swap(_thermal);
+}
+
+size_t PackedPoints::compact(const std::vector<uint8_t>& keep)
+{
+	const size_t numBlocks = _block.size();
+	std::vector<size_t> blockOffset(numBlocks + 1, 0);
+
+	ThreadPool::getInstance()->parallelFor(numBlocks, [&](size_t blockIdx)
+	{
+		const size_t firstPoint = blockIdx * BLOCK_SIZE, lastPoint = std::min(_position.size(), firstPoint + BLOCK_SIZE);
+		blockOffset[blockIdx + 1] = size_t(std::count_if(keep.begin() + firstPoint, keep.begin() + lastPoint, [](uint8_t flag) { return flag != 0; }));
+	});
+
+	std::partial_sum(blockOffset.begin(), blockOffset.end(), blockOffset.begin());
+	if (blockOffset.back() == _position.size()) return _position.size();
+
+	// Blocks would otherwise span points which were never together, hence kept points are expanded and packed again
+	std::vector<vec4> points(blockOffset.back());
+	std::vector<vec3> rgb(blockOffset.back());
+	std::vector<float> thermal(blockOffset.back());
+
+	ThreadPool::getInstance()->parallelFor(numBlocks, [&](size_t blockIdx)
+	{
+		size_t outputIdx = blockOffset[blockIdx];
+
+		for (size_t pointIdx = blockIdx * BLOCK_SIZE; pointIdx < std::min(_position.size(), (blockIdx + 1) * BLOCK_SIZE); ++pointIdx)
+		{
+			if (!keep[pointIdx]) continue;
+
+			this->decode(pointIdx, 1, &points[outputIdx], &rgb[outputIdx], &thermal[outputIdx]);
+			++outputIdx;
+		}
+	});
+
+	this->pack(points, rgb, thermal);
+
+	return _position.size();
+}
+
+void PackedPoints::decode(size_t firstPoint, size_t numPoints, vec4* points, vec3* rgb, float* thermal) const
+{
+	const size_t lastPoint = std::min(_position.size(), firstPoint + numPoints);
+
+	for (size_t pointIdx = firstPoint; pointIdx < lastPoint; ++pointIdx)
+	{
+		const size_t outputIdx = pointIdx - firstPoint;
+
+		if (points) points[outputIdx] = vec4(this->getPoint(pointIdx), 1.0f);
+		if (rgb) rgb[outputIdx] = this->getColor(pointIdx);
+		if (thermal) thermal[outputIdx] = this->getThermal(pointIdx);
+	}
+}
+
+AABB PackedPoints::getAABB() const
+{
+	// Blocks span the box of their own points, whose corners are quantized exactly
+	AABB aabb;
+	for (const Block& block : _block) aabb.update(AABB(block._origin, block._origin + block._step * float(COORDINATE_MASK)));
+
+	return aabb;
+}
+
+size_t PackedPoints::getMemoryFootprint() const
+{
+	return _block.size() * sizeof(Block) + _position.size() * sizeof(uint64_t) + _rgb.size() * sizeof(uint8_t) + _thermal.size() * sizeof(uint16_t);
+}
+
+uint64_t PackedPoints::hashBlock(size_t blockIdx, uint64_t seed) const
+{
+	const size_t firstPoint = blockIdx * BLOCK_SIZE, blockPoints = std::min(_position.size(), firstPoint + BLOCK_SIZE) - firstPoint;
+
+	seed = GridCache::hash(&_block[blockIdx], sizeof(Block), seed);
+	seed = GridCache::hash(&_position[firstPoint], blockPoints * sizeof(uint64_t), seed);
+
+	return GridCache::hash(&_thermal[firstPoint], blockPoints * sizeof(uint16_t), seed);
+}
+
+void PackedPoints::pack(const std::vector<vec4>& points, const std::vector<vec3>& rgb, const std::vector<float>& thermal)
+{
+	const size_t numPoints = points.size(), numBlocks = (numPoints + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	const bool hasColor = rgb.size() == numPoints;
+
+	_block.resize(numBlocks);
+	_position.resize(numPoints);
+	_rgb.resize(numPoints * 3);
+	_thermal.resize(numPoints);
+
+	ThreadPool::getInstance()->parallelFor(numBlocks, [&](size_t blockIdx)
+	{
+		const size_t firstPoint = blockIdx * BLOCK_SIZE;
+		this->encodeBlock(blockIdx, &points[firstPoint], hasColor ? &rgb[firstPoint] : nullptr, &thermal[firstPoint]);
+	});
+}
+
+bool PackedPoints::read(std::istream& stream)
+{
+	uint32_t magic = 0, version = 0;
+	uint64_t numPoints = 0;
+
+	stream.read((char*)&magic, sizeof(uint32_t));
+	stream.read((char*)&version, sizeof(uint32_t));
+	stream.read((char*)&numPoints, sizeof(uint64_t));
+
+	if (!stream || magic != FILE_MAGIC || version != FILE_VERSION) return false;
+
+	_block.resize((numPoints + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	_position.resize(numPoints);
+	_rgb.resize(numPoints * 3);
+	_thermal.resize(numPoints);
+
+	stream.read((char*)_block.data(), _block.size() * sizeof(Block));
+	stream.read((char*)_position.data(), _position.size() * sizeof(uint64_t));
+	stream.read((char*)_rgb.data(), _rgb.size() * sizeof(uint8_t));
+	stream.read((char*)_thermal.data(), _thermal.size() * sizeof(uint16_t));
+
+	if (!stream)
+	{
+		this->clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool PackedPoints::write(std::ostream& stream) const
+{
+	const uint64_t numPoints = _position.size();
+
+	stream.write((const char*)&FILE_MAGIC, sizeof(uint32_t));
+	stream.write((const char*)&FILE_VERSION, sizeof(uint32_t));
+	stream.write((const char*)&numPoints, sizeof(uint64_t));
+	stream.write((const char*)_block.data(), _block.size() * sizeof(Block));
+	stream.write((const char*)_position.data(), _position.size() * sizeof(uint64_t));
+	stream.write((const char*)_rgb.data(), _rgb.size() * sizeof(uint8_t));
+	stream.write((const char*)_thermal.data(), _thermal.size() * sizeof(uint16_t));
+
+	return bool(stream);
+}
+
+/// [Protected methods]
+
+void PackedPoints::encodeBlock(size_t blockIdx, const vec4* points, const vec3* rgb, const float* thermal)
+{
+	const size_t firstPoint = blockIdx * BLOCK_SIZE, blockPoints = std::min(_position.size(), firstPoint + BLOCK_SIZE) - firstPoint;
+	vec3 minPoint(std::numeric_limits<float>::max()), maxPoint(-std::numeric_limits<float>::max());
+	float minThermal = std::numeric_limits<float>::max(), maxThermal = -std::numeric_limits<float>::max();
+
+	for (size_t pointIdx = 0; pointIdx < blockPoints; ++pointIdx)
+	{
+		minPoint = glm::min(minPoint, vec3(points[pointIdx]));
+		maxPoint = glm::max(maxPoint, vec3(points[pointIdx]));
+		minThermal = std::min(minThermal, thermal[pointIdx]);
+		maxThermal = std::max(maxThermal, thermal[pointIdx]);
+	}
+
+	// Each block spans its own box, so precision follows the extent of the block rather than that of the cloud
+	Block& block = _block[blockIdx];
+	block._origin = minPoint;
+	block._step = (maxPoint - minPoint) / float(COORDINATE_MASK);
+	block._thermalMin = minThermal;
+	block._thermalStep = (maxThermal - minThermal) / THERMAL_LEVELS;
+
+	const vec3 inverseStep(block._step.x > .0f ? 1.0f / block._step.x : .0f, block._step.y > .0f ? 1.0f / block._step.y : .0f, block._step.z > .0f ? 1.0f / block._step.z : .0f);
+	const float inverseThermalStep = block._thermalStep > .0f ? 1.0f / block._thermalStep : .0f;
+
+	for (size_t pointIdx = 0; pointIdx < blockPoints; ++pointIdx)
+	{
+		const vec3 quantized = glm::clamp((vec3(points[pointIdx]) - minPoint) * inverseStep + .5f, vec3(.0f), vec3(float(COORDINATE_MASK)));
+		const size_t index = firstPoint + pointIdx;
+
+		_position[index] = (uint64_t(quantized.x) << (2 * COORDINATE_BITS)) | (uint64_t(quantized.y) << COORDINATE_BITS) | uint64_t(quantized.z);
+		_thermal[index] = uint16_t(std::min(float(THERMAL_LEVELS), (thermal[pointIdx] - minThermal) * inverseThermalStep + .5f));
+
+		for (unsigned channel = 0; channel < 3; ++channel)
+			_rgb[index * 3 + channel] = rgb ? uint8_t(glm::clamp(rgb[pointIdx][channel], .0f, 1.0f) * 255.0f + .5f) : uint8_t(0);
+	}
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "Geometry/3D/AABB.h"
+
+/**
+*	@file PackedPoints.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Compact storage of the points of a cloud, 13 bytes per point instead of 32. Points are split in blocks of BLOCK_SIZE consecutive points,
+*	and each block quantizes its positions to 21 bits per axis within its own bounding box, and its temperatures to 16 bits within its own range.
+*	Colours are kept as 8-bit channels. Points are expanded on demand, either one at a time or by ranges.
+*/
+class PackedPoints
+{
+public:
+	const static unsigned		BLOCK_BITS;							//!< Log2 of the number of points per block
+	const static size_t			BLOCK_SIZE;							//!< Number of points sharing quantization parameters
+
+protected:
+	const static unsigned		COORDINATE_BITS;					//!< Bits per axis of quantized positions
+	const static uint64_t		COORDINATE_MASK;					//!< Highest quantized coordinate
+	const static uint32_t		FILE_MAGIC;							//!< Identifies binary copies of packed points
+	const static uint32_t		FILE_VERSION;						//!< Binary layout, increased whenever it changes
+	const static unsigned		THERMAL_LEVELS;						//!< Highest quantized temperature
+
+	/**
+	*	@brief Dequantization parameters of a block.
+	*/
+	struct Block
+	{
+		vec3		_origin;										//!< Position of quantized coordinate zero
+		vec3		_step;											//!< Distance between consecutive quantized coordinates along each axis
+		float		_thermalMin;									//!< Temperature of quantized level zero
+		float		_thermalStep;									//!< Temperature difference between consecutive quantized levels
+	};
+
+protected:
+	std::vector<Block>			_block;								//!< Dequantization parameters of each block
+	std::vector<uint64_t>		_position;							//!< Quantized x, y and z, from the highest to the lowest 21 bits
+	std::vector<uint8_t>		_rgb;								//!< Three 8-bit channels per point
+	std::vector<uint16_t>		_thermal;							//!< Quantized temperature of each point
+
+protected:
+	/**
+	*	@brief Quantizes the points of a block, whose first point is given by each pointer.
+	*	@param rgb Colours in [0, 1], or nullptr if there are none.
+	*/
+	void encodeBlock(size_t blockIdx, const vec4* points, const vec3* rgb, const float* thermal);
+
+public:
+	/**
+	*	@brief Constructor of an empty set.
+	*/
+	PackedPoints();
+
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~PackedPoints();
+
+	/**
+	*	@brief Releases every point.
+	*/
+	void clear();
+
+	/**
+	*	@brief Removes the points whose flag is zero, keeping the order of the rest. Kept points are quantized again within their new blocks.
+	*	@param keep One flag per point.
+	*	@return Number of kept points.
+	*/
+	size_t compact(const std::vector<uint8_t>& keep);
+
+	/**
+	*	@brief Expands a range of points. Any destination may be nullptr if it is not needed.
+	*	@param points Positions with w = 1.
+	*/
+	void decode(size_t firstPoint, size_t numPoints, vec4* points, vec3* rgb, float* thermal) const;
+
+	/**
+	*	@return Bounding box of the points, gathered from the boxes of the blocks.
+	*/
+	AABB getAABB() const;
+
+	/**
+	*	@return Colour of a point in [0, 1].
+	*/
+	vec3 getColor(size_t index) const { return vec3(_rgb[index * 3], _rgb[index * 3 + 1], _rgb[index * 3 + 2]) / 255.0f; }
+
+	/**
+	*	@return Bytes held by the packed arrays.
+	*/
+	size_t getMemoryFootprint() const;
+
+	/**
+	*	@return Number of blocks.
+	*/
+	size_t getNumBlocks() const { return _block.size(); }
+
+	/**
+	*	@return Position of a point.
+	*/
+	vec3 getPoint(size_t index) const
+	{
+		const Block& block = _block[index >> BLOCK_BITS];
+		const uint64_t position = _position[index];
+
+		return block._origin + vec3(float(position >> (2 * COORDINATE_BITS)), float((position >> COORDINATE_BITS) & COORDINATE_MASK), float(position & COORDINATE_MASK)) * block._step;
+	}
+
+	/**
+	*	@return Temperature of a point.
+	*/
+	float getThermal(size_t index) const { const Block& block = _block[index >> BLOCK_BITS]; return block._thermalMin + _thermal[index] * block._thermalStep; }
+
+	/**
+	*	@return Hash of the quantized content of a block, chained to the given seed.
+	*/
+	uint64_t hashBlock(size_t blockIdx, uint64_t seed) const;
+
+	/**
+	*	@brief Replaces the content with the given arrays, which are quantized block by block in parallel.
+	*	@param rgb Colours in [0, 1], either one per point or empty.
+	*/
+	void pack(const std::vector<vec4>& points, const std::vector<vec3>& rgb, const std::vector<float>& thermal);
+
+	/**
+	*	@brief Reads a binary copy written by write().
+	*	@return False if the stream does not hold packed points of the current version.
+	*/
+	bool read(std::istream& stream);
+
+	/**
+	*	@return Number of points.
+	*/
+	size_t size() const { return _position.size(); }
+
+	/**
+	*	@brief Writes a binary copy of the packed arrays.
+	*/
+	bool write(std::ostream& stream) const;
+};
+
@@ -0,0 +1,342 @@
+#include "stdafx.h"
+#include "PointDecimation.h"
+
+#include "DataStructures/GridResolution.h"
+#include "Utilities/ThreadPool.h"
+
+// Initialization of static attributes
+const float PointDecimation::BLUE_NOISE_OVERSAMPLING = 2.0f;
+const float PointDecimation::BLUE_NOISE_PACKING = .5f;
+const float PointDecimation::BUDGET_TOLERANCE = 1.1f;
+const unsigned PointDecimation::CELLS_PER_TASK = 256;
+const unsigned PointDecimation::COORDINATE_BITS = 21;
+const unsigned PointDecimation::MAX_BUDGET_ITERATIONS = 3;
+const unsigned PointDecimation::NUM_RANGES = 64;
+
+/// [Public methods]
+
+float PointDecimation::decimate(const PackedPoints& points, const AABB& aabb, size_t budget, CellPoint cellPoint, bool blueNoise, PackedPoints& decimated, TaskProgress* progress)
+{
+	const size_t numPoints = points.size();
+
+	decimated.clear();
+	if (!budget || numPoints <= budget) return .0f;
+
+	// Occupied cells grow as their size to the power of the cloud dimension, hence the size holding numPoints / budget points is extrapolated from the point spacing
+	const GridResolution::Estimate estimate = GridResolution::estimate(points, aabb, 1.0f);
+	float spacing = estimate._pointSpacing * std::pow(float(numPoints) / budget, 1.0f / estimate._dimension);
+
+	std::vector<vec4> decimatedPoints;
+	std::vector<vec3> decimatedRgb;
+	std::vector<float> decimatedThermal;
+
+	// Disks keep fewer points than voxels of the same size, hence they are shrunk to keep about the same count
+	if (blueNoise) spacing *= std::pow(BLUE_NOISE_PACKING, 1.0f / estimate._dimension);
+
+	for (unsigned iteration = 0; iteration < MAX_BUDGET_ITERATIONS; ++iteration)
+	{
+		PointDecimation::voxelGrid(points, aabb, blueNoise ? spacing / BLUE_NOISE_OVERSAMPLING : spacing, cellPoint, decimatedPoints, decimatedRgb, decimatedThermal, progress);
+
+		if (blueNoise)
+		{
+			std::vector<size_t> selected;
+			PointDecimation::poissonDisk(decimatedPoints, aabb, spacing, selected, progress);
+
+			std::vector<vec4> selectedPoints(selected.size());
+			std::vector<vec3> selectedRgb(selected.size());
+			std::vector<float> selectedThermal(selected.size());
+
+			for (size_t selectedIdx = 0; selectedIdx < selected.size(); ++selectedIdx)
+			{
+				selectedPoints[selectedIdx] = decimatedPoints[selected[selectedIdx]];
+				selectedRgb[selectedIdx] = decimatedRgb[selected[selectedIdx]];
+				selectedThermal[selectedIdx] = decimatedThermal[selected[selectedIdx]];
+			}
+
+			decimatedPoints.swap(selectedPoints);
+			decimatedRgb.swap(selectedRgb);
+			decimatedThermal.swap(selectedThermal);
+		}
+
+		if (decimatedPoints.size() <= budget * BUDGET_TOLERANCE) break;
+
+		// The prediction fell short, so cells are enlarged by the same scaling law from the measured count
+		spacing *= std::pow(float(decimatedPoints.size()) / budget, 1.0f / estimate._dimension);
+	}
+
+	decimated.pack(decimatedPoints, decimatedRgb, decimatedThermal);
+
+	return spacing;
+}
+
+void PointDecimation::poissonDisk(const std::vector<vec4>& points, const AABB& aabb, float radius, std::vector<size_t>& selected, TaskProgress* progress)
+{
+	TaskProgress silentProgress(false);
+	if (!progress) progress = &silentProgress;
+
+	const uint64_t coordinateMask = (uint64_t(1) << COORDINATE_BITS) - 1;
+	const size_t numPoints = points.size();
+	const vec3 extent = aabb.size(), origin = aabb.min();
+	const float maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+	const float cellSize = std::max(radius, maxExtent / float(coordinateMask)), inverseCellSize = cellSize > .0f ? 1.0f / cellSize : .0f, radius2 = radius * radius;
+
+	selected.clear();
+	if (!numPoints) return;
+
+	// Candidates are sorted by cell, and then by a scrambled index so that the accepted points do not follow the input order
+	const auto getPriority = [](size_t index) { return uint64_t(index) * 0x9E3779B97F4A7C15ull; };
+	std::vector<std::pair<uint64_t, size_t>> candidate(numPoints);
+
+	ThreadPool::getInstance()->parallelFor((numPoints + PackedPoints::BLOCK_SIZE - 1) / PackedPoints::BLOCK_SIZE, [&](size_t blockIdx)
+	{
+		for (size_t pointIdx = blockIdx * PackedPoints::BLOCK_SIZE; pointIdx < std::min(numPoints, (blockIdx + 1) * PackedPoints::BLOCK_SIZE); ++pointIdx)
+			candidate[pointIdx] = std::make_pair(PointDecimation::getKey(vec3(points[pointIdx]), origin, inverseCellSize), pointIdx);
+	});
+
+	std::sort(std::execution::par_unseq, candidate.begin(), candidate.end(), [&](const std::pair<uint64_t, size_t>& a, const std::pair<uint64_t, size_t>& b)
+	{
+		return a.first < b.first || (a.first == b.first && getPriority(a.second) < getPriority(b.second));
+	});
+
+	std::vector<uint64_t> cellKey;
+	std::vector<size_t> cellStart;
+	std::vector<std::vector<size_t>> phaseCells(27);
+
+	for (size_t candidateIdx = 0; candidateIdx < numPoints; ++candidateIdx)
+	{
+		const uint64_t key = candidate[candidateIdx].first;
+		if (!cellKey.empty() && cellKey.back() == key) continue;
+
+		// Cells of the same phase are at least three cells apart along some axis, hence they never share a neighbour
+		const unsigned phase = unsigned((key >> (2 * COORDINATE_BITS)) % 3) * 9 + unsigned(((key >> COORDINATE_BITS) & coordinateMask) % 3) * 3 + unsigned((key & coordinateMask) % 3);
+		phaseCells[phase].push_back(cellKey.size());
+		cellKey.push_back(key);
+		cellStart.push_back(candidateIdx);
+	}
+
+	cellStart.push_back(numPoints);
+
+	std::vector<uint8_t> accepted(numPoints, 0);
+
+	progress->beginStage("Thinning into blue noise", numPoints, "points");
+
+	for (const std::vector<size_t>& cells : phaseCells)
+	{
+		ThreadPool::getInstance()->parallelFor((cells.size() + CELLS_PER_TASK - 1) / CELLS_PER_TASK, [&](size_t taskIdx)
+		{
+			std::vector<std::pair<size_t, size_t>> neighborRange;
+			size_t numCandidates = 0;
+
+			progress->checkpoint();
+
+			for (size_t cellIdx = taskIdx * CELLS_PER_TASK; cellIdx < std::min(cells.size(), (taskIdx + 1) * size_t(CELLS_PER_TASK)); ++cellIdx)
+			{
+				const size_t cell = cells[cellIdx];
+				const ivec3 coordinates = ivec3(int(cellKey[cell] >> (2 * COORDINATE_BITS)), int((cellKey[cell] >> COORDINATE_BITS) & coordinateMask), int(cellKey[cell] & coordinateMask));
+
+				// Neighbours of other phases are either finished or untouched, whereas this cell is only written by this task
+				neighborRange.clear();
+				for (int x = -1; x <= 1; ++x)
+				{
+					for (int y = -1; y <= 1; ++y)
+					{
+						for (int z = -1; z <= 1; ++z)
+						{
+							const ivec3 neighbor = coordinates + ivec3(x, y, z);
+							if (glm::any(glm::lessThan(neighbor, ivec3(0))) || glm::any(glm::greaterThan(neighbor, ivec3(int(coordinateMask))))) continue;
+
+							const uint64_t neighborKey = (uint64_t(neighbor.x) << (2 * COORDINATE_BITS)) | (uint64_t(neighbor.y) << COORDINATE_BITS) | uint64_t(neighbor.z);
+							const auto neighborCell = std::lower_bound(cellKey.begin(), cellKey.end(), neighborKey);
+							if (neighborCell == cellKey.end() || *neighborCell != neighborKey) continue;
+
+							const size_t neighborIdx = neighborCell - cellKey.begin();
+							neighborRange.emplace_back(cellStart[neighborIdx], cellStart[neighborIdx + 1]);
+						}
+					}
+				}
+
+				for (size_t candidateIdx = cellStart[cell]; candidateIdx < cellStart[cell + 1]; ++candidateIdx)
+				{
+					const vec3 position = vec3(points[candidate[candidateIdx].second]);
+					bool isFar = true;
+
+					for (const std::pair<size_t, size_t>& range : neighborRange)
+					{
+						for (size_t neighborIdx = range.first; neighborIdx < range.second && isFar; ++neighborIdx)
+						{
+							if (!accepted[neighborIdx]) continue;
+
+							const vec3 difference = vec3(points[candidate[neighborIdx].second]) - position;
+							isFar = glm::dot(difference, difference) >= radius2;
+						}
+
+						if (!isFar) break;
+					}
+
+					accepted[candidateIdx] = isFar;
+				}
+
+				numCandidates += cellStart[cell + 1] - cellStart[cell];
+			}
+
+			progress->advance(numCandidates);
+		});
+	}
+
+	progress->endStage();
+
+	for (size_t candidateIdx = 0; candidateIdx < numPoints; ++candidateIdx)
+	{
+		if (accepted[candidateIdx]) selected.push_back(candidate[candidateIdx].second);
+	}
+}
+
+void PointDecimation::voxelGrid(const PackedPoints& input, const AABB& aabb, float cellSize, CellPoint cellPoint, std::vector<vec4>& points, std::vector<vec3>& rgb, std::vector<float>& thermal, TaskProgress* progress)
+{
+	TaskProgress silentProgress(false);
+	if (!progress) progress = &silentProgress;
+
+	// Cells are enlarged if the box does not fit in the keys
+	const size_t numPoints = input.size(), numBlocks = input.getNumBlocks();
+	const vec3 extent = aabb.size(), origin = aabb.min();
+	const float maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+	cellSize = std::max(cellSize, maxExtent / float((uint64_t(1) << COORDINATE_BITS) - 1));
+
+	const float inverseCellSize = cellSize > .0f ? 1.0f / cellSize : .0f;
+	const vec3 halfCell(cellSize * .5f);
+	std::vector<std::vector<Cell>> rangeCells(NUM_RANGES);
+
+	progress->beginStage("Hashing voxels", numPoints, "points");
+
+	// Consecutive points are usually close, so each range only touches a fraction of the voxels
+	ThreadPool::getInstance()->parallelFor(NUM_RANGES, [&](size_t rangeIdx)
+	{
+		std::unordered_map<uint64_t, Cell> cellMap;
+		Cell* lastCell = nullptr;
+
+		for (size_t blockIdx = rangeIdx * numBlocks / NUM_RANGES; blockIdx < (rangeIdx + 1) * numBlocks / NUM_RANGES; ++blockIdx)
+		{
+			const size_t firstPoint = blockIdx * PackedPoints::BLOCK_SIZE, lastPoint = std::min(numPoints, firstPoint + PackedPoints::BLOCK_SIZE);
+			progress->checkpoint();
+
+			for (size_t pointIdx = firstPoint; pointIdx < lastPoint; ++pointIdx)
+			{
+				const vec3 position = input.getPoint(pointIdx);
+				const uint64_t key = PointDecimation::getKey(position, origin, inverseCellSize);
+				const vec3 relative = position - PointDecimation::getCorner(key, origin, cellSize);
+
+				// Consecutive points often fall in the same voxel, whose element stays valid while the map grows
+				if (!lastCell || lastCell->_key != key) lastCell = &cellMap.try_emplace(key, Cell{ key, vec3(.0f), vec3(.0f), .0f, std::numeric_limits<float>::max(), 0 }).first->second;
+
+				Cell& cell = *lastCell;
+				++cell._count;
+
+				if (cellPoint == AVERAGE)
+				{
+					cell._position += relative;
+					cell._rgb += input.getColor(pointIdx);
+					cell._thermal += input.getThermal(pointIdx);
+				}
+				else
+				{
+					const vec3 toCenter = relative - halfCell;
+					const float distance2 = glm::dot(toCenter, toCenter);
+
+					if (distance2 < cell._distance2)
+					{
+						cell._position = relative;
+						cell._rgb = input.getColor(pointIdx);
+						cell._thermal = input.getThermal(pointIdx);
+						cell._distance2 = distance2;
+					}
+				}
+			}
+
+			progress->advance(lastPoint - firstPoint);
+		}
+
+		std::vector<Cell>& cells = rangeCells[rangeIdx];
+		cells.reserve(cellMap.size());
+		for (const auto& pair : cellMap) cells.push_back(pair.second);
+	});
+
+	progress->endStage();
+
+	// Cells of every range are merged in range order, so that sums and ties do not depend on thread scheduling
+	size_t numCells = 0;
+	for (const std::vector<Cell>& cells : rangeCells) numCells += cells.size();
+
+	std::vector<Cell> cells;
+	cells.reserve(numCells);
+
+	for (std::vector<Cell>& partialCells : rangeCells)
+	{
+		cells.insert(cells.end(), partialCells.begin(), partialCells.end());
+		std::vector<Cell>().swap(partialCells);
+	}
+
+	std::stable_sort(std::execution::par, cells.begin(), cells.end(), [](const Cell& a, const Cell& b) { return a._key < b._key; });
+
+	std::vector<size_t> voxelStart;
+	for (size_t cellIdx = 0; cellIdx < cells.size(); ++cellIdx)
+	{
+		if (!cellIdx || cells[cellIdx]._key != cells[cellIdx - 1]._key) voxelStart.push_back(cellIdx);
+	}
+
+	voxelStart.push_back(cells.size());
+
+	const size_t numVoxels = voxelStart.size() - 1;
+	points.resize(numVoxels);
+	rgb.resize(numVoxels);
+	thermal.resize(numVoxels);
+
+	ThreadPool::getInstance()->parallelFor((numVoxels + PackedPoints::BLOCK_SIZE - 1) / PackedPoints::BLOCK_SIZE, [&](size_t blockIdx)
+	{
+		for (size_t voxelIdx = blockIdx * PackedPoints::BLOCK_SIZE; voxelIdx < std::min(numVoxels, (blockIdx + 1) * PackedPoints::BLOCK_SIZE); ++voxelIdx)
+		{
+			Cell voxel = cells[voxelStart[voxelIdx]];
+
+			for (size_t cellIdx = voxelStart[voxelIdx] + 1; cellIdx < voxelStart[voxelIdx + 1]; ++cellIdx)
+			{
+				const Cell& cell = cells[cellIdx];
+
+				if (cellPoint == AVERAGE)
+				{
+					voxel._position += cell._position;
+					voxel._rgb += cell._rgb;
+					voxel._thermal += cell._thermal;
+				}
+				else if (cell._distance2 < voxel._distance2)
+				{
+					voxel._position = cell._position;
+					voxel._rgb = cell._rgb;
+					voxel._thermal = cell._thermal;
+					voxel._distance2 = cell._distance2;
+				}
+
+				voxel._count += cell._count;
+			}
+
+			const float weight = cellPoint == AVERAGE ? 1.0f / voxel._count : 1.0f;
+			points[voxelIdx] = vec4(PointDecimation::getCorner(voxel._key, origin, cellSize) + voxel._position * weight, 1.0f);
+			rgb[voxelIdx] = voxel._rgb * weight;
+			thermal[voxelIdx] = voxel._thermal * weight;
+		}
+	});
+}
+
+/// [Protected methods]
+
+vec3 PointDecimation::getCorner(uint64_t key, const vec3& origin, float cellSize)
+{
+	const uint64_t coordinateMask = (uint64_t(1) << COORDINATE_BITS) - 1;
+
+	return origin + vec3(float(key >> (2 * COORDINATE_BITS)), float((key >> COORDINATE_BITS) & coordinateMask), float(key & coordinateMask)) * cellSize;
+}
+
+uint64_t PointDecimation::getKey(const vec3& position, const vec3& origin, float inverseCellSize)
+{
+	const uvec3 cell = uvec3(glm::clamp((position - origin) * inverseCellSize, vec3(.0f), vec3(float((uint64_t(1) << COORDINATE_BITS) - 1))));
+
+	return (uint64_t(cell.x) << (2 * COORDINATE_BITS)) | (uint64_t(cell.y) << COORDINATE_BITS) | uint64_t(cell.z);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "DataStructures/PackedPoints.h"
+#include "Geometry/3D/AABB.h"
+#include "Utilities/TaskProgress.h"
+
+/**
+*	@file PointDecimation.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Reduces a cloud to a budget of points, e.g., for a fast preview while the whole cloud is kept for the analysis. Points are gathered
+*	into the cells of a hashed voxel grid, which keep a single point each, and these may be further thinned into a blue-noise (Poisson-disk) set.
+*/
+class PointDecimation
+{
+public:
+	enum CellPoint : uint8_t
+	{
+		NEAREST_TO_CENTER, AVERAGE
+	};
+
+protected:
+	/**
+	*	@brief Point kept by a voxel, either the nearest one to its centre or the sum of its points. Positions are relative to the lower corner.
+	*/
+	struct Cell
+	{
+		uint64_t	_key;											//!< Cell coordinates, 21 bits per axis
+		vec3		_position;										//!< Position of the nearest point or sum of positions
+		vec3		_rgb;											//!< Colour of the nearest point or sum of colours
+		float		_thermal;										//!< Temperature of the nearest point or sum of temperatures
+		float		_distance2;										//!< Squared distance from the nearest point to the cell centre
+		unsigned	_count;											//!< Number of points gathered by the cell
+	};
+
+protected:
+	const static float		BLUE_NOISE_OVERSAMPLING;				//!< Ratio of the disk radius to the voxel size of the candidates thinned by the Poisson-disk pass
+	const static float		BLUE_NOISE_PACKING;						//!< Points kept by a Poisson-disk set per voxel of the same size on scanned surfaces
+	const static float		BUDGET_TOLERANCE;						//!< Excess over the budget which is accepted before cells are enlarged
+	const static unsigned	CELLS_PER_TASK;							//!< Cells of the same phase thinned by a single task of the Poisson-disk pass
+	const static unsigned	COORDINATE_BITS;						//!< Bits per axis of cell keys
+	const static unsigned	MAX_BUDGET_ITERATIONS;					//!< Maximum number of times cells are enlarged to meet the budget
+	const static unsigned	NUM_RANGES;								//!< Number of point ranges hashed independently, fixed so that results do not depend on the number of threads
+
+protected:
+	/**
+	*	@return Key of the cell of a position.
+	*/
+	static uint64_t getKey(const vec3& position, const vec3& origin, float inverseCellSize);
+
+	/**
+	*	@return Lower corner of the cell of a key.
+	*/
+	static vec3 getCorner(uint64_t key, const vec3& origin, float cellSize);
+
+public:
+	/**
+	*	@brief Reduces a cloud to about the given number of points. The voxel size is predicted from the scaling of occupied cells with their size,
+	*	and enlarged if the prediction falls short.
+	*	@param aabb Bounding box of the cloud.
+	*	@param blueNoise Voxels are thinned into a Poisson-disk set whose radius keeps about the same number of points.
+	*	@param decimated Destination of the reduced cloud, which is cleared if the cloud already fits the budget.
+	*	@return Spacing of the reduced cloud, i.e., the voxel size or the disk radius.
+	*/
+	static float decimate(const PackedPoints& points, const AABB& aabb, size_t budget, CellPoint cellPoint, bool blueNoise, PackedPoints& decimated, TaskProgress* progress = nullptr);
+
+	/**
+	*	@brief Selects a subset of points where no two of them are closer than the given radius. Points are tested in a pseudo-random order within
+	*	cells of the radius size, and cells are processed in 27 phases of cells which are at least three cells apart, hence cells of the same phase
+	*	are thinned in parallel without sharing any neighbour.
+	*	@param selected Indices of the selected points, in the order of the cells.
+	*/
+	static void poissonDisk(const std::vector<vec4>& points, const AABB& aabb, float radius, std::vector<size_t>& selected, TaskProgress* progress = nullptr);
+
+	/**
+	*	@brief Keeps a single point per occupied voxel, either the nearest one to the voxel centre or the average of its points. Several ranges
+	*	of points are hashed in parallel and their cells merged afterwards, so that the memory depends on the number of occupied voxels.
+	*	@param aabb Bounding box of the cloud.
+	*	@param points Positions of the kept points, sorted by voxel.
+	*/
+	static void voxelGrid(const PackedPoints& input, const AABB& aabb, float cellSize, CellPoint cellPoint, std::vector<vec4>& points, std::vector<vec3>& rgb, std::vector<float>& thermal, TaskProgress* progress = nullptr);
+};
+
@@ -0,0 +1,202 @@
+#include "stdafx.h"
+#include "PointFilter.h"
+
+#include "Utilities/ThreadPool.h"
+
+// Initialization of static attributes
+const unsigned PointFilter::CELLS_PER_TASK = 256;
+const unsigned PointFilter::COORDINATE_BITS = 21;
+const unsigned PointFilter::OUTLIER_BLOCK_SIZE = 4096;
+
+/// [Public methods]
+
+size_t PointFilter::flagDuplicates(const PackedPoints& points, const AABB& aabb, float tolerance, std::vector<uint8_t>& keep, TaskProgress* progress)
+{
+	TaskProgress silentProgress(false);
+	if (!progress) progress = &silentProgress;
+
+	const uint64_t coordinateMask = (uint64_t(1) << COORDINATE_BITS) - 1;
+	const size_t numPoints = points.size(), numBlocks = points.getNumBlocks();
+	const vec3 extent = aabb.size(), origin = aabb.min();
+	const float maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+
+	// Packed copies of the same point differ by up to a quantization step, which is never larger than the extent split by the key resolution
+	tolerance = std::max(tolerance, maxExtent / float(coordinateMask));
+
+	// Cells as large as the tolerance, so that kept points within the tolerance of a point lie in its cell or in a neighbouring one
+	const float inverseCellSize = tolerance > .0f ? 1.0f / tolerance : .0f, tolerance2 = tolerance * tolerance;
+
+	keep.assign(numPoints, 1);
+	if (!numPoints) return 0;
+
+	// Entries are sorted by cell and then by index, hence the points of a cell are tested in the order of the cloud
+	std::vector<std::pair<uint64_t, unsigned>> entry(numPoints);
+
+	progress->beginStage("Removing duplicates", numPoints, "points");
+
+	ThreadPool::getInstance()->parallelFor(numBlocks, [&](size_t blockIdx)
+	{
+		for (size_t pointIdx = blockIdx * PackedPoints::BLOCK_SIZE; pointIdx < std::min(numPoints, (blockIdx + 1) * PackedPoints::BLOCK_SIZE); ++pointIdx)
+		{
+			const uvec3 cell = uvec3(glm::clamp((points.getPoint(pointIdx) - origin) * inverseCellSize, vec3(.0f), vec3(float(coordinateMask))));
+			entry[pointIdx] = std::make_pair((uint64_t(cell.x) << (2 * COORDINATE_BITS)) | (uint64_t(cell.y) << COORDINATE_BITS) | uint64_t(cell.z), unsigned(pointIdx));
+		}
+	});
+
+	progress->checkpoint();
+	std::sort(std::execution::par_unseq, entry.begin(), entry.end());
+
+	std::vector<uint64_t> cellKey;
+	std::vector<size_t> cellStart;
+	std::vector<std::vector<size_t>> phaseCells(27);
+
+	for (size_t entryIdx = 0; entryIdx < numPoints; ++entryIdx)
+	{
+		const uint64_t key = entry[entryIdx].first;
+		if (!cellKey.empty() && cellKey.back() == key) continue;
+
+		// Same schedule as PointDecimation::poissonDisk: cells of the same phase are at least three cells apart along some axis
+		const unsigned phase = unsigned((key >> (2 * COORDINATE_BITS)) % 3) * 9 + unsigned(((key >> COORDINATE_BITS) & coordinateMask) % 3) * 3 + unsigned((key & coordinateMask) % 3);
+		phaseCells[phase].push_back(cellKey.size());
+		cellKey.push_back(key);
+		cellStart.push_back(entryIdx);
+	}
+
+	cellStart.push_back(numPoints);
+
+	// Points are only compared with kept points, so that a run of close points which are not duplicates of each other is thinned rather than removed
+	std::vector<uint8_t> kept(numPoints, 0);
+
+	for (const std::vector<size_t>& cells : phaseCells)
+	{
+		ThreadPool::getInstance()->parallelFor((cells.size() + CELLS_PER_TASK - 1) / CELLS_PER_TASK, [&](size_t taskIdx)
+		{
+			std::vector<std::pair<size_t, size_t>> neighborRange;
+			size_t numEntries = 0;
+
+			progress->checkpoint();
+
+			for (size_t cellIdx = taskIdx * CELLS_PER_TASK; cellIdx < std::min(cells.size(), (taskIdx + 1) * size_t(CELLS_PER_TASK)); ++cellIdx)
+			{
+				const size_t cell = cells[cellIdx];
+				const ivec3 coordinates = ivec3(int(cellKey[cell] >> (2 * COORDINATE_BITS)), int((cellKey[cell] >> COORDINATE_BITS) & coordinateMask), int(cellKey[cell] & coordinateMask));
+
+				// Neighbours of other phases are either finished or untouched, whereas this cell is only written by this task
+				neighborRange.clear();
+				for (int x = -1; x <= 1; ++x)
+				{
+					for (int y = -1; y <= 1; ++y)
+					{
+						for (int z = -1; z <= 1; ++z)
+						{
+							const ivec3 neighbor = coordinates + ivec3(x, y, z);
+							if (glm::any(glm::lessThan(neighbor, ivec3(0))) || glm::any(glm::greaterThan(neighbor, ivec3(int(coordinateMask))))) continue;
+
+							const uint64_t neighborKey = (uint64_t(neighbor.x) << (2 * COORDINATE_BITS)) | (uint64_t(neighbor.y) << COORDINATE_BITS) | uint64_t(neighbor.z);
+							const auto neighborCell = std::lower_bound(cellKey.begin(), cellKey.end(), neighborKey);
+							if (neighborCell == cellKey.end() || *neighborCell != neighborKey) continue;
+
+							const size_t neighborIdx = neighborCell - cellKey.begin();
+							neighborRange.emplace_back(cellStart[neighborIdx], cellStart[neighborIdx + 1]);
+						}
+					}
+				}
+
+				for (size_t entryIdx = cellStart[cell]; entryIdx < cellStart[cell + 1]; ++entryIdx)
+				{
+					const vec3 point = points.getPoint(entry[entryIdx].second);
+					bool duplicate = false;
+
+					for (const std::pair<size_t, size_t>& range : neighborRange)
+					{
+						for (size_t neighborIdx = range.first; neighborIdx < range.second && !duplicate; ++neighborIdx)
+						{
+							if (kept[neighborIdx]) duplicate = glm::distance2(point, points.getPoint(entry[neighborIdx].second)) <= tolerance2;
+						}
+
+						if (duplicate) break;
+					}
+
+					kept[entryIdx] = !duplicate;
+					keep[entry[entryIdx].second] = !duplicate;
+				}
+
+				numEntries += cellStart[cell + 1] - cellStart[cell];
+			}
+
+			progress->advance(numEntries);
+		});
+	}
+
+	progress->endStage();
+
+	return size_t(std::count(std::execution::par_unseq, kept.begin(), kept.end(), uint8_t(0)));
+}
+
+size_t PointFilter::flagOutliers(const PackedPoints& points, const KdTree& kdTree, unsigned numNeighbors, float stdFactor, std::vector<uint8_t>& keep, TaskProgress* progress)
+{
+	TaskProgress silentProgress(false);
+	if (!progress) progress = &silentProgress;
+
+	const size_t numPoints = points.size(), numBlocks = (numPoints + OUTLIER_BLOCK_SIZE - 1) / OUTLIER_BLOCK_SIZE;
+	std::vector<float> meanDistance(numPoints, .0f);
+
+	keep.assign(numPoints, 1);
+	if (numPoints <= numNeighbors || !numNeighbors) return 0;
+
+	progress->beginStage("Removing outliers", numPoints, "points");
+
+	// Sums are accumulated in double precision, as they gather every point of the cloud
+	const glm::dvec2 moments = ThreadPool::getInstance()->parallelReduce(numBlocks, glm::dvec2(.0), [&](size_t blockIdx)
+	{
+		std::vector<unsigned> nearest(numNeighbors + 1);
+		std::vector<float> distances2(numNeighbors + 1);
+		glm::dvec2 moments(.0);
+
+		progress->checkpoint();
+
+		for (size_t pointIdx = blockIdx * OUTLIER_BLOCK_SIZE; pointIdx < std::min(numPoints, (blockIdx + 1) * OUTLIER_BLOCK_SIZE); ++pointIdx)
+		{
+			// One more neighbour is requested, as the point itself is found as well
+			kdTree.knnSearch(points.getPoint(pointIdx), numNeighbors + 1, nearest.data(), distances2.data());
+
+			float sum = .0f;
+			unsigned count = 0;
+
+			for (unsigned neighborIdx = 0; neighborIdx <= numNeighbors && count < numNeighbors; ++neighborIdx)
+			{
+				if (nearest[neighborIdx] == KdTree::INVALID_INDEX || nearest[neighborIdx] == pointIdx) continue;
+
+				sum += std::sqrt(distances2[neighborIdx]);
+				++count;
+			}
+
+			meanDistance[pointIdx] = count ? sum / count : .0f;
+			moments += glm::dvec2(meanDistance[pointIdx], double(meanDistance[pointIdx]) * meanDistance[pointIdx]);
+		}
+
+		progress->advance(std::min(numPoints, (blockIdx + 1) * OUTLIER_BLOCK_SIZE) - blockIdx * OUTLIER_BLOCK_SIZE);
+
+		return moments;
+	}, [](glm::dvec2& accumulated, glm::dvec2& partial) { accumulated += partial; });
+
+	const double mean = moments.x / numPoints, deviation = std::sqrt(std::max(.0, moments.y / numPoints - mean * mean));
+	const float threshold = float(mean + stdFactor * deviation);
+
+	const size_t numOutliers = ThreadPool::getInstance()->parallelReduce(numBlocks, size_t(0), [&](size_t blockIdx)
+	{
+		size_t numOutliers = 0;
+
+		for (size_t pointIdx = blockIdx * OUTLIER_BLOCK_SIZE; pointIdx < std::min(numPoints, (blockIdx + 1) * OUTLIER_BLOCK_SIZE); ++pointIdx)
+		{
+			keep[pointIdx] = meanDistance[pointIdx] <= threshold;
+			numOutliers += !keep[pointIdx];
+		}
+
+		return numOutliers;
+	}, [](size_t& accumulated, size_t& partial) { accumulated += partial; });
+
+	progress->endStage();
+
+	return numOutliers;
+}
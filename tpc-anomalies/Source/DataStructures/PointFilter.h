@@ -0,0 +1,46 @@
+#pragma once
+
+#include "DataStructures/KdTree.h"
+#include "DataStructures/PackedPoints.h"
+#include "Geometry/3D/AABB.h"
+#include "Utilities/TaskProgress.h"
+
+/**
+*	@file PointFilter.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Cleaning of a cloud before it is binned. Overlapping stations yield duplicated points, which bias voxel means towards the overlaps,
+*	whereas flying pixels lie away from any surface and show up as false anomalies. Points are flagged in parallel, so that they can be removed
+*	afterwards by a stable compaction.
+*/
+class PointFilter
+{
+protected:
+	const static unsigned	CELLS_PER_TASK;							//!< Cells searched for duplicates by a single task
+	const static unsigned	COORDINATE_BITS;						//!< Bits per axis of cell keys
+	const static unsigned	OUTLIER_BLOCK_SIZE;						//!< Number of points whose neighbours are searched by a single task
+
+public:
+	/**
+	*	@brief Flags points which lie within the given distance of a kept point, so that no two kept points are closer than the tolerance while
+	*	every removed point has a kept one nearby. Points are hashed into cells as large as the tolerance and decided in the same 27-phase schedule
+	*	as PointDecimation::poissonDisk, hence cells of a phase are processed in parallel and the result does not depend on the thread count.
+	*	@param aabb Bounding box of the cloud.
+	*	@param tolerance Maximum distance between duplicates, zero for points which are equal up to the precision of packed points.
+	*	@param keep Zero for duplicates and one otherwise, one per point.
+	*	@return Number of duplicates.
+	*/
+	static size_t flagDuplicates(const PackedPoints& points, const AABB& aabb, float tolerance, std::vector<uint8_t>& keep, TaskProgress* progress = nullptr);
+
+	/**
+	*	@brief Flags points whose mean distance to their nearest neighbours exceeds the mean of every point by more than stdFactor deviations.
+	*	@param kdTree Spatial index over the same points.
+	*	@param keep Zero for outliers and one otherwise, one per point.
+	*	@return Number of outliers.
+	*/
+	static size_t flagOutliers(const PackedPoints& points, const KdTree& kdTree, unsigned numNeighbors, float stdFactor, std::vector<uint8_t>& keep, TaskProgress* progress = nullptr);
+};
+
@@ -1,23 +1,33 @@
 #include "stdafx.h"
 #include "RegularGrid.h"
 
-#include "Graphics/Application/Renderer.h"
 #include "Graphics/Application/RenderingParameters.h"
 #include "Graphics/Core/OpenGLUtilities.h"
 #include "Graphics/Core/ShaderList.h"
+#include "DataStructures/BVH.h"
+#include "DataStructures/VoxelPass.h"
+#include "Geometry/3D/Intersections3D.h"
 #include "tinyply/tinyply.h"
 
+// Initialization of static attributes
+const unsigned RegularGrid::DIRTY_BRICK_SIZE = 16;
+const unsigned RegularGrid::THERMAL_HISTOGRAM_BINS = 256;
+const float RegularGrid::MAD_TO_STD = 1.4826f;
+const unsigned RegularGrid::ORIENTATION_SAMPLE_SIZE = 1 << 17;
+const unsigned RegularGrid::VOXELIZATION_BATCH_SIZE = 1 << 12;
+const float RegularGrid::VISIBILITY_OFFSET = 1e-3f;
+
 /// Public methods
 
-RegularGrid::RegularGrid(const AABB& aabb, uvec3 subdivisions) :
-	_aabb(aabb), _numDivs(subdivisions)
+RegularGrid::RegularGrid(const AABB& aabb, uvec3 subdivisions, const mat4& frame) :
+	_anomalySearch{ -1 }, _aabb(aabb), _frame(frame), _inverseFrame(glm::inverse(frame)), _offset(.0), _numDivs(subdivisions)
 {
 	_cellSize = vec3((_aabb.max().x - _aabb.min().x) / float(subdivisions.x), (_aabb.max().y - _aabb.min().y) / float(subdivisions.y), (_aabb.max().z - _aabb.min().z) / float(subdivisions.z));
 
 	this->buildGrid();
 }
 
-RegularGrid::RegularGrid(uvec3 subdivisions) : _numDivs(subdivisions)
+RegularGrid::RegularGrid(uvec3 subdivisions) : _anomalySearch{ -1 }, _frame(1.0f), _inverseFrame(1.0f), _offset(.0), _numDivs(subdivisions)
 {
 	
 }
@@ -26,55 +36,79 @@ RegularGrid::~RegularGrid()
 {
 }
 
-void RegularGrid::exportGrid(bool fillUnderVoxels)
+void RegularGrid::exportGrid(bool fillUnderVoxels, TaskProgress* progress)
 {
-	struct VoxelInl
-	{
-		uvec3	_indices;
-		vec3	_scale;
-	};
+	typedef std::unordered_map<uint16_t, std::vector<uvec3>> CubeMap;
 
-	std::unordered_map<uint16_t, std::vector<VoxelInl>> cubeMap;
-	unsigned cellIndex;
+	TaskProgress silentProgress(false);
+	if (!progress) progress = &silentProgress;
 
-	for (int x = 0; x < _numDivs.x; ++x)
+	const VoxelPass::Strides strides = VoxelPass::getStrides(_numDivs);
+	progress->beginStage("Gathering voxels", this->length(), "voxels");
+
+	// Voxels are gathered per X slab and merged in slab order, so the output does not depend on thread scheduling
+	CubeMap cubeMap = VoxelPass::reduceSlabs(_numDivs, CubeMap(), [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
 	{
-		for (int z = 0; z < _numDivs.z; ++z)
+		CubeMap slabMap;
+		progress->checkpoint();
+
+		for (unsigned z = 0; z < _numDivs.z; ++z)
 		{
+			const unsigned baseIndex = firstIndex + z * strides._z;
+
 			if (fillUnderVoxels)
 			{
-				int y = _numDivs.y - 1, cellContent = 0;
-				cellIndex = this->getPositionIndex(x, y, z, _numDivs);
+				int y = _numDivs.y - 1;
+				while (y >= 0 && _grid[baseIndex + y * strides._y] == VOXEL_EMPTY) --y;
+				if (y < 0) continue;
 
-				while (y >= 0 && _grid[cellIndex] == VOXEL_EMPTY)
-				{
-					cellIndex = this->getPositionIndex(x, y, z, _numDivs);
-					--y;
-				}
-
-				cellContent = _grid[cellIndex];
-				while (y >= 0)
-				{
-					cubeMap[cellContent].push_back(VoxelInl{ uvec3(x, y, z), vec3(1.0f) });
-					--y;
-				}
+				std::vector<uvec3>& voxels = slabMap[_grid[baseIndex + y * strides._y]];
+				for (; y >= 0; --y) voxels.push_back(uvec3(x, y, z));
 			}
 			else
 			{
-				for (int y = 0; y < _numDivs.y; ++y)
+				for (unsigned y = 0; y < _numDivs.y; ++y)
 				{
-					cellIndex = this->getPositionIndex(x, y, z, _numDivs);
-					if (_grid[cellIndex] != VOXEL_EMPTY) cubeMap[_grid[cellIndex]].push_back(VoxelInl{ uvec3(x, y, z), vec3(1.0f) });
+					const uint16_t cellContent = _grid[baseIndex + y * strides._y];
+					if (cellContent != VOXEL_EMPTY) slabMap[cellContent].push_back(uvec3(x, y, z));
 				}
 			}
 		}
-	}
+
+		progress->advance(lastIndex - firstIndex);
+
+		return slabMap;
+	}, [](CubeMap& accumulated, CubeMap& partial)
+	{
+		for (auto& pair: partial)
+		{
+			std::vector<uvec3>& voxels = accumulated[pair.first];
+			voxels.insert(voxels.end(), pair.second.begin(), pair.second.end());
+		}
+	});
 
 	// Cube geometry & topology
 	Model3D::ModelComponent* modelComp = Primitives::getCubeModelComponent();
+	const mat3 frameRotation = mat3(_frame);
 	
+	std::vector<CubeMap::value_type*> colorVoxels;
+	size_t numVoxels = 0;
+
 	for (auto& pair: cubeMap)
 	{
+		colorVoxels.push_back(&pair);
+		numVoxels += pair.second.size();
+	}
+
+	progress->endStage();
+	progress->beginStage("Exporting voxels", numVoxels, "voxels");
+
+	// Each colour is written to its own file, hence files are independent tasks
+	ThreadPool::getInstance()->parallelFor(colorVoxels.size(), [&](size_t colorIdx)
+	{
+		CubeMap::value_type& pair = *colorVoxels[colorIdx];
+		progress->checkpoint();
+
 		std::filebuf fileBufferBinary;
 		fileBufferBinary.open("Fragments/" + std::to_string(pair.first) + ".ply", std::ios::out | std::ios::binary);
 
@@ -82,18 +116,20 @@ void RegularGrid::exportGrid(bool fillUnderVoxels)
 		if (outstreamBinary.fail()) throw std::runtime_error("Failed to open " + modelComp->_name + ".ply");
 
 		tinyply::PlyFile plyFile;
-		std::vector<vec3> position, normal, rgb;
+		std::vector<glm::dvec3> position;
+		std::vector<vec3> normal, rgb;
 		std::vector<uvec3> triangleMesh;
 		vec3 rgbIndex = ColorUtilities::HSVtoRGB(ColorUtilities::getHueValue(pair.first), .99f, .99f);
 		
-		for (VoxelInl& voxel: pair.second)
+		for (const uvec3& voxel: pair.second)
 		{
 			unsigned startIndex = position.size();
 			
 			for (Model3D::VertexGPUData& vertex: modelComp->_geometry)
 			{
-				position.push_back(vertex._position * _cellSize * voxel._scale + _aabb.min() + _cellSize * voxel._scale * vec3(voxel._indices.x, voxel._indices.y, voxel._indices.z));
-				normal.push_back(vertex._normal);
+				// The offset is added in double precision, as georeferenced coordinates are beyond the precision of floats
+				position.push_back(glm::dvec3(vec3(_frame * vec4(vertex._position * _cellSize + _aabb.min() + _cellSize * vec3(voxel.x, voxel.y, voxel.z), 1.0f))) + _offset);
+				normal.push_back(frameRotation * vertex._normal);
 				rgb.push_back(rgbIndex);
 			}
 
@@ -103,19 +139,35 @@ void RegularGrid::exportGrid(bool fillUnderVoxels)
 			}
 		}
 
-		plyFile.add_properties_to_element("vertex", { "x", "y", "z" }, tinyply::Type::FLOAT32, position.size(), reinterpret_cast<uint8_t*>(position.data()), tinyply::Type::INVALID, 0);
+		plyFile.add_properties_to_element("vertex", { "x", "y", "z" }, tinyply::Type::FLOAT64, position.size(), reinterpret_cast<uint8_t*>(position.data()), tinyply::Type::INVALID, 0);
 		plyFile.add_properties_to_element("vertex", { "nx", "ny", "nz" }, tinyply::Type::FLOAT32, normal.size(), reinterpret_cast<uint8_t*>(normal.data()), tinyply::Type::INVALID, 0);
 		plyFile.add_properties_to_element("vertex", { "r", "g", "b" }, tinyply::Type::FLOAT32, rgb.size(), reinterpret_cast<uint8_t*>(rgb.data()), tinyply::Type::INVALID, 0);
 		plyFile.add_properties_to_element("face", { "vertex_index" }, tinyply::Type::UINT32, triangleMesh.size(), reinterpret_cast<uint8_t*>(triangleMesh.data()), tinyply::Type::UINT8, 3);
 
 		plyFile.write(outstreamBinary, true);
-	}
+		progress->advance(pair.second.size());
+	});
 
+	progress->endStage();
 	delete modelComp;
 }
 
-void RegularGrid::fill(const std::vector<Model3D::VertexGPUData>& vertices, const std::vector<Model3D::FaceGPUData>& faces, unsigned index, int numSamples)
+void RegularGrid::fill(const std::vector<Model3D::VertexGPUData>& vertices, const std::vector<Model3D::FaceGPUData>& faces, unsigned index, int numSamples, bool useGPU, TaskProgress* progress)
 {
+	this->markDirty(uvec3(0), _numDivs);
+
+	if (!useGPU)
+	{
+		TaskProgress silentProgress(false);
+		if (!progress) progress = &silentProgress;
+
+		progress->beginStage("Voxelizing triangles", faces.size(), "triangles");
+		this->fillCPU(vertices, faces, progress);
+		progress->endStage();
+
+		return;
+	}
+
 	ComputeShader* shader = ShaderList::getInstance()->getComputeShader(RendEnum::BUILD_REGULAR_GRID);
 
 	// Input data
@@ -150,78 +202,151 @@ void RegularGrid::fill(const std::vector<Model3D::VertexGPUData>& vertices, cons
 	glDeleteBuffers(sizeof(buffers) / sizeof(GLuint), buffers);
 }
 
-void RegularGrid::fill(const std::vector<vec4>* vertices, std::vector<float>* thermalValues)
+void RegularGrid::fill(const PackedPoints* points, TaskProgress* progress)
 {
-	ComputeShader* shader = ShaderList::getInstance()->getComputeShader(RendEnum::BUILD_REGULAR_GRID_POINT_CLOUD);
+	TaskProgress silentProgress(false);
+	if (!progress) progress = &silentProgress;
 
-	// Input data
-	uvec3 numDivs = this->getNumSubdivisions();
-	unsigned numCells = numDivs.x * numDivs.y * numDivs.z;
-	unsigned numThreads = vertices->size();
-	unsigned numGroups = ComputeShader::getNumGroups(numThreads);
+	progress->beginStage("Binning points", points->size(), "points");
+	this->markDirty(uvec3(0), _numDivs);
+	this->fillCPU(points, progress);
+	progress->endStage();
+}
 
-	// Input data
-	std::vector<ivec2> thermalAggregation(numCells);
-	std::fill(thermalAggregation.begin(), thermalAggregation.end(), ivec2(0));
+void RegularGrid::fillInterior(const std::vector<Model3D::VertexGPUData>& vertices, const std::vector<Model3D::FaceGPUData>& faces, TaskProgress* progress)
+{
+	TaskProgress silentProgress(false);
+	if (!progress) progress = &silentProgress;
 
-	const GLuint vertexSSBO = ComputeShader::setReadBuffer(*vertices, GL_STATIC_DRAW);
-	const GLuint gridSSBO = ComputeShader::setReadBuffer(&_grid[0], numCells, GL_DYNAMIC_DRAW);
-	const GLuint thermalSSBO = ComputeShader::setReadBuffer(*thermalValues, GL_STATIC_DRAW);
-	const GLuint thermalAggregationSSBO = ComputeShader::setReadBuffer(thermalAggregation, GL_DYNAMIC_DRAW);
+	typedef std::pair<unsigned, float> Crossing;						// Column index (x, z) and height, in voxels, where a triangle crosses the column
 
-	shader->bindBuffers(std::vector<GLuint>{ vertexSSBO, thermalSSBO, gridSSBO, thermalAggregationSSBO });
-	shader->use();
-	shader->setUniform("aabbMin", _aabb.min());
-	shader->setUniform("cellSize", _cellSize);
-	shader->setUniform("gridDims", numDivs);
-	shader->setUniform("numPoints", GLuint(vertices->size()));
-	shader->execute(numGroups, 1, 1, ComputeShader::getMaxGroupSize(), 1, 1);
+	const size_t numFaces = faces.size(), numBatches = (numFaces + VOXELIZATION_BATCH_SIZE - 1) / VOXELIZATION_BATCH_SIZE;
+	const float infinity = std::numeric_limits<float>::infinity();
+	std::vector<std::vector<Crossing>> batchCrossings(numBatches);
 
-	uint16_t* gridData = ComputeShader::readData(gridSSBO, uint16_t());
-	_grid = std::vector<uint16_t>(gridData, gridData + numCells);
+	progress->beginStage("Filling mesh interior", numFaces + _numDivs.x, "steps");
+	this->markDirty(uvec3(0), _numDivs);
 
-	ivec2* aggregationData = ComputeShader::readData(thermalAggregationSSBO, ivec2());
-	for (int cellIdx = 0; cellIdx < numCells; ++cellIdx)
+	// Edges are evaluated from their lower end, so both triangles sharing an edge get opposite weights and exactly one of them owns the columns on it
+	auto getEdgeWeight = [](const vec3& origin, const vec3& destination, float x, float z, bool& owned) -> float
 	{
-		if (aggregationData[cellIdx].y)
+		const bool reversed = destination.x < origin.x || (destination.x == origin.x && destination.z < origin.z);
+		const vec3 &lower = reversed ? destination : origin, &upper = reversed ? origin : destination;
+		const float weight = (upper.x - lower.x) * (z - lower.z) - (upper.z - lower.z) * (x - lower.x);
+
+		owned = destination.z > origin.z || (destination.z == origin.z && destination.x < origin.x);
+
+		return reversed ? -weight : weight;
+	};
+
+	ThreadPool::getInstance()->parallelFor(numBatches, [&](size_t batchIdx)
+	{
+		std::vector<Crossing>& crossings = batchCrossings[batchIdx];
+		const size_t lastFaceIdx = std::min(numFaces, (batchIdx + 1) * VOXELIZATION_BATCH_SIZE);
+
+		for (size_t faceIdx = batchIdx * VOXELIZATION_BATCH_SIZE; faceIdx < lastFaceIdx; ++faceIdx)
 		{
-			_thermal[cellIdx] = (aggregationData[cellIdx].x / 10000.0f) / aggregationData[cellIdx].y;
+			vec3 corners[3];
+			this->getGridTriangle(vertices, faces[faceIdx], corners);
+			for (vec3& corner : corners) corner = (corner - _aabb.min()) / _cellSize;
+
+			// Triangles are projected onto the XZ plane with counter-clockwise winding, whereas vertical ones do not cross any column
+			const float area = (corners[1].x - corners[0].x) * (corners[2].z - corners[0].z) - (corners[1].z - corners[0].z) * (corners[2].x - corners[0].x);
+			if (area == .0f) continue;
+			if (area < .0f) std::swap(corners[1], corners[2]);
+
+			const vec3 minPoint = glm::min(corners[0], glm::min(corners[1], corners[2])), maxPoint = glm::max(corners[0], glm::max(corners[1], corners[2]));
+			const int minX = int(std::ceil(std::max(minPoint.x - .5f, .0f))), maxX = int(std::floor(std::min(maxPoint.x - .5f, _numDivs.x - 1.0f)));
+			const int minZ = int(std::ceil(std::max(minPoint.z - .5f, .0f))), maxZ = int(std::floor(std::min(maxPoint.z - .5f, _numDivs.z - 1.0f)));
+
+			for (int x = minX; x <= maxX; ++x)
+			{
+				for (int z = minZ; z <= maxZ; ++z)
+				{
+					float weight[3];
+					bool inside = true, owned;
+
+					for (int vertexIdx = 0; vertexIdx < 3 && inside; ++vertexIdx)
+					{
+						weight[vertexIdx] = getEdgeWeight(corners[(vertexIdx + 1) % 3], corners[(vertexIdx + 2) % 3], x + .5f, z + .5f, owned);
+						inside = weight[vertexIdx] > .0f || (weight[vertexIdx] == .0f && owned);
+					}
+
+					if (inside)
+					{
+						const float height = (weight[0] * corners[0].y + weight[1] * corners[1].y + weight[2] * corners[2].y) / (weight[0] + weight[1] + weight[2]);
+						crossings.emplace_back(x * _numDivs.z + z, height);
+					}
+				}
+			}
 		}
-	}
 
-	GLuint buffers[] = { vertexSSBO, gridSSBO, thermalSSBO, thermalAggregationSSBO };
-	glDeleteBuffers(sizeof(buffers) / sizeof(GLuint), buffers);
+		std::sort(crossings.begin(), crossings.end());
+		progress->advance(lastFaceIdx - batchIdx * VOXELIZATION_BATCH_SIZE);
+	});
+
+	// Columns of a slab are contiguous within every sorted list, and their voxels are inside the mesh between each pair of crossings
+	VoxelPass::forEachSlab(_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		std::vector<Crossing> slabCrossings;
+
+		for (const std::vector<Crossing>& crossings : batchCrossings)
+		{
+			auto first = std::lower_bound(crossings.begin(), crossings.end(), Crossing(x * _numDivs.z, -infinity));
+			auto last = std::lower_bound(first, crossings.end(), Crossing((x + 1) * _numDivs.z, -infinity));
+			slabCrossings.insert(slabCrossings.end(), first, last);
+		}
+
+		std::sort(slabCrossings.begin(), slabCrossings.end());
+
+		// The last crossing of a column is left unpaired if the mesh is not closed
+		for (size_t crossingIdx = 0; crossingIdx + 1 < slabCrossings.size(); )
+		{
+			const Crossing &bottom = slabCrossings[crossingIdx], &top = slabCrossings[crossingIdx + 1];
+			if (top.first != bottom.first)
+			{
+				++crossingIdx;
+				continue;
+			}
+
+			const unsigned z = bottom.first % _numDivs.z;
+			const int firstY = int(std::ceil(glm::clamp(bottom.second - .5f, .0f, float(_numDivs.y))));
+			const int lastY = int(std::ceil(glm::clamp(top.second - .5f, .0f, float(_numDivs.y))));
+
+			for (int y = firstY; y < lastY; ++y) _grid[this->getPositionIndex(x, y, z)] = VOXEL_FREE;
+			crossingIdx += 2;
+		}
+
+		progress->advance(1);
+	});
+
+	progress->endStage();
 }
 
 void RegularGrid::fillUnderCloud()
 {
-	int cellIndex;
+	this->markDirty(uvec3(0), _numDivs);
 
-	for (int x = 0; x < _numDivs.x; ++x)
+	VoxelPass::forEachColumn(_numDivs, [&](unsigned x, unsigned z, unsigned baseIndex, unsigned strideY)
 	{
-		for (int z = 0; z < _numDivs.z; ++z)
+		int y = _numDivs.y - 1;
+
+		while (y >= 0 && _grid[baseIndex + y * strideY] == VOXEL_EMPTY)
 		{
-			int y = _numDivs.y - 1;
+			--y;
+		}
 
-			while (y >= 0 && _grid[this->getPositionIndex(x, y, z, _numDivs)] == VOXEL_EMPTY)
-			{
-				--y;
-			}
+		if (y >= 0)
+		{
+			const float thermalValue = _thermal[baseIndex + y * strideY];
 
-			if (y >= 0)
+			for (unsigned cellIndex = baseIndex + y * strideY; y >= 0; --y, cellIndex -= strideY)
 			{
-				float thermalValue = _thermal[this->getPositionIndex(x, y, z, _numDivs)];
-				while (y >= 0)
-				{
-					cellIndex = this->getPositionIndex(x, y, z, _numDivs);
-
-					_grid[cellIndex] = VOXEL_FREE;
-					_thermal[cellIndex] = thermalValue;
-					--y;
-				}
+				_grid[cellIndex] = VOXEL_FREE;
+				_thermal[cellIndex] = thermalValue;
 			}
 		}
-	}
+	});
 }
 
 void RegularGrid::fillNoiseBuffer(std::vector<float>& noiseBuffer, unsigned numSamples)
@@ -234,64 +359,167 @@ void RegularGrid::fillNoiseBuffer(std::vector<float>& noiseBuffer, unsigned numS
 	}
 }
 
-void RegularGrid::locateAnomalies()
+void RegularGrid::locateAnomalies(int detector, int neighbors, float stdFactor, TaskProgress* progress)
 {
-	ComputeShader* shader = ShaderList::getInstance()->getComputeShader(RendEnum::LOCATE_THERMAL_ANOMALIES_SHADER);
-	RenderingParameters* rendParams = Renderer::getInstance()->getRenderingParameters();
+	TaskProgress silentProgress(false);
+	if (!progress) progress = &silentProgress;
 
-	// Input data
-	uvec3 numDivs = this->getNumSubdivisions();
-	unsigned numCells = numDivs.x * numDivs.y * numDivs.z;
-	unsigned numGroups = ComputeShader::getNumGroups(numCells);
+	// Median bins span the temperatures of the whole grid, hence a new range changes the quantized value of every voxel
+	const ThermalRange range = detector == RenderingParameters::MEDIAN_MAD ? this->getThermalRange() : ThermalRange(.0f, .0f);
+	const AnomalySearch search{ detector, neighbors, stdFactor, range };
 
-	// Input data
-	const GLuint gridSSBO = ComputeShader::setReadBuffer(_grid, GL_STATIC_DRAW);
-	const GLuint thermalSSBO = ComputeShader::setReadBuffer(_thermal, GL_STATIC_DRAW);
-	const GLuint statSSBO = ComputeShader::setWriteBuffer(vec2(), numCells, GL_DYNAMIC_DRAW);
-	const GLuint localPeakSSBO = ComputeShader::setWriteBuffer(float(), numCells, GL_DYNAMIC_DRAW);
+	const bool reusable = _anomalySearch._detector == detector && _anomalySearch._neighbors == neighbors && _anomalySearch._stdFactor == stdFactor &&
+		_anomalySearch._thermalRange == range && _localPeak.size() == this->length();
+	std::vector<size_t> bricks;
+	size_t numVoxels = 0;
 
-	shader->bindBuffers(std::vector<GLuint>{ gridSSBO, thermalSSBO, statSSBO, localPeakSSBO });
-	shader->use();
-	shader->setUniform("gridDims", numDivs);
-	shader->setUniform("neighbors", GLint(rendParams->_gridNeighbors));
-	shader->setUniform("stdFactor", rendParams->_stdFactor);
-	shader->execute(numGroups, 1, 1, ComputeShader::getMaxGroupSize(), 1, 1);
+	if (reusable)
+	{
+		const uvec3 numBricks = VoxelPass::getNumBricks(_numDivs, DIRTY_BRICK_SIZE);
+		this->getAffectedBricks(neighbors, bricks);
 
-	float* peakData = ComputeShader::readData(localPeakSSBO, float());
-	_localPeak = std::vector<float>(peakData, peakData + numCells);
+		for (size_t brickIdx : bricks)
+		{
+			const uvec3 minCell = uvec3(brickIdx / (size_t(numBricks.y) * numBricks.z), (brickIdx / numBricks.z) % numBricks.y, brickIdx % numBricks.z) * DIRTY_BRICK_SIZE;
+			const uvec3 brickSize = glm::min(minCell + DIRTY_BRICK_SIZE, _numDivs) - minCell;
 
-	//for (int cellIdx = 0; cellIdx < numCells; ++cellIdx)
-	//{
-	//	if (_grid[cellIdx] != VOXEL_EMPTY)
-	//	{
-	//		std::cout << stats[cellIdx].x << " " << stats[cellIdx].y << std::endl;
-	//	}
-	//}
+			numVoxels += size_t(brickSize.x) * brickSize.y * brickSize.z;
+		}
+	}
 
-	GLuint buffers[] = { gridSSBO, thermalSSBO, statSSBO, localPeakSSBO };
-	glDeleteBuffers(sizeof(buffers) / sizeof(GLuint), buffers);
+	// Median histograms cannot slide from one brick to the next, so each brick pays for the planes around it and many of them are slower than a full pass
+	const size_t brickOverhead = detector == RenderingParameters::MEDIAN_MAD ? DIRTY_BRICK_SIZE + 2 * neighbors : DIRTY_BRICK_SIZE;
+	const bool incremental = reusable && numVoxels * brickOverhead < this->length() * DIRTY_BRICK_SIZE;
+	if (!incremental) numVoxels = this->length();
+
+	// A cancelled search leaves a partial result, which must not be reused
+	_anomalySearch._detector = -1;
+	progress->beginStage("Locating anomalies", numVoxels, "voxels");
+
+	if (detector == RenderingParameters::MEDIAN_MAD)
+	{
+		this->locateAnomaliesMedian(neighbors, stdFactor, range, incremental ? &bricks : nullptr, progress);
+	}
+	else
+	{
+		this->locateAnomaliesMeanDeviation(neighbors, stdFactor, incremental ? &bricks : nullptr, progress);
+	}
+
+	_anomalySearch = search;
+	std::fill(_dirtyBrick.begin(), _dirtyBrick.end(), 0);
+
+	progress->endStage();
 }
 
-void RegularGrid::getAABBs(std::vector<AABB>& aabb)
+void RegularGrid::locateVisibleVoxels(const std::vector<vec3>& viewpoints, std::vector<uint8_t>& visible, TaskProgress* progress) const
 {
-	vec3 max, min;
-	
-	for (int x = 0; x < _numDivs.x; ++x)
+	TaskProgress silentProgress(false);
+	if (!progress) progress = &silentProgress;
+
+	std::vector<size_t> slabOffset;
+	this->getSlabOffsets(slabOffset);
+
+	const size_t numVoxels = slabOffset.back();
+	const vec3 halfCell = _cellSize * .5f;
+	const float offset = VISIBILITY_OFFSET * std::min(_cellSize.x, std::min(_cellSize.y, _cellSize.z));
+	std::vector<vec3> center(numVoxels), target(numVoxels);
+	std::vector<uint8_t> viewpointVisible;
+	std::vector<Triangle3D> occluders;
+
+	progress->beginStage("Locating visible voxels", viewpoints.size(), "viewpoints");
+
+	this->getOccluders(occluders);
+	const BVH bvh(occluders);
+	occluders = std::vector<Triangle3D>();
+
+	VoxelPass::forEachSlab(_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
 	{
-		for (int y = 0; y < _numDivs.y; ++y)
+		size_t voxelIdx = slabOffset[x];
+
+		for (unsigned cellIndex = firstIndex; cellIndex < lastIndex; ++cellIndex)
 		{
-			for (int z = 0; z < _numDivs.z; ++z)
+			if (_grid[cellIndex] != VOXEL_EMPTY)
 			{
-				if (_grid[this->getPositionIndex(x, y, z)] != VOXEL_EMPTY)
-				{
-					min = _aabb.min() + _cellSize * vec3(x, y, z);
-					max = min + _cellSize;
+				const unsigned localIndex = cellIndex - firstIndex;
+				center[voxelIdx++] = _aabb.min() + _cellSize * (vec3(x, localIndex / _numDivs.z, localIndex % _numDivs.z) + .5f);
+			}
+		}
+	});
+
+	visible.resize(viewpoints.size() * numVoxels);
 
-					aabb.push_back(AABB(min, max));
+	for (size_t viewpointIdx = 0; viewpointIdx < viewpoints.size(); ++viewpointIdx)
+	{
+		const vec3 origin = vec3(_inverseFrame * vec4(viewpoints[viewpointIdx], 1.0f));
+
+		// Segments stop right before entering the voxel they aim at, whose own faces would otherwise hide its center. Viewpoints within a voxel see it
+		VoxelPass::forEachSlab(_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+		{
+			for (size_t voxelIdx = slabOffset[x]; voxelIdx < slabOffset[x + 1]; ++voxelIdx)
+			{
+				const vec3 direction = center[voxelIdx] - origin;
+				float insideLength = 1.0f;
+
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					if (direction[axis] != .0f) insideLength = std::min(insideLength, halfCell[axis] / std::abs(direction[axis]));
 				}
+
+				target[voxelIdx] = origin + direction * std::max(1.0f - insideLength - offset / glm::length(direction), .0f);
 			}
-		}
+		});
+
+		bvh.isVisible(std::vector<vec3>(1, origin), target, viewpointVisible);
+		std::copy(viewpointVisible.begin(), viewpointVisible.end(), visible.begin() + viewpointIdx * numVoxels);
+
+		progress->advance(1);
 	}
+
+	progress->endStage();
+}
+
+void RegularGrid::compact(const std::vector<float>& voxelValues, std::vector<float>& compactValues) const
+{
+	std::vector<size_t> slabOffset;
+	this->getSlabOffsets(slabOffset);
+
+	compactValues.resize(slabOffset.back());
+
+	VoxelPass::forEachSlab(_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		size_t compactIndex = slabOffset[x];
+
+		for (unsigned cellIndex = firstIndex; cellIndex < lastIndex; ++cellIndex)
+		{
+			if (_grid[cellIndex] != VOXEL_EMPTY) compactValues[compactIndex++] = voxelValues[cellIndex];
+		}
+	});
+}
+
+void RegularGrid::getAABBs(std::vector<AABB>& aabb)
+{
+	// Boxes must follow the grid order, as per-voxel buffers are later compacted in that same order
+	std::vector<size_t> slabOffset;
+	this->getSlabOffsets(slabOffset);
+
+	const size_t startIndex = aabb.size();
+	aabb.resize(startIndex + slabOffset.back());
+
+	VoxelPass::forEachSlab(_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		size_t aabbIndex = startIndex + slabOffset[x];
+
+		for (unsigned cellIndex = firstIndex; cellIndex < lastIndex; ++cellIndex)
+		{
+			if (_grid[cellIndex] != VOXEL_EMPTY)
+			{
+				const unsigned localIndex = cellIndex - firstIndex;
+				const vec3 min = _aabb.min() + _cellSize * vec3(x, localIndex / _numDivs.z, localIndex % _numDivs.z);
+
+				aabb[aabbIndex++] = AABB(min, min + _cellSize);
+			}
+		}
+	});
 }
 
 void RegularGrid::insertPoint(const vec3& position, unsigned index)
@@ -299,6 +527,34 @@ void RegularGrid::insertPoint(const vec3& position, unsigned index)
 	uvec3 gridIndex = getPositionIndex(position);
 
 	_grid[this->getPositionIndex(gridIndex.x, gridIndex.y, gridIndex.z)] = index;
+	this->markDirty(gridIndex, gridIndex + 1u);
+}
+
+void RegularGrid::markDirty(const uvec3& minCell, const uvec3& maxCell)
+{
+	const uvec3 numBricks = VoxelPass::getNumBricks(_numDivs, DIRTY_BRICK_SIZE);
+	const uvec3 minBrick = minCell / DIRTY_BRICK_SIZE, maxBrick = glm::min((maxCell + DIRTY_BRICK_SIZE - 1u) / DIRTY_BRICK_SIZE, numBricks);
+
+	for (unsigned x = minBrick.x; x < maxBrick.x; ++x)
+		for (unsigned y = minBrick.y; y < maxBrick.y; ++y)
+			for (unsigned z = minBrick.z; z < maxBrick.z; ++z)
+				_dirtyBrick[(size_t(x) * numBricks.y + y) * numBricks.z + z] = 1;
+}
+
+bool RegularGrid::accumulatePoint(const vec3& position, float thermal)
+{
+	const vec3 gridPosition = _frame != mat4(1.0f) ? vec3(_inverseFrame * vec4(position, 1.0f)) : position;
+	if (glm::any(glm::lessThan(gridPosition, _aabb.min())) || glm::any(glm::greaterThan(gridPosition, _aabb.max()))) return false;
+
+	const uvec3 gridIndex = this->getPositionIndex(gridPosition);
+	const unsigned cellIndex = this->getPositionIndex(gridIndex.x, gridIndex.y, gridIndex.z);
+	this->markDirty(gridIndex, gridIndex + 1u);
+
+	// Voxels filled under the cloud hold no points, hence their borrowed temperature is replaced by the first one received
+	_grid[cellIndex] = VOXEL_FREE;
+	_thermal[cellIndex] += (thermal - _thermal[cellIndex]) / float(++_pointCount[cellIndex]);
+
+	return true;
 }
 
 void RegularGrid::queryCluster(const std::vector<Model3D::VertexGPUData>& vertices, const std::vector<Model3D::FaceGPUData>& faces, std::vector<float>& clusterIdx)
@@ -350,11 +606,13 @@ glm::uvec3 RegularGrid::getNumSubdivisions() const
 
 void RegularGrid::homogenize()
 {
-	for (unsigned int x = 0; x < _numDivs.x; ++x)
-		for (unsigned int y = 0; y < _numDivs.y; ++y)
-			for (unsigned int z = 0; z < _numDivs.z; ++z)
-				if (this->at(x, y, z) != VOXEL_EMPTY)
-					this->set(x, y, z, VOXEL_FREE);
+	VoxelPass::forEachSlab(_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		for (unsigned cellIndex = firstIndex; cellIndex < lastIndex; ++cellIndex)
+		{
+			if (_grid[cellIndex] != VOXEL_EMPTY) _grid[cellIndex] = VOXEL_FREE;
+		}
+	});
 }
 
 bool RegularGrid::isOccupied(int x, int y, int z) const
@@ -377,9 +635,15 @@ std::vector<float>* RegularGrid::localPeak()
 	return &_localPeak;
 }
 
-void RegularGrid::set(int x, int y, int z, uint8_t i)
+std::vector<unsigned>* RegularGrid::pointCount()
+{
+	return &_pointCount;
+}
+
+void RegularGrid::set(int x, int y, int z, uint16_t i)
 {
 	_grid[this->getPositionIndex(x, y, z)] = i;
+	this->markDirty(uvec3(x, y, z), uvec3(x, y, z) + 1u);
 }
 
 std::vector<float>* RegularGrid::thermalData()
@@ -395,8 +659,247 @@ void RegularGrid::buildGrid()
 
 	_grid = std::vector<uint16_t>(numVoxels);
 	_thermal = std::vector<float>(numVoxels);
+	_pointCount = std::vector<unsigned>(numVoxels);
 	std::fill(_grid.begin(), _grid.end(), VOXEL_EMPTY);
 	std::fill(_thermal.begin(), _thermal.end(), .0f);
+	std::fill(_pointCount.begin(), _pointCount.end(), 0);
+
+	const uvec3 numBricks = VoxelPass::getNumBricks(_numDivs, DIRTY_BRICK_SIZE);
+	_dirtyBrick = std::vector<uint8_t>(size_t(numBricks.x) * numBricks.y * numBricks.z, 1);
+}
+
+void RegularGrid::fillCPU(const PackedPoints* points, TaskProgress* progress)
+{
+	const size_t numPoints = points->size(), numCells = this->length(), blockSize = PackedPoints::BLOCK_SIZE;
+	std::vector<std::atomic<int64_t>> thermalSum(numCells);
+	std::vector<std::atomic<unsigned>> count(numCells);
+
+	VoxelPass::forEachSlab(_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		for (unsigned cellIndex = firstIndex; cellIndex < lastIndex; ++cellIndex)
+		{
+			thermalSum[cellIndex].store(0, std::memory_order_relaxed);
+			count[cellIndex].store(0, std::memory_order_relaxed);
+		}
+	});
+
+	// Integer sums keep the result independent of the order in which threads reach each voxel
+	const bool oriented = _frame != mat4(1.0f);
+
+	ThreadPool::getInstance()->parallelFor((numPoints + blockSize - 1) / blockSize, [&](size_t blockIdx)
+	{
+		const size_t lastPointIdx = std::min(numPoints, (blockIdx + 1) * blockSize);
+
+		for (size_t pointIdx = blockIdx * blockSize; pointIdx < lastPointIdx; ++pointIdx)
+		{
+			const vec3 position = oriented ? vec3(_inverseFrame * vec4(points->getPoint(pointIdx), 1.0f)) : points->getPoint(pointIdx);
+			const uvec3 gridIndex = this->getPositionIndex(position);
+			const unsigned cellIndex = this->getPositionIndex(gridIndex.x, gridIndex.y, gridIndex.z);
+
+			thermalSum[cellIndex].fetch_add(int64_t(points->getThermal(pointIdx) * 10000.0f), std::memory_order_relaxed);
+			count[cellIndex].fetch_add(1, std::memory_order_relaxed);
+		}
+
+		progress->advance(lastPointIdx - blockIdx * blockSize);
+	});
+
+	VoxelPass::forEachSlab(_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		for (unsigned cellIndex = firstIndex; cellIndex < lastIndex; ++cellIndex)
+		{
+			const unsigned numCellPoints = count[cellIndex].load(std::memory_order_relaxed);
+			if (!numCellPoints) continue;
+
+			_grid[cellIndex] = VOXEL_FREE;
+			_thermal[cellIndex] = (thermalSum[cellIndex].load(std::memory_order_relaxed) / 10000.0f) / numCellPoints;
+			_pointCount[cellIndex] = numCellPoints;
+		}
+	});
+}
+
+void RegularGrid::fillCPU(const std::vector<Model3D::VertexGPUData>& vertices, const std::vector<Model3D::FaceGPUData>& faces, TaskProgress* progress)
+{
+	const size_t numFaces = faces.size(), numBatches = (numFaces + VOXELIZATION_BATCH_SIZE - 1) / VOXELIZATION_BATCH_SIZE;
+	const ivec3 lastCell = ivec3(_numDivs) - 1;
+	std::vector<std::vector<unsigned>> batchCells(numBatches);
+
+	// Each batch gathers its voxels in a sorted list without duplicates, so the result does not depend on how batches are scheduled
+	ThreadPool::getInstance()->parallelFor(numBatches, [&](size_t batchIdx)
+	{
+		std::vector<unsigned>& cells = batchCells[batchIdx];
+		const size_t lastFaceIdx = std::min(numFaces, (batchIdx + 1) * VOXELIZATION_BATCH_SIZE);
+
+		for (size_t faceIdx = batchIdx * VOXELIZATION_BATCH_SIZE; faceIdx < lastFaceIdx; ++faceIdx)
+		{
+			vec3 corners[3];
+			this->getGridTriangle(vertices, faces[faceIdx], corners);
+
+			// Triangles partially out of the grid only mark the voxels they overlap within it
+			Triangle3D triangle(corners[0], corners[1], corners[2]);
+			const vec3 minPoint = (glm::min(corners[0], glm::min(corners[1], corners[2])) - _aabb.min()) / _cellSize;
+			const vec3 maxPoint = (glm::max(corners[0], glm::max(corners[1], corners[2])) - _aabb.min()) / _cellSize;
+			const ivec3 minCell = glm::max(ivec3(glm::floor(minPoint)), ivec3(0)), maxCell = glm::min(ivec3(glm::floor(maxPoint)), lastCell);
+
+			for (int x = minCell.x; x <= maxCell.x; ++x)
+			{
+				for (int y = minCell.y; y <= maxCell.y; ++y)
+				{
+					for (int z = minCell.z; z <= maxCell.z; ++z)
+					{
+						AABB cell(_aabb.min() + vec3(x, y, z) * _cellSize, _aabb.min() + vec3(x + 1, y + 1, z + 1) * _cellSize);
+						if (Intersections3D::intersect(triangle, cell)) cells.push_back(this->getPositionIndex(x, y, z));
+					}
+				}
+			}
+		}
+
+		std::sort(cells.begin(), cells.end());
+		cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+		progress->advance(lastFaceIdx - batchIdx * VOXELIZATION_BATCH_SIZE);
+	});
+
+	// Each slab writes its own range of every sorted list, hence no voxel is written by two threads
+	VoxelPass::forEachSlab(_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		for (const std::vector<unsigned>& cells : batchCells)
+		{
+			for (auto cell = std::lower_bound(cells.begin(), cells.end(), firstIndex); cell != cells.end() && *cell < lastIndex; ++cell)
+			{
+				_grid[*cell] = VOXEL_FREE;
+			}
+		}
+	});
+}
+
+mat4 RegularGrid::getOrientedFrame(const PackedPoints& points, AABB& aabb)
+{
+	const size_t numPoints = points.size(), sampleSize = std::min(numPoints, size_t(ORIENTATION_SAMPLE_SIZE));
+	aabb = AABB();
+
+	if (!sampleSize) return mat4(1.0f);
+
+	// Horizontal covariance of an evenly strided sample
+	glm::dvec2 mean(.0);
+	double covXX = .0, covXZ = .0, covZZ = .0;
+
+	for (size_t sampleIdx = 0; sampleIdx < sampleSize; ++sampleIdx)
+	{
+		const vec3 point = points.getPoint(sampleIdx * numPoints / sampleSize);
+		mean += glm::dvec2(point.x, point.z);
+	}
+
+	mean /= double(sampleSize);
+
+	for (size_t sampleIdx = 0; sampleIdx < sampleSize; ++sampleIdx)
+	{
+		const vec3 point = points.getPoint(sampleIdx * numPoints / sampleSize);
+		const double dx = point.x - mean.x, dz = point.z - mean.y;
+
+		covXX += dx * dx; covXZ += dx * dz; covZZ += dz * dz;
+	}
+
+	// Angle of the major eigenvector of the 2x2 covariance matrix, which becomes the grid X axis
+	const float angle = float(.5 * std::atan2(2.0 * covXZ, covXX - covZZ));
+	const mat4 rotation = glm::rotate(mat4(1.0f), -angle, vec3(.0f, 1.0f, .0f));
+	const mat4 frame = glm::translate(mat4(1.0f), vec3(float(mean.x), .0f, float(mean.y))) * rotation;
+	const mat4 inverseFrame = glm::inverse(frame);
+
+	// Same transformation as binning, so that every point falls within the box
+	const size_t blockSize = PackedPoints::BLOCK_SIZE;
+	aabb = ThreadPool::getInstance()->parallelReduce((numPoints + blockSize - 1) / blockSize, AABB(), [&](size_t blockIdx)
+	{
+		AABB blockAABB;
+
+		for (size_t pointIdx = blockIdx * blockSize; pointIdx < std::min(numPoints, (blockIdx + 1) * blockSize); ++pointIdx)
+			blockAABB.update(vec3(inverseFrame * vec4(points.getPoint(pointIdx), 1.0f)));
+
+		return blockAABB;
+	}, [](AABB& accumulated, const AABB& partial) { accumulated.update(partial); });
+
+	return frame;
+}
+
+void RegularGrid::getOccluders(std::vector<Triangle3D>& triangles) const
+{
+	std::vector<std::vector<Triangle3D>> slabTriangles(_numDivs.x);
+
+	VoxelPass::forEachSlab(_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		for (unsigned cellIndex = firstIndex; cellIndex < lastIndex; ++cellIndex)
+		{
+			if (_grid[cellIndex] == VOXEL_EMPTY) continue;
+
+			const unsigned localIndex = cellIndex - firstIndex;
+			const ivec3 cell(x, localIndex / _numDivs.z, localIndex % _numDivs.z);
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				for (int side = 0; side < 2; ++side)
+				{
+					ivec3 neighbor = cell;
+					neighbor[axis] += side ? 1 : -1;
+
+					if (neighbor[axis] >= 0 && neighbor[axis] < int(_numDivs[axis]) && _grid[this->getPositionIndex(neighbor.x, neighbor.y, neighbor.z)] != VOXEL_EMPTY) continue;
+
+					// Corners are derived from integer cell coordinates, so that faces of neighbouring voxels share their vertices exactly
+					vec3 corner[4];
+					for (int cornerIdx = 0; cornerIdx < 4; ++cornerIdx)
+					{
+						ivec3 cornerCell = cell;
+						cornerCell[axis] += side;
+						cornerCell[(axis + 1) % 3] += cornerIdx & 1;
+						cornerCell[(axis + 2) % 3] += cornerIdx >> 1;
+
+						corner[cornerIdx] = _aabb.min() + _cellSize * vec3(cornerCell);
+					}
+
+					slabTriangles[x].emplace_back(corner[0], corner[1], corner[3]);
+					slabTriangles[x].emplace_back(corner[0], corner[3], corner[2]);
+				}
+			}
+		}
+	});
+
+	for (const std::vector<Triangle3D>& slab : slabTriangles) triangles.insert(triangles.end(), slab.begin(), slab.end());
+}
+
+void RegularGrid::getGridTriangle(const std::vector<Model3D::VertexGPUData>& vertices, const Model3D::FaceGPUData& face, vec3* corners) const
+{
+	const bool oriented = _frame != mat4(1.0f);
+
+	for (int vertexIdx = 0; vertexIdx < 3; ++vertexIdx)
+	{
+		const vec3& position = vertices[face._vertices[vertexIdx]]._position;
+		corners[vertexIdx] = oriented ? vec3(_inverseFrame * vec4(position, 1.0f)) : position;
+	}
+}
+
+void RegularGrid::getAffectedBricks(int neighbors, std::vector<size_t>& bricks) const
+{
+	const ivec3 numBricks = ivec3(VoxelPass::getNumBricks(_numDivs, DIRTY_BRICK_SIZE));
+	std::vector<uint8_t> affected(_dirtyBrick.size(), 0);
+
+	// Windows span [c - neighbors, c + neighbors), hence a changed voxel alters the results of those up to neighbors cells away
+	const int reach = (std::max(neighbors, 0) + int(DIRTY_BRICK_SIZE) - 1) / int(DIRTY_BRICK_SIZE);
+
+	for (int x = 0; x < numBricks.x; ++x)
+		for (int y = 0; y < numBricks.y; ++y)
+			for (int z = 0; z < numBricks.z; ++z)
+			{
+				if (!_dirtyBrick[(size_t(x) * numBricks.y + y) * numBricks.z + z]) continue;
+
+				const ivec3 minBrick = glm::max(ivec3(x, y, z) - reach, ivec3(0)), maxBrick = glm::min(ivec3(x, y, z) + reach + 1, numBricks);
+
+				for (int neighborX = minBrick.x; neighborX < maxBrick.x; ++neighborX)
+					for (int neighborY = minBrick.y; neighborY < maxBrick.y; ++neighborY)
+						for (int neighborZ = minBrick.z; neighborZ < maxBrick.z; ++neighborZ)
+							affected[(size_t(neighborX) * numBricks.y + neighborY) * numBricks.z + neighborZ] = 1;
+			}
+
+	bricks.clear();
+	for (size_t brickIdx = 0; brickIdx < affected.size(); ++brickIdx)
+		if (affected[brickIdx]) bricks.push_back(brickIdx);
 }
 
 uvec3 RegularGrid::getPositionIndex(const vec3& position)
@@ -412,6 +915,256 @@ unsigned RegularGrid::getPositionIndex(int x, int y, int z) const
 	return x * _numDivs.y * _numDivs.z + y * _numDivs.z + z;
 }
 
+void RegularGrid::locateAnomaliesMeanDeviation(int neighbors, float stdFactor, const std::vector<size_t>* bricks, TaskProgress* progress)
+{
+	if (bricks)
+	{
+		VoxelPass::forEachBrick(_numDivs, DIRTY_BRICK_SIZE, *bricks, [&](const uvec3& minCell, const uvec3& maxCell)
+		{
+			this->locateAnomaliesMeanDeviation(neighbors, stdFactor, minCell, maxCell);
+			progress->advance(size_t(maxCell.x - minCell.x) * (maxCell.y - minCell.y) * (maxCell.z - minCell.z));
+		});
+
+		return;
+	}
+
+	_localPeak = std::vector<float>(this->length(), LOCAL_PEAK_NONE);
+
+	VoxelPass::forEachSlab(_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		this->locateAnomaliesMeanDeviation(neighbors, stdFactor, uvec3(x, 0, 0), uvec3(x + 1, _numDivs.y, _numDivs.z));
+		progress->advance(lastIndex - firstIndex);
+	});
+}
+
+void RegularGrid::locateAnomaliesMeanDeviation(int neighbors, float stdFactor, const uvec3& minCell, const uvec3& maxCell)
+{
+	const ivec3 numDivs = ivec3(_numDivs);
+	const VoxelPass::Strides strides = VoxelPass::getStrides(_numDivs);
+
+	// Same window and decision rule as locateThermalAnomalies-comp.glsl
+	for (int x = int(minCell.x); x < int(maxCell.x); ++x)
+	{
+		const int minX = std::max(0, x - neighbors), maxX = std::min(numDivs.x, x + neighbors);
+
+		for (int y = int(minCell.y); y < int(maxCell.y); ++y)
+		{
+			const int minY = std::max(0, y - neighbors), maxY = std::min(numDivs.y, y + neighbors);
+
+			for (int z = int(minCell.z); z < int(maxCell.z); ++z)
+			{
+				const unsigned cellIndex = x * strides._x + y * strides._y + z;
+
+				_localPeak[cellIndex] = LOCAL_PEAK_NONE;
+				if (_grid[cellIndex] == VOXEL_EMPTY) continue;
+
+				const int minZ = std::max(0, z - neighbors), maxZ = std::min(numDivs.z, z + neighbors);
+				float average = .0f, deviation = .0f;
+				unsigned numNeighbors = 0;
+
+				for (int neighborX = minX; neighborX < maxX; ++neighborX)
+					for (int neighborY = minY; neighborY < maxY; ++neighborY)
+						for (unsigned neighborIndex = neighborX * strides._x + neighborY * strides._y + minZ, lastIndex = neighborIndex + (maxZ - minZ); neighborIndex < lastIndex; ++neighborIndex)
+						{
+							if (_grid[neighborIndex] == VOXEL_EMPTY) continue;
+
+							average += _thermal[neighborIndex];
+							++numNeighbors;
+						}
+
+				average /= float(std::max(1u, numNeighbors));
+
+				for (int neighborX = minX; neighborX < maxX; ++neighborX)
+					for (int neighborY = minY; neighborY < maxY; ++neighborY)
+						for (unsigned neighborIndex = neighborX * strides._x + neighborY * strides._y + minZ, lastIndex = neighborIndex + (maxZ - minZ); neighborIndex < lastIndex; ++neighborIndex)
+						{
+							if (_grid[neighborIndex] != VOXEL_EMPTY) deviation += std::abs(average - _thermal[neighborIndex]);
+						}
+
+				deviation /= float(std::max(1u, numNeighbors));
+
+				if (_thermal[cellIndex] >= average + stdFactor * deviation) _localPeak[cellIndex] = LOCAL_PEAK_MAX;
+				if (_thermal[cellIndex] <= average - stdFactor * deviation) _localPeak[cellIndex] = LOCAL_PEAK_MIN;
+			}
+		}
+	}
+}
+
+void RegularGrid::getSlabOffsets(std::vector<size_t>& slabOffset) const
+{
+	slabOffset.assign(_numDivs.x + 1, 0);
+
+	VoxelPass::forEachSlab(_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		slabOffset[x + 1] = std::count_if(_grid.begin() + firstIndex, _grid.begin() + lastIndex, [](uint16_t cell) { return cell != VOXEL_EMPTY; });
+	});
+
+	std::partial_sum(slabOffset.begin(), slabOffset.end(), slabOffset.begin());
+}
+
+void RegularGrid::locateAnomaliesMedian(int neighbors, float stdFactor, const ThermalRange& range, const std::vector<size_t>* bricks, TaskProgress* progress)
+{
+	if (!bricks) _localPeak = std::vector<float>(this->length(), LOCAL_PEAK_NONE);
+	if (range.first > range.second) return;
+
+	// Thermal values are quantized within the range of occupied voxels; empty voxels never reach the histograms and may lie outside it
+	const float binScale = range.second > range.first ? (THERMAL_HISTOGRAM_BINS - 1) / (range.second - range.first) : .0f;
+	std::vector<uint16_t> quantized(this->length(), 0);
+
+	VoxelPass::forEachSlab(_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		for (unsigned cellIndex = firstIndex; cellIndex < lastIndex; ++cellIndex)
+		{
+			if (_grid[cellIndex] == VOXEL_EMPTY) continue;
+
+			const float bin = std::round((_thermal[cellIndex] - range.first) * binScale);
+			quantized[cellIndex] = uint16_t(glm::clamp(bin, .0f, float(THERMAL_HISTOGRAM_BINS - 1)));
+		}
+	});
+
+	if (bricks)
+	{
+		VoxelPass::forEachBrick(_numDivs, DIRTY_BRICK_SIZE, *bricks, [&](const uvec3& minCell, const uvec3& maxCell)
+		{
+			this->locateAnomaliesMedian(neighbors, stdFactor, quantized, minCell, maxCell);
+			progress->advance(size_t(maxCell.x - minCell.x) * (maxCell.y - minCell.y) * (maxCell.z - minCell.z));
+		});
+
+		return;
+	}
+
+	VoxelPass::forEachSlab(_numDivs, [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		this->locateAnomaliesMedian(neighbors, stdFactor, quantized, uvec3(x, 0, 0), uvec3(x + 1, _numDivs.y, _numDivs.z));
+		progress->advance(lastIndex - firstIndex);
+	});
+}
+
+void RegularGrid::locateAnomaliesMedian(int neighbors, float stdFactor, const std::vector<uint16_t>& quantized, const uvec3& minCell, const uvec3& maxCell)
+{
+	const unsigned numBins = THERMAL_HISTOGRAM_BINS;
+	const ivec3 numDivs = ivec3(_numDivs);
+	const VoxelPass::Strides strides = VoxelPass::getStrides(_numDivs);
+
+	// Planes only cover the Z range reached by the windows of the evaluated voxels
+	const int firstZ = std::max(0, int(minCell.z) - neighbors), lastZ = std::min(numDivs.z, int(maxCell.z) + neighbors);
+	std::vector<unsigned> planeHistogram((lastZ - firstZ) * numBins), planeCount(lastZ - firstZ);
+	std::vector<unsigned> windowHistogram(numBins);
+	unsigned windowCount;
+
+	// Same window as the mean / deviation detector: [c - neighbors, c + neighbors) along each axis
+	for (int x = int(minCell.x); x < int(maxCell.x); ++x)
+	{
+		const int minX = std::max(0, x - neighbors), maxX = std::min(numDivs.x, x + neighbors);
+
+		// One histogram per Z plane, covering the window in X and Y
+		std::fill(planeHistogram.begin(), planeHistogram.end(), 0);
+		std::fill(planeCount.begin(), planeCount.end(), 0);
+
+		auto updateRow = [&](int y, int increment)
+		{
+			if (y < 0 || y >= numDivs.y) return;
+
+			for (int neighborX = minX; neighborX < maxX; ++neighborX)
+			{
+				const unsigned rowIndex = neighborX * strides._x + y * strides._y;
+
+				for (int z = firstZ; z < lastZ; ++z)
+				{
+					if (_grid[rowIndex + z] == VOXEL_EMPTY) continue;
+
+					planeHistogram[(z - firstZ) * numBins + quantized[rowIndex + z]] += increment;
+					planeCount[z - firstZ] += increment;
+				}
+			}
+		};
+
+		auto updateWindow = [&](int z, int increment)
+		{
+			if (z < firstZ || z >= lastZ || !planeCount[z - firstZ]) return;
+
+			const unsigned* histogram = &planeHistogram[(z - firstZ) * numBins];
+			for (unsigned bin = 0; bin < numBins; ++bin) windowHistogram[bin] += increment * histogram[bin];
+			windowCount += increment * planeCount[z - firstZ];
+		};
+
+		for (int y = int(minCell.y) - neighbors; y < int(minCell.y) + neighbors; ++y) updateRow(y, 1);
+
+		for (int y = int(minCell.y); y < int(maxCell.y); ++y)
+		{
+			if (y > int(minCell.y))
+			{
+				updateRow(y - 1 - neighbors, -1);
+				updateRow(y - 1 + neighbors, 1);
+			}
+
+			std::fill(windowHistogram.begin(), windowHistogram.end(), 0);
+			windowCount = 0;
+
+			for (int z = int(minCell.z) - neighbors; z < int(minCell.z) + neighbors; ++z) updateWindow(z, 1);
+
+			for (int z = int(minCell.z); z < int(maxCell.z); ++z)
+			{
+				if (z > int(minCell.z))
+				{
+					updateWindow(z - 1 - neighbors, -1);
+					updateWindow(z - 1 + neighbors, 1);
+				}
+
+				const unsigned cellIndex = x * strides._x + y * strides._y + z;
+
+				_localPeak[cellIndex] = LOCAL_PEAK_NONE;
+				if (_grid[cellIndex] == VOXEL_EMPTY || !windowCount) continue;
+
+				const unsigned halfCount = (windowCount + 1) / 2;
+				unsigned medianBin = 0, accumulated = windowHistogram[0];
+
+				while (accumulated < halfCount) accumulated += windowHistogram[++medianBin];
+
+				// Absolute deviations are gathered symmetrically around the median bin
+				int deviation = 0;
+				accumulated = windowHistogram[medianBin];
+
+				while (accumulated < halfCount)
+				{
+					++deviation;
+					if (int(medianBin) - deviation >= 0) accumulated += windowHistogram[medianBin - deviation];
+					if (medianBin + deviation < numBins) accumulated += windowHistogram[medianBin + deviation];
+				}
+
+				// A flat neighbourhood is given the width of a quantization bin as deviation
+				const float threshold = stdFactor * std::max(MAD_TO_STD * deviation, 1.0f);
+				const float difference = float(quantized[cellIndex]) - float(medianBin);
+
+				if (difference >= threshold) _localPeak[cellIndex] = LOCAL_PEAK_MAX;
+				else if (-difference >= threshold) _localPeak[cellIndex] = LOCAL_PEAK_MIN;
+			}
+		}
+	}
+}
+
+RegularGrid::ThermalRange RegularGrid::getThermalRange() const
+{
+	return VoxelPass::reduceSlabs(_numDivs, ThermalRange(std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()), [&](unsigned x, unsigned firstIndex, unsigned lastIndex)
+	{
+		ThermalRange slabRange(std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+
+		for (unsigned cellIndex = firstIndex; cellIndex < lastIndex; ++cellIndex)
+		{
+			if (_grid[cellIndex] == VOXEL_EMPTY) continue;
+
+			slabRange.first = std::min(slabRange.first, _thermal[cellIndex]);
+			slabRange.second = std::max(slabRange.second, _thermal[cellIndex]);
+		}
+
+		return slabRange;
+	}, [](ThermalRange& accumulated, const ThermalRange& partial)
+	{
+		accumulated.first = std::min(accumulated.first, partial.first);
+		accumulated.second = std::max(accumulated.second, partial.second);
+	});
+}
+
 unsigned RegularGrid::getPositionIndex(int x, int y, int z, const uvec3& numDivs)
 {
 	return x * numDivs.y * numDivs.z + y * numDivs.z + z;
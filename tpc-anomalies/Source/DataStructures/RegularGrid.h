@@ -1,9 +1,12 @@
 #pragma once
 
+#include "DataStructures/PackedPoints.h"
 #include "Geometry/3D/AABB.h"
+#include "Geometry/3D/Triangle3D.h"
 #include "Graphics/Core/Image.h"
 #include "Graphics/Core/Model3D.h"
 #include "Graphics/Core/Texture.h"
+#include "Utilities/TaskProgress.h"
 
 /**
 *	@file RegularGrid.h
@@ -14,17 +17,52 @@
 #define VOXEL_EMPTY 0
 #define VOXEL_FREE 1
 
+#define LOCAL_PEAK_NONE 0
+#define LOCAL_PEAK_MIN 1
+#define LOCAL_PEAK_MAX 2
+
 /**
 *	@brief Data structure which helps us to locate models on a terrain.
 */
 class RegularGrid
 {   
+	friend class GridCache;
+	friend class PackedGrid;
+
+protected:
+	typedef std::pair<float, float> ThermalRange;
+
+	/**
+	*	@brief Settings of the last anomaly search. Results are only updated incrementally while the settings stay the same.
+	*/
+	struct AnomalySearch
+	{
+		int				_detector;									//!< RenderingParameters::AnomalyDetector, negative if there is no valid result
+		int				_neighbors;									//!< Half width of the window
+		float			_stdFactor;									//!< Multiplier of the deviation
+		ThermalRange	_thermalRange;								//!< Temperatures quantized by the median detector
+	};
+
 protected:
+	const static unsigned	DIRTY_BRICK_SIZE;						//!< Voxels per axis of the bricks whose changes are tracked between anomaly searches
+	const static unsigned	THERMAL_HISTOGRAM_BINS;					//!< Quantization levels of thermal values for robust statistics
+	const static float		MAD_TO_STD;								//!< Scale of the median absolute deviation to estimate a standard deviation
+	const static unsigned	ORIENTATION_SAMPLE_SIZE;				//!< Maximum number of points sampled to find the principal directions of a cloud
+	const static unsigned	VOXELIZATION_BATCH_SIZE;				//!< Triangles voxelized by each CPU task
+	const static float		VISIBILITY_OFFSET;						//!< Fraction of a cell kept between visibility segments and the voxel they reach
+
+protected:
+	AnomalySearch			_anomalySearch;							//!< Settings of the anomalies held by _localPeak
+	std::vector<uint8_t>	_dirtyBrick;							//!< Bricks with voxels changed since anomalies were last located
 	std::vector<uint16_t>	_grid;									//!< Color index of regular grid
 	std::vector<float>		_localPeak;								//!< Maximu/minimum indicator
+	std::vector<unsigned>	_pointCount;							//!< Number of points binned into each voxel
 	std::vector<float>		_thermal;								//!< Thermal grayscale representation per voxel
 
-	AABB					_aabb;									//!< Bounding box of the scene
+	AABB					_aabb;									//!< Bounding box of the scene, in grid space
+	mat4					_frame;									//!< Transformation from grid space to world space
+	mat4					_inverseFrame;							//!< Transformation from world space to grid space
+	glm::dvec3				_offset;								//!< Translation from world space to georeferenced coordinates, kept apart as floats cannot hold it
 	vec3					_cellSize;								//!< Size of each grid cell
 	uvec3					_numDivs;								//!< Number of subdivisions of space between mininum and maximum point
 
@@ -33,7 +71,32 @@ protected:
 	*	@brief Builds a 3D grid. 
 	*/
 	void buildGrid();
+
+	/**
+	*	@brief Bins points with CPU threads, accumulating temperatures in fixed point so that sums do not depend on the order of the threads.
+	*/
+	void fillCPU(const PackedPoints* points, TaskProgress* progress);
+
+	/**
+	*	@brief Marks every voxel overlapped by a triangle, testing the voxels within its bounding box. Batches of triangles are voxelized in parallel.
+	*/
+	void fillCPU(const std::vector<Model3D::VertexGPUData>& vertices, const std::vector<Model3D::FaceGPUData>& faces, TaskProgress* progress);
 	
+	/**
+	*	@brief Gathers the bricks whose anomalies may differ from the last search, i.e., those within the window of a voxel in a dirty brick.
+	*/
+	void getAffectedBricks(int neighbors, std::vector<size_t>& bricks) const;
+
+	/**
+	*	@brief Retrieves the faces of occupied voxels next to empty voxels or to the grid boundary, as two triangles each, in grid space.
+	*/
+	void getOccluders(std::vector<Triangle3D>& triangles) const;
+
+	/**
+	*	@brief Retrieves the corners of a face in the space of the grid, i.e., transformed by the inverse frame of oriented grids.
+	*/
+	void getGridTriangle(const std::vector<Model3D::VertexGPUData>& vertices, const Model3D::FaceGPUData& face, vec3* corners) const;
+
 	/**
 	*	@return Index of grid cell to be filled.
 	*/
@@ -44,6 +107,40 @@ protected:
 	*/
 	unsigned getPositionIndex(int x, int y, int z) const;
 
+	/**
+	*	@brief Locates outlier voxels with CPU threads, comparing each voxel against the mean and mean absolute deviation of its neighbourhood.
+	*	@param bricks Bricks to be evaluated again, or nullptr to evaluate the whole grid.
+	*/
+	void locateAnomaliesMeanDeviation(int neighbors, float stdFactor, const std::vector<size_t>* bricks, TaskProgress* progress);
+
+	/**
+	*	@brief Evaluates the mean / deviation rule for the voxels in [minCell, maxCell), whose windows may reach beyond that range.
+	*/
+	void locateAnomaliesMeanDeviation(int neighbors, float stdFactor, const uvec3& minCell, const uvec3& maxCell);
+
+	/**
+	*	@brief Locates outlier voxels with CPU threads, comparing each voxel against the median and median absolute deviation of its neighbourhood.
+	*	Window histograms are slided so that the cost per voxel grows with the window width rather than its volume.
+	*	@param range Temperatures of occupied voxels, which is quantized into THERMAL_HISTOGRAM_BINS levels.
+	*	@param bricks Bricks to be evaluated again, or nullptr to evaluate the whole grid.
+	*/
+	void locateAnomaliesMedian(int neighbors, float stdFactor, const ThermalRange& range, const std::vector<size_t>* bricks, TaskProgress* progress);
+
+	/**
+	*	@brief Evaluates the median / MAD rule for the voxels in [minCell, maxCell), sliding the window histograms within that range.
+	*/
+	void locateAnomaliesMedian(int neighbors, float stdFactor, const std::vector<uint16_t>& quantized, const uvec3& minCell, const uvec3& maxCell);
+
+	/**
+	*	@return Lowest and highest temperature of occupied voxels, or an empty range if there are none.
+	*/
+	ThermalRange getThermalRange() const;
+
+	/**
+	*	@brief Retrieves the position of each X slab within the compacted array of non-empty voxels (numDivs.x + 1 offsets).
+	*/
+	void getSlabOffsets(std::vector<size_t>& slabOffset) const;
+
 public:	
 	/**
 	*	@return Index in grid array of a non-real position. 
@@ -53,8 +150,9 @@ public:
 public:
 	/**
 	*	@brief Constructor which specifies the area and the number of divisions of such area.
+	*	@param frame Transformation from grid space, where the area is given, to world space. Oriented grids fit rotated sites with fewer cells.
 	*/
-	RegularGrid(const AABB& aabb, uvec3 subdivisions);
+	RegularGrid(const AABB& aabb, uvec3 subdivisions, const mat4& frame = mat4(1.0f));
 
 	/**
 	*	@brief Constructor of an abstract regular grid with no notion of space size.
@@ -72,19 +170,31 @@ public:
     virtual ~RegularGrid();
 
 	/**
-	*	@brief Exports fragments into several models in a PLY file. 
+	*	@brief Exports fragments into several models in a PLY file. Vertices are written in double precision, in georeferenced coordinates.
+	*	@param progress Optional progress channel, which may also cancel the export between files.
 	*/
-	void exportGrid(bool fillUnderVoxels = false);
+	void exportGrid(bool fillUnderVoxels = false, TaskProgress* progress = nullptr);
 
 	/**
-	*	@brief  
+	*	@brief Marks the voxels covered by a triangle mesh. The GPU path samples numSamples random points per triangle, hence it may miss voxels
+	*	of large or thin triangles, whereas the CPU path is exact and conservative, i.e., any voxel touched by a triangle is marked.
+	*	@param progress Optional progress channel, only used by the CPU path.
 	*/
-	void fill(const std::vector<Model3D::VertexGPUData>& vertices, const std::vector<Model3D::FaceGPUData>& faces, unsigned index, int numSamples);
+	void fill(const std::vector<Model3D::VertexGPUData>& vertices, const std::vector<Model3D::FaceGPUData>& faces, unsigned index, int numSamples, bool useGPU = true, TaskProgress* progress = nullptr);
 
 	/**
-	*	@brief
+	*	@brief Bins a point cloud with CPU threads, averaging the temperature of each voxel. No OpenGL context is required, so grids can be built
+	*	away from the rendering thread.
 	*/
-	void fill(const std::vector<vec4>* vertices, std::vector<float>* thermalValues);
+	void fill(const PackedPoints* points, TaskProgress* progress = nullptr);
+
+	/**
+	*	@brief Fills the voxels whose center is inside a closed triangle mesh, which complements the surface marked by fill with a solid voxelization.
+	*	Triangles are rasterized into the crossings of vertical columns, and each column is filled between pairs of crossings, hence the cost is linear
+	*	on the number of triangles and voxels.
+	*	@param progress Optional progress channel, which may also cancel the filling.
+	*/
+	void fillInterior(const std::vector<Model3D::VertexGPUData>& vertices, const std::vector<Model3D::FaceGPUData>& faces, TaskProgress* progress = nullptr);
 
 	/**
 	*	@brif Fills voxels under a certain point cloud.
@@ -97,15 +207,55 @@ public:
 	void fillNoiseBuffer(std::vector<float>& noiseBuffer, unsigned numSamples);
 
 	/**
-	*	@brief Locates outlier thermal values in the point cloud.
+	*	@brief Locates outlier thermal values in the point cloud. If the settings match the previous search, only the voxels whose window
+	*	overlaps a brick changed since then are evaluated, with the same result as evaluating the whole grid.
+	*	@param detector One of RenderingParameters::AnomalyDetector.
+	*	@param progress Optional progress channel, which is checked for cancellation after every slab.
 	*/
-	void locateAnomalies();
+	void locateAnomalies(int detector, int neighbors, float stdFactor, TaskProgress* progress = nullptr);
 
 	/**
-	*	@return Bounding box of the regular grid. 
+	*	@brief Finds the occupied voxels seen from each viewpoint, e.g., scanner stations or inspection positions, taking the exposed faces of occupied
+	*	voxels as the only occluders. Segments from a viewpoint to every voxel are traversed in SIMD packets by BVH::isVisible.
+	*	@param viewpoints Positions in world space.
+	*	@param visible Flag of each occupied voxel, in the order given by compact, for every viewpoint, i.e., [viewpointIdx * numOccupied + voxelIdx].
+	*	@param progress Optional progress channel, checked for cancellation after every viewpoint.
+	*/
+	void locateVisibleVoxels(const std::vector<vec3>& viewpoints, std::vector<uint8_t>& visible, TaskProgress* progress = nullptr) const;
+
+	/**
+	*	@brief Gathers the values of non-empty voxels in grid order, i.e., the order of the boxes retrieved by getAABBs.
+	*/
+	void compact(const std::vector<float>& voxelValues, std::vector<float>& compactValues) const;
+
+	/**
+	*	@return Bounding box of the regular grid, in grid space.
 	*/
 	AABB getAABB() { return _aabb; }
 
+	/**
+	*	@return Size of each grid cell.
+	*/
+	vec3 getCellSize() { return _cellSize; }
+
+	/**
+	*	@return Transformation from grid space to world space.
+	*/
+	mat4 getFrame() const { return _frame; }
+
+	/**
+	*	@return Translation from world space to georeferenced coordinates.
+	*/
+	glm::dvec3 getOffset() const { return _offset; }
+
+	/**
+	*	@brief Computes a frame whose horizontal axes follow the principal directions of the cloud, keeping Y as the vertical axis so that
+	*	columns remain vertical. Points are sampled for the principal directions, whereas the grid-space box covers every point.
+	*	@param aabb Bounding box of the points in grid space.
+	*	@return Transformation from grid space to world space.
+	*/
+	static mat4 getOrientedFrame(const PackedPoints& points, AABB& aabb);
+
 	/**
 	*	@brief Retrieves grid AABBs for rendering purposes. 
 	*/
@@ -116,15 +266,34 @@ public:
 	*/
 	void insertPoint(const vec3& position, unsigned index);
 
+	/**
+	*	@brief Marks the bricks overlapping [minCell, maxCell) as changed, so that the next anomaly search evaluates them again. Edits done through
+	*	data() or thermalData() must be reported this way, whereas the other methods mark the voxels they change.
+	*/
+	void markDirty(const uvec3& minCell, const uvec3& maxCell);
+
 	/**
 	*	@brief Queries cluster for each triangle of the given mesh.
 	*/
 	void queryCluster(const std::vector<Model3D::VertexGPUData>& vertices, const std::vector<Model3D::FaceGPUData>& faces, std::vector<float>& clusterIdx);
 
+	/**
+	*	@brief Bins a point received after the grid was filled, updating the point count and running mean temperature of its voxel. Unlike fill,
+	*	points outside the grid are discarded rather than clamped into its border voxels.
+	*	@param position World-space position.
+	*	@return True if the point fell inside the grid.
+	*/
+	bool accumulatePoint(const vec3& position, float thermal);
+
 	/**
 	*	@brief Substitutes current grid with new values. 
 	*/
-	void swap(const std::vector<uint16_t>& newGrid) { if (newGrid.size() == _grid.size()) _grid = std::move(newGrid); }
+	void swap(const std::vector<uint16_t>& newGrid) { if (newGrid.size() == _grid.size()) { _grid = std::move(newGrid); this->markDirty(uvec3(0), _numDivs); } }
+
+	/**
+	*	@brief Sets the translation from world space to georeferenced coordinates, which is added to exported geometry.
+	*/
+	void setOffset(const glm::dvec3& offset) { _offset = offset; }
 
 	// ----------- External functions ----------
 
@@ -192,6 +361,11 @@ public:
 	*/
 	std::vector<float>* localPeak();
 
+	/**
+	*	@return Pointer to vector with the number of points binned into each voxel.
+	*/
+	std::vector<unsigned>* pointCount();
+
     /**
 	*   Set voxel at position [x, y, z].
 	*   @pre x in range [-1, size.x].
@@ -202,7 +376,7 @@ public:
 	*   @param[in] z Voxel z coord.
 	*   @param[in] i Voxel new color index.
 	*/
-    void set(int x, int y, int z, uint8_t i);
+    void set(int x, int y, int z, uint16_t i);
 
 	/**
 	*   Get thermal data pointer.
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "stdafx.h"
+#include "Utilities/ThreadPool.h"
+
+/**
+*	@file VoxelPass.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Parallel range visitors over a voxel grid stored as x * dims.y * dims.z + y * dims.z + z.
+*/
+class VoxelPass
+{
+public:
+	/**
+	*	@brief Distance between consecutive voxels along each axis in the flattened grid.
+	*/
+	struct Strides
+	{
+		unsigned	_x, _y, _z;
+	};
+
+public:
+	/**
+	*	@return Strides of a grid with the given dimensions.
+	*/
+	static Strides getStrides(const uvec3& numDivs) { return Strides{ numDivs.y * numDivs.z, numDivs.z, 1 }; }
+
+	/**
+	*	@brief Visits every column along Y as func(x, z, baseIndex, strideY), so that voxel y is located at baseIndex + y * strideY.
+	*/
+	template<typename Func>
+	static void forEachColumn(const uvec3& numDivs, Func func);
+
+	/**
+	*	@brief Visits every slab of constant X as func(x, firstIndex, lastIndex), where [firstIndex, lastIndex) are consecutive voxels.
+	*/
+	template<typename Func>
+	static void forEachSlab(const uvec3& numDivs, Func func);
+
+	/**
+	*	@brief Visits bricks of up to brickSize^3 voxels as func(minCell, maxCell), with maxCell exclusive.
+	*/
+	template<typename Func>
+	static void forEachBrick(const uvec3& numDivs, unsigned brickSize, Func func);
+
+	/**
+	*	@brief Visits a subset of the bricks of up to brickSize^3 voxels, given by their index in X, Y, Z order, as func(minCell, maxCell).
+	*/
+	template<typename Func>
+	static void forEachBrick(const uvec3& numDivs, unsigned brickSize, const std::vector<size_t>& bricks, Func func);
+
+	/**
+	*	@brief Maps every slab as map(x, firstIndex, lastIndex) and folds the results in X order through combine(accumulated, partial).
+	*/
+	template<typename T, typename Map, typename Combine>
+	static T reduceSlabs(const uvec3& numDivs, const T& identity, Map map, Combine combine);
+
+	/**
+	*	@brief Maps every brick as map(minCell, maxCell) and folds the results in brick order through combine(accumulated, partial).
+	*/
+	template<typename T, typename Map, typename Combine>
+	static T reduceBricks(const uvec3& numDivs, unsigned brickSize, const T& identity, Map map, Combine combine);
+
+	/**
+	*	@return Number of bricks along each axis.
+	*/
+	static uvec3 getNumBricks(const uvec3& numDivs, unsigned brickSize) { return (numDivs + uvec3(brickSize - 1)) / brickSize; }
+
+protected:
+	/**
+	*	@brief Retrieves the voxel range [minCell, maxCell) covered by the brick at the given index.
+	*/
+	static void getBrickRange(const uvec3& numDivs, unsigned brickSize, size_t brickIdx, uvec3& minCell, uvec3& maxCell);
+};
+
+template<typename Func>
+inline void VoxelPass::forEachColumn(const uvec3& numDivs, Func func)
+{
+	const Strides strides = VoxelPass::getStrides(numDivs);
+
+	// One task per X slab keeps tasks coarse enough, while columns within it are contiguous in Z
+	ThreadPool::getInstance()->parallelFor(numDivs.x, [&](size_t x)
+	{
+		const unsigned slabIndex = unsigned(x) * strides._x;
+
+		for (unsigned z = 0; z < numDivs.z; ++z)
+		{
+			func(unsigned(x), z, slabIndex + z * strides._z, strides._y);
+		}
+	});
+}
+
+template<typename Func>
+inline void VoxelPass::forEachSlab(const uvec3& numDivs, Func func)
+{
+	const Strides strides = VoxelPass::getStrides(numDivs);
+
+	ThreadPool::getInstance()->parallelFor(numDivs.x, [&](size_t x)
+	{
+		func(unsigned(x), unsigned(x) * strides._x, unsigned(x + 1) * strides._x);
+	});
+}
+
+template<typename Func>
+inline void VoxelPass::forEachBrick(const uvec3& numDivs, unsigned brickSize, Func func)
+{
+	const uvec3 numBricks = VoxelPass::getNumBricks(numDivs, brickSize);
+
+	ThreadPool::getInstance()->parallelFor(size_t(numBricks.x) * numBricks.y * numBricks.z, [&](size_t brickIdx)
+	{
+		uvec3 minCell, maxCell;
+		VoxelPass::getBrickRange(numDivs, brickSize, brickIdx, minCell, maxCell);
+
+		func(minCell, maxCell);
+	});
+}
+
+template<typename Func>
+inline void VoxelPass::forEachBrick(const uvec3& numDivs, unsigned brickSize, const std::vector<size_t>& bricks, Func func)
+{
+	ThreadPool::getInstance()->parallelFor(bricks.size(), [&](size_t taskIdx)
+	{
+		uvec3 minCell, maxCell;
+		VoxelPass::getBrickRange(numDivs, brickSize, bricks[taskIdx], minCell, maxCell);
+
+		func(minCell, maxCell);
+	});
+}
+
+template<typename T, typename Map, typename Combine>
+inline T VoxelPass::reduceSlabs(const uvec3& numDivs, const T& identity, Map map, Combine combine)
+{
+	const Strides strides = VoxelPass::getStrides(numDivs);
+
+	return ThreadPool::getInstance()->parallelReduce(numDivs.x, identity, [&](size_t x)
+	{
+		return map(unsigned(x), unsigned(x) * strides._x, unsigned(x + 1) * strides._x);
+	}, combine);
+}
+
+template<typename T, typename Map, typename Combine>
+inline T VoxelPass::reduceBricks(const uvec3& numDivs, unsigned brickSize, const T& identity, Map map, Combine combine)
+{
+	const uvec3 numBricks = VoxelPass::getNumBricks(numDivs, brickSize);
+
+	return ThreadPool::getInstance()->parallelReduce(size_t(numBricks.x) * numBricks.y * numBricks.z, identity, [&](size_t brickIdx)
+	{
+		uvec3 minCell, maxCell;
+		VoxelPass::getBrickRange(numDivs, brickSize, brickIdx, minCell, maxCell);
+
+		return map(minCell, maxCell);
+	}, combine);
+}
+
+inline void VoxelPass::getBrickRange(const uvec3& numDivs, unsigned brickSize, size_t brickIdx, uvec3& minCell, uvec3& maxCell)
+{
+	const uvec3 numBricks = VoxelPass::getNumBricks(numDivs, brickSize);
+	const uvec3 brick = uvec3(brickIdx / (size_t(numBricks.y) * numBricks.z), (brickIdx / numBricks.z) % numBricks.y, brickIdx % numBricks.z);
+
+	minCell = brick * brickSize;
+	maxCell = glm::min(minCell + uvec3(brickSize), numDivs);
+}
@@ -65,6 +65,11 @@ public:
 	*/
 	std::vector<AABB> split(const unsigned edgeDivisions) const;
 
+	/**
+	*	@return Axis-aligned bounding box of this box once transformed by the given matrix.
+	*/
+	AABB transform(const mat4& matrix) const;
+
 	/**
 	*	@brief Updates the boundaries with a new axis aligned bounding box.
 	*/
@@ -70,9 +70,8 @@ EisemannRay EisemannRay::operator=(const EisemannRay& ray)
 
 bool EisemannRay::intersect(const AABB& aabb)
 {
-	auto function = _testFunction[_rayType];
-
-	return function(*this, aabb.min(), aabb.max());
+	// The function is neither copied nor inserted if missing, which also allows testing rays from several threads
+	return _testFunction.at(_rayType)(*this, aabb.min(), aabb.max());
 }
 
 /// [Protected methods]
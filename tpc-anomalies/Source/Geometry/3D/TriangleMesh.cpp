@@ -2,6 +2,7 @@
 #include "TriangleMesh.h"
 
 #include "Geometry/3D/Intersections3D.h"
+#include "Graphics/Core/OBJReader.h"
 #include "Utilities/ChronoUtilities.h"
 
 /// [Public methods]
@@ -82,6 +83,23 @@ void TriangleMesh::computeTangents()
 	delete[] tan1;
 }
 
+const BVH* TriangleMesh::getBVH()
+{
+	if (!_bvh)
+	{
+		std::vector<Triangle3D> triangles(_face.size());
+
+		for (int i = 0; i < _face.size(); ++i)
+		{
+			triangles[i] = Triangle3D(_position[_face[i].getVertexIndex(0)], _position[_face[i].getVertexIndex(1)], _position[_face[i].getVertexIndex(2)]);
+		}
+
+		_bvh.reset(new BVH(triangles));
+	}
+
+	return _bvh.get();
+}
+
 vec3 TriangleMesh::getVertex(int i) const
 {
 	return (i < _position.size()) ? _position[i] : vec3();
@@ -106,12 +124,12 @@ bool TriangleMesh::pointInMesh(const vec3& point)
 	std::vector<vec3> points;
 
 	int oddIntersections = 0;
-	rayTraversalExh(ray_01, points, triangle);
+	rayTraversal(ray_01, points, triangle);
 	if (triangle.size() % 2 == 1) ++oddIntersections;
 	triangle.clear();
 	points.clear();
 
-	rayTraversalExh(ray_02, points, triangle);
+	rayTraversal(ray_02, points, triangle);
 	if (triangle.size() % 2 == 1) ++oddIntersections;
 
 	if (oddIntersections == 1)					// Odd number of intersections, throw a third one to break the question
@@ -119,7 +137,7 @@ bool TriangleMesh::pointInMesh(const vec3& point)
 		triangle.clear();
 		points.clear();
 
-		rayTraversalExh(ray_03, points, triangle);
+		rayTraversal(ray_03, points, triangle);
 		if (!(triangle.size() % 2 == 1))
 		{
 			return false;
@@ -136,6 +154,7 @@ bool TriangleMesh::pointInMesh(const vec3& point)
 Triangle3D* TriangleMesh::pushBackFace(const unsigned i1, const unsigned i2, const unsigned i3)
 {
 	_face.push_back(Face(i1, i2, i3, this));
+	_bvh.reset();
 
 	return &_face[_face.size() - 1]._triangle;
 }
@@ -152,6 +171,24 @@ size_t TriangleMesh::pushBackVertex(const vec3& position, const vec3& normal, co
 	return _position.size() - 1;
 }
 
+bool TriangleMesh::rayIntersection(Ray3D& ray, vec3& point, unsigned& face)
+{
+	return this->getBVH()->closestHit(ray, point, face);
+}
+
+bool TriangleMesh::rayTraversal(Ray3D& ray, std::vector<vec3>& point, std::vector<Triangle3D>& triangle)
+{
+	std::vector<unsigned> faces;
+	this->getBVH()->allHits(ray, point, faces);
+
+	for (unsigned face : faces)
+	{
+		triangle.push_back(Triangle3D(_position[_face[face].getVertexIndex(0)], _position[_face[face].getVertexIndex(1)], _position[_face[face].getVertexIndex(2)]));
+	}
+
+	return !faces.empty();
+}
+
 bool TriangleMesh::rayTraversalExh(Ray3D& ray, std::vector<vec3>& point, std::vector<Triangle3D>& triangle)
 {
 	for (int i = 0; i < _face.size(); ++i)
@@ -180,6 +217,7 @@ void TriangleMesh::copyAttributes(const TriangleMesh& mesh)
 	this->_face			= mesh._face;
 
 	this->_aabb			= mesh._aabb;
+	this->_bvh.reset();
 
 	for (int i = 0; i < _face.size(); ++i)
 	{
@@ -189,80 +227,27 @@ void TriangleMesh::copyAttributes(const TriangleMesh& mesh)
 
 bool TriangleMesh::loadOBJ(const std::string& filename)
 {
-	FILE* file = nullptr; errno_t error;
+	OBJReader reader;
+	std::vector<uvec3> faces;
 
-	if ((error = fopen_s(&file, filename.c_str(), "r")) != 0)
+	if (!reader.read(filename, _position, _normal, _textCoord, faces))
 	{
 		std::cout << "The file could not be opened!" << std::endl;
 
 		return false;
 	}
 
-	std::vector<glm::vec3> tempNormals;						// Temporal data for the loading process
-	std::vector<glm::vec2> tempTextures;
-	vec3 normal;
-	vec2 textCoord;
-
-	int result;
-	char lineHeader[128];
-	unsigned int incorrectPrimitives = 0;
-
-	while ((result = fscanf_s(file, "%s", lineHeader, sizeof(lineHeader))) != EOF)				// Type of geometry we are receiving
-	{
-		if (strcmp(lineHeader, "v") == 0)					// Vertex
-		{
-			vec3 vertex;
-			fscanf_s(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
-
-			_position.push_back(vec4(vertex, 1.0f));
-			_normal.resize(_position.size());
-			_textCoord.resize(_position.size());
-
-			_aabb.update(vertex);
-		}
-		else if (strcmp(lineHeader, "vt") == 0)				// Texture coordinate
-		{
-			fscanf_s(file, "%f %f\n", &textCoord.x, &textCoord.y);
-
-			tempTextures.push_back(textCoord);
-		}
-		else if (strcmp(lineHeader, "vn") == 0)				// Normal
-		{
-			fscanf_s(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
+	for (const vec4& position : _position) _aabb.update(vec3(position));
 
-			tempNormals.push_back(normal);
-		}
-		else if (strcmp(lineHeader, "f") == 0)				// Triangle mesh face indices
-		{
-			std::string vertex1, vertex2, vertex3;
-			unsigned int vertexIndex[3], textureIndex[3], normalIndex[3];
-			int matches = fscanf_s(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n",
-				&vertexIndex[0], &textureIndex[0], &normalIndex[0],
-				&vertexIndex[1], &textureIndex[1], &normalIndex[1],
-				&vertexIndex[2], &textureIndex[2], &normalIndex[2]);
-
-			if (matches != 9) {
-				++incorrectPrimitives;
-			}
-
-			_face.push_back(Face(vertexIndex[0] - 1, vertexIndex[1] - 1, vertexIndex[2] - 1, this));
-
-			_normal[vertexIndex[0] - 1] = tempNormals[normalIndex[0] - 1];
-			_normal[vertexIndex[1] - 1] = tempNormals[normalIndex[1] - 1];
-			_normal[vertexIndex[2] - 1] = tempNormals[normalIndex[2] - 1];
-
-			_textCoord[vertexIndex[0] - 1] = tempTextures[textureIndex[0] - 1];
-			_textCoord[vertexIndex[1] - 1] = tempTextures[textureIndex[1] - 1];
-			_textCoord[vertexIndex[2] - 1] = tempTextures[textureIndex[2] - 1];
-		}
-	}
+	// Faces are created at once and then updated in parallel, since each of them caches its triangle
+	_face.assign(faces.size(), Face(this));
+	_bvh.reset();
 
-	fclose(file);
-
-	if (incorrectPrimitives > 0)
+	std::for_each(std::execution::par_unseq, _face.begin(), _face.end(), [&](Face& face)
 	{
-		std::cout << incorrectPrimitives << " primitives were not a triangle!" << std::endl;
-	}
+		const uvec3& indices = faces[&face - _face.data()];
+		face.setIndexes(indices.x, indices.y, indices.z);
+	});
 
 	return true;
 }
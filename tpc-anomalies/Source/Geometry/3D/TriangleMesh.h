@@ -1,5 +1,6 @@
 #pragma once
 
+#include "DataStructures/BVH.h"
 #include "Geometry/3D/AABB.h"
 #include "Geometry/3D/Plane.h"
 #include "Geometry/3D/Ray3D.h"
@@ -36,6 +37,7 @@ protected:
 
 	// [Spatial data]
 	AABB				_aabb;									//!< Axis-aligned bounding box
+	std::unique_ptr<BVH> _bvh;									//!< Hierarchy of faces for ray queries, built on demand and discarded when faces are added
 
 protected:
 	/**
@@ -44,7 +46,7 @@ protected:
 	void copyAttributes(const TriangleMesh& mesh);
 
 	/**
-	*	@brief Reads an obj file to load its data into a triangle mesh.
+	*	@brief Reads an obj file to load its data into a triangle mesh, parsing it in parallel with OBJReader.
 	*/
 	bool loadOBJ(const std::string& filename);
 
@@ -89,6 +91,11 @@ public:
 	*/
 	size_t getNumTriangles() const { return _face.size(); }
 
+	/**
+	*	@return Hierarchy of faces, which is built if it does not exist yet.
+	*/
+	const BVH* getBVH();
+
 	/**
 	*	@return Point from the mesh.
 	*/
@@ -105,7 +112,7 @@ public:
 	TriangleMesh& operator=(const TriangleMesh& mesh);
 
 	/**
-	*	@brief Checks if a point is inside the triangle mesh with an exhaustive method.
+	*	@brief Checks if a point is inside the triangle mesh by counting the faces crossed by axis-aligned rays.
 	*/
 	bool pointInMesh(const vec3& point);
 
@@ -121,6 +128,16 @@ public:
 	*/
 	size_t pushBackVertex(const vec3& position, const vec3& normal, const vec2& textCoord = vec2(1.0f), const vec3& tangent = vec3(1.0f));
 
+	/**
+	*	@brief Calculates the closest face intersected by the given ray, e.g., for picking.
+	*/
+	bool rayIntersection(Ray3D& ray, vec3& point, unsigned& face);
+
+	/**
+	*	@brief Calculates all the triangles the given ray intersects through the hierarchy of faces, in the same order as rayTraversalExh.
+	*/
+	bool rayTraversal(Ray3D& ray, std::vector<vec3>& point, std::vector<Triangle3D>& triangle);
+
 	/**
 	*	@brief Calculates (exhaustively) all the triangles the given ray intersects.
 	*/
@@ -0,0 +1,114 @@
+#include "stdafx.h"
+#include "AsyncCloudLoader.h"
+
+/// [Public methods]
+
+AsyncCloudLoader::AsyncCloudLoader(PointCloud* pointCloud, size_t budget, const mat4& modelMatrix) :
+	_budget(budget), _modelMatrix(modelMatrix), _pointCloud(pointCloud), _displayOrigin(std::numeric_limits<double>::max()), _finished(false), _numSlots(0), _pointsReady(false),
+	_progress(std::make_shared<TaskProgress>()), _stride(1), _reserved(false), _uploaded(0)
+{
+	_worker = std::thread(&AsyncCloudLoader::load, this);
+}
+
+AsyncCloudLoader::~AsyncCloudLoader()
+{
+	_progress->cancel();
+	_worker.join();
+}
+
+AABB AsyncCloudLoader::getLoadedAABB()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	return _aabb;
+}
+
+size_t AsyncCloudLoader::upload()
+{
+	std::vector<PointRange> ranges;
+	size_t numSlots;
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		ranges.swap(_pending);
+		numSlots = _numSlots;
+	}
+
+	if (!_reserved && numSlots)
+	{
+		_pointCloud->reserveRenderedPoints(numSlots);
+		_reserved = true;
+	}
+
+	size_t numUploaded = 0;
+
+	for (const PointRange& range : ranges)
+	{
+		_pointCloud->appendRenderedPoints(range._firstSlot, range._points.size(), range._points.data(), range._rgb.data());
+		numUploaded += range._points.size();
+	}
+
+	_uploaded += numUploaded;
+
+	return numUploaded;
+}
+
+void AsyncCloudLoader::reserve(size_t numPoints)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	// Slots follow the point indices, so that ranges fill disjoint slots whatever the order they are read in
+	_stride = _budget && numPoints > _budget ? (numPoints + _budget - 1) / _budget : 1;
+	_numSlots = (numPoints + _stride - 1) / _stride;
+}
+
+void AsyncCloudLoader::append(size_t firstPoint, size_t numPoints, const vec4* points, const vec3* rgb, const glm::dvec3& origin)
+{
+	size_t stride;
+	glm::dvec3 displayOrigin;
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (_displayOrigin.x == std::numeric_limits<double>::max()) _displayOrigin = origin;
+
+		stride = _stride;
+		displayOrigin = _displayOrigin;
+	}
+
+	// Files read relative to different origins are shown together; the final buffers use the offset of the whole cloud instead
+	const vec4 shift(vec3(origin - displayOrigin), .0f);
+	const size_t firstKept = (firstPoint + stride - 1) / stride * stride;
+
+	PointRange range;
+	range._firstSlot = firstKept / stride;
+	AABB aabb;
+
+	for (size_t pointIdx = firstKept; pointIdx < firstPoint + numPoints; pointIdx += stride)
+	{
+		range._points.push_back(points[pointIdx - firstPoint] + shift);
+		range._rgb.push_back(rgb[pointIdx - firstPoint]);
+		aabb.update(vec3(range._points.back()));
+	}
+
+	if (range._points.empty()) return;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_aabb.update(aabb);
+	_pending.push_back(std::move(range));
+}
+
+/// [Protected methods]
+
+void AsyncCloudLoader::load()
+{
+	try
+	{
+		_pointCloud->load(_modelMatrix, _progress.get(), this);
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << "Point cloud could not be loaded: " << exception.what() << std::endl;
+	}
+
+	_finished = true;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Graphics/Core/PointCloud.h"
+#include "Utilities/TaskProgress.h"
+
+/**
+*	@file AsyncCloudLoader.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Loads a point cloud on a worker thread. Decoded ranges are published as they are read, and the rendering thread appends them
+*	to GPU buffers every frame, so that the cloud is drawn while it is still being loaded. Clouds above the preview budget are strided down to it
+*	until the decimated preview replaces them.
+*/
+class AsyncCloudLoader: public PointCloud::LoadListener
+{
+protected:
+	/**
+	*	@brief Points of a published range which are kept for rendering.
+	*/
+	struct PointRange
+	{
+		size_t					_firstSlot;							//!< Position of the first point in the rendering buffers
+		std::vector<vec4>		_points;							//!< Positions relative to the display origin
+		std::vector<vec3>		_rgb;								//!< Provisional colours
+	};
+
+protected:
+	size_t						_budget;							//!< Maximum number of points rendered while loading, zero to render every point
+	mat4						_modelMatrix;						//!< Model transformation given to the cloud
+	PointCloud*					_pointCloud;						//!< Cloud to be loaded (not owned)
+
+	// Shared with the worker
+	AABB						_aabb;								//!< Bounding box of the published points, relative to the display origin
+	glm::dvec3					_displayOrigin;						//!< Origin of the first published range, which every range is moved to
+	std::atomic<bool>			_finished;							//!< The worker finished, either successfully or not
+	std::mutex					_mutex;								//!< Protects the pending ranges, the reserved slots and the display origin
+	size_t						_numSlots;							//!< Points rendered while loading, zero until the cloud size is known
+	std::vector<PointRange>		_pending;							//!< Ranges published but not yet uploaded
+	std::atomic<bool>			_pointsReady;						//!< Points of the cloud are final, though the preview may not be built yet
+	std::shared_ptr<TaskProgress> _progress;						//!< Progress of the load
+	size_t						_stride;							//!< Only every stride-th point is rendered while loading
+	std::thread					_worker;							//!< Thread where the cloud is loaded
+
+	// Owned by the rendering thread
+	bool						_reserved;							//!< GPU buffers were allocated
+	size_t						_uploaded;							//!< Points uploaded to the GPU buffers
+
+protected:
+	/**
+	*	@brief Loads the cloud, handing every decoded range over to this listener.
+	*/
+	void load();
+
+public:
+	/**
+	*	@brief Constructor. The cloud starts loading right away.
+	*	@param budget Maximum number of points rendered while loading, zero to render every point.
+	*/
+	AsyncCloudLoader(PointCloud* pointCloud, size_t budget, const mat4& modelMatrix = mat4(1.0f));
+
+	/**
+	*	@brief Invalid copy constructor.
+	*/
+	AsyncCloudLoader(const AsyncCloudLoader& loader) = delete;
+
+	/**
+	*	@brief Destructor. Cancels the load in progress, which leaves the cloud empty.
+	*/
+	virtual ~AsyncCloudLoader();
+
+	/**
+	*	@return Bounding box of the published points, relative to the origin of the first published range.
+	*/
+	AABB getLoadedAABB();
+
+	/**
+	*	@return Progress of the load.
+	*/
+	std::shared_ptr<TaskProgress> getProgress() { return _progress; }
+
+	/**
+	*	@return Number of points uploaded to the GPU so far.
+	*/
+	size_t getNumberOfUploadedPoints() const { return _uploaded; }
+
+	/**
+	*	@return True once the worker finished, either successfully or not.
+	*/
+	bool isFinished() const { return _finished; }
+
+	/**
+	*	@return True once the points of the cloud are final, i.e., grids can be built from them.
+	*/
+	bool isPointsReady() const { return _pointsReady; }
+
+	/**
+	*	@brief Appends the ranges published since the last call to the GPU buffers of the cloud. Must be called from the OpenGL thread.
+	*	@return Number of uploaded points.
+	*/
+	size_t upload();
+
+	// Listener interface, called from the loading threads
+
+	/**
+	*	@brief Fixes the stride which keeps the rendered points within the budget.
+	*/
+	virtual void reserve(size_t numPoints);
+
+	/**
+	*	@brief Copies every stride-th point of the range, moved to the display origin.
+	*/
+	virtual void append(size_t firstPoint, size_t numPoints, const vec4* points, const vec3* rgb, const glm::dvec3& origin);
+
+	/**
+	*	@brief Marks the points as final.
+	*/
+	virtual void pointsReady() { _pointsReady = true; }
+};
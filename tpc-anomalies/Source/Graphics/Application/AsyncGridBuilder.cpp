@@ -0,0 +1,203 @@
+#include "stdafx.h"
+#include "AsyncGridBuilder.h"
+
+#include "DataStructures/GridCache.h"
+#include "DataStructures/GridResolution.h"
+
+/// [Public methods]
+
+AsyncGridBuilder::AsyncGridBuilder(PointCloud* pointCloud, const AABB& aabb) :
+	_aabb(aabb), _orientedFrame(1.0f), _orientationReady(false), _pointCloud(pointCloud), _backBuffer(nullptr), _building(false), _request(nullptr), _stop(false), _throughput(GridResolution::DEFAULT_THROUGHPUT)
+{
+	_worker = std::thread(&AsyncGridBuilder::workerLoop, this);
+}
+
+AsyncGridBuilder::~AsyncGridBuilder()
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_stop = true;
+		if (_progress) _progress->cancel();
+	}
+
+	_condition.notify_all();
+	_worker.join();
+
+	delete _request;
+	delete _backBuffer.exchange(nullptr);
+}
+
+void AsyncGridBuilder::cancel()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	delete _request;
+	_request = nullptr;
+	if (_progress) _progress->cancel();
+}
+
+bool AsyncGridBuilder::getOrientedFrame(mat4& frame, AABB& aabb) const
+{
+	if (!_orientationReady) return false;
+
+	frame = _orientedFrame;
+	aabb = _orientedAABB;
+
+	return true;
+}
+
+std::shared_ptr<TaskProgress> AsyncGridBuilder::getProgress()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	return _progress;
+}
+
+AsyncGridBuilder::GridBuffer* AsyncGridBuilder::createBuffer(RegularGrid* grid, const RenderingParameters& rendParams, TaskProgress& progress)
+{
+	std::unique_ptr<GridBuffer> buffer(new GridBuffer);
+
+	progress.checkpoint();
+	grid->getAABBs(buffer->_aabbs);
+
+	progress.checkpoint();
+	HotspotLabeling::label(grid, HotspotLabeling::Connectivity(rendParams._hotspotConnectivity), buffer->_hotspots);
+	HotspotLabeling::filter(buffer->_hotspots, unsigned(rendParams._hotspotMinVoxels));
+	std::cout << "Number of Hotspots: " << buffer->_hotspots.size() << std::endl;
+
+	// Rendering buffers are unpacked from the packed channels, in the same grid order as the boxes
+	progress.checkpoint();
+	buffer->_grid = new PackedGrid(grid, rendParams._quantizeGridThermal);
+	buffer->_grid->unpackThermal(buffer->_thermal);
+	buffer->_grid->unpackPeaks(buffer->_localPeak);
+	std::cout << "Packed grid: " << buffer->_grid->count() << " occupied voxels, " << buffer->_grid->getMemoryFootprint() / 1024 << " KB" << std::endl;
+
+	return buffer.release();
+}
+
+bool AsyncGridBuilder::isBuilding()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	return _building || _request;
+}
+
+void AsyncGridBuilder::request(const RenderingParameters& rendParams, const ivec3& subdivisions)
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		delete _request;
+		_request = new BuildRequest{ rendParams, subdivisions };
+
+		// Stages check the token after every block, so the worker moves on to the new request within milliseconds
+		if (_progress) _progress->cancel();
+	}
+
+	_condition.notify_one();
+}
+
+/// [Protected methods]
+
+AsyncGridBuilder::GridBuffer* AsyncGridBuilder::build(const BuildRequest& request, TaskProgress& progress)
+{
+	const RenderingParameters& rendParams = request._rendParams;
+
+	// ChronoUtilities keeps a single global clock, which the rendering thread may be using
+	const std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	// Oriented grids follow the principal horizontal directions of the cloud instead of the world axes
+	AABB gridAABB = _aabb;
+	mat4 frame(1.0f);
+	if (rendParams._orientedGrid) this->getOrientedFrame(frame, gridAABB);
+
+	// Cached grids already hold their temperatures and peaks, so binning and detection are skipped
+	std::unique_ptr<RegularGrid> grid;
+	uint64_t cacheKey = 0;
+	bool cached = false;
+
+	if (rendParams._useGridCache)
+	{
+		progress.beginStage("Looking up grid cache", 0, "grids");
+		cacheKey = GridCache::getKey(_pointCloud->getContentHash(), gridAABB, frame, request._subdivisions, rendParams._gridNeighbors, rendParams._stdFactor, rendParams._fillUnderVoxels, rendParams._anomalyDetector);
+		grid.reset(GridCache::read(cacheKey, request._subdivisions));
+
+		cached = grid != nullptr;
+		if (cached) std::cout << "Grid loaded from cache" << std::endl;
+	}
+
+	if (!grid)
+	{
+		// Every stage runs on CPU threads, as OpenGL calls are only valid on the rendering thread
+		grid.reset(new RegularGrid(gridAABB, request._subdivisions, frame));
+		grid->fill(_pointCloud->getPoints(), &progress);
+		if (rendParams._fillUnderVoxels) grid->fillUnderCloud();
+		grid->locateAnomalies(rendParams._anomalyDetector, rendParams._gridNeighbors, rendParams._stdFactor, &progress);
+
+		if (rendParams._useGridCache && !GridCache::write(cacheKey, grid.get())) std::cerr << "Grid could not be cached" << std::endl;
+	}
+
+	// Cached grids are shared by clouds with the same content, which includes the offset
+	grid->setOffset(_pointCloud->getOffset());
+
+	if (rendParams._locatePointAnomalies)
+	{
+		const size_t numAnomalies = _pointCloud->locateAnomalies(rendParams._anomalyDetector == RenderingParameters::MEDIAN_MAD, unsigned(rendParams._pointNeighbors), rendParams._pointRadius, rendParams._pointStdFactor, &progress);
+		std::cout << "Number of Anomalous Points: " << numAnomalies << std::endl;
+	}
+
+	// Only the packed channels stay resident
+	std::unique_ptr<GridBuffer> buffer(AsyncGridBuilder::createBuffer(grid.get(), rendParams, progress));
+	grid.reset();
+
+	// Measured rate drives the time predicted for the following resolutions
+	const float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - startTime).count();
+	if (!cached && seconds > .0f) _throughput = (_pointCloud->getNumberOfPoints() + buffer->_grid->length()) / seconds;
+
+	std::cout << "Grid built in " << unsigned(seconds * 1000.0f) << " ms" << std::endl;
+
+	return buffer.release();
+}
+
+void AsyncGridBuilder::workerLoop()
+{
+	// Computed before the first build, which therefore always finds it, and away from the rendering thread, which only polls it for estimates
+	_orientedFrame = RegularGrid::getOrientedFrame(*_pointCloud->getPoints(), _orientedAABB);
+	_orientationReady = true;
+
+	while (true)
+	{
+		BuildRequest* request;
+		std::shared_ptr<TaskProgress> progress;
+
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_building = false;
+			_progress.reset();
+			_condition.wait(lock, [this]() { return _stop || _request; });
+
+			if (_stop) return;
+
+			request = _request;
+			_request = nullptr;
+			_building = true;
+			_progress = progress = std::make_shared<TaskProgress>();
+		}
+
+		try
+		{
+			// A grid which was never acquired is superseded by the new one
+			delete _backBuffer.exchange(this->build(*request, *progress));
+		}
+		catch (const TaskCancelled&)
+		{
+			std::cout << "Grid build cancelled" << std::endl;
+		}
+		catch (const std::exception& exception)
+		{
+			std::cerr << "Grid could not be built: " << exception.what() << std::endl;
+		}
+
+		delete request;
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "DataStructures/HotspotLabeling.h"
+#include "DataStructures/PackedGrid.h"
+#include "DataStructures/RegularGrid.h"
+#include "Graphics/Application/RenderingParameters.h"
+#include "Graphics/Core/PointCloud.h"
+#include "Utilities/TaskProgress.h"
+
+/**
+*	@file AsyncGridBuilder.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Builds regular grids of a point cloud on a worker thread. Finished grids are published into a back buffer
+*	which the rendering thread acquires and uploads to the GPU.
+*/
+class AsyncGridBuilder
+{
+public:
+	/**
+	*	@brief Grid and every CPU-side buffer needed to render it.
+	*/
+	struct GridBuffer
+	{
+		PackedGrid*								_grid;				//!< Packed grid, owned by this buffer until released
+		std::vector<AABB>						_aabbs;				//!< Boxes of non-empty voxels, in grid order
+		std::vector<float>						_thermal;			//!< Temperature of non-empty voxels, in grid order
+		std::vector<float>						_localPeak;			//!< Peak type of non-empty voxels, in grid order
+		std::vector<HotspotLabeling::Hotspot>	_hotspots;			//!< Connected anomalies
+
+		/**
+		*	@brief Default constructor.
+		*/
+		GridBuffer() : _grid(nullptr) {}
+
+		/**
+		*	@brief Destructor.
+		*/
+		~GridBuffer() { delete _grid; }
+	};
+
+protected:
+	/**
+	*	@brief Parameters of a pending build, copied when it was requested.
+	*/
+	struct BuildRequest
+	{
+		RenderingParameters		_rendParams;						//!< Snapshot of rendering parameters
+		ivec3					_subdivisions;						//!< Grid resolution
+	};
+
+protected:
+	AABB						_aabb;								//!< Space covered by grids
+	AABB						_orientedAABB;						//!< Space covered by oriented grids, in grid space
+	mat4						_orientedFrame;						//!< Frame of oriented grids
+	std::atomic<bool>			_orientationReady;					//!< The oriented frame and box were computed
+	PointCloud*					_pointCloud;						//!< Cloud to be binned (not owned)
+
+	std::atomic<GridBuffer*>	_backBuffer;						//!< Latest finished grid, not yet acquired
+	bool						_building;							//!< A request is being processed
+	std::condition_variable		_condition;							//!< Wakes up the worker
+	std::mutex					_mutex;								//!< Protects pending request, progress and state flags
+	std::shared_ptr<TaskProgress> _progress;						//!< Progress of the build in progress, if any
+	BuildRequest*				_request;							//!< Latest request not yet started
+	bool						_stop;								//!< Worker must finish
+	std::atomic<float>			_throughput;						//!< Points plus voxels per second of the last build which was not cached
+	std::thread					_worker;							//!< Thread where grids are built
+
+protected:
+	/**
+	*	@brief Runs every CPU stage of a grid build.
+	*/
+	GridBuffer* build(const BuildRequest& request, TaskProgress& progress);
+
+	/**
+	*	@brief Waits for requests and builds them one after another.
+	*/
+	void workerLoop();
+
+public:
+	/**
+	*	@brief Constructor. Grids cover the given bounding box.
+	*/
+	AsyncGridBuilder(PointCloud* pointCloud, const AABB& aabb);
+
+	/**
+	*	@brief Invalid copy constructor.
+	*/
+	AsyncGridBuilder(const AsyncGridBuilder& builder) = delete;
+
+	/**
+	*	@brief Destructor. Waits for the build in progress, if any.
+	*/
+	virtual ~AsyncGridBuilder();
+
+	/**
+	*	@return Latest finished grid, or null if none was published since the last call. The caller takes ownership.
+	*/
+	GridBuffer* acquire() { return _backBuffer.exchange(nullptr); }
+
+	/**
+	*	@brief Drops the pending request and cancels the build in progress.
+	*/
+	void cancel();
+
+	/**
+	*	@brief Gathers the boxes, hotspots and packed copy of a grid whose anomalies are already located. The grid itself is left untouched.
+	*/
+	static GridBuffer* createBuffer(RegularGrid* grid, const RenderingParameters& rendParams, TaskProgress& progress);
+
+	/**
+	*	@return Progress of the build in progress, or null if the worker is idle.
+	*/
+	std::shared_ptr<TaskProgress> getProgress();
+
+	/**
+	*	@brief Retrieves the frame and grid-space box of oriented grids, which only depend on the cloud and are computed once by the worker.
+	*	@return False if they are still being computed.
+	*/
+	bool getOrientedFrame(mat4& frame, AABB& aabb) const;
+
+	/**
+	*	@return Points plus voxels processed per second by the last build which was not cached, or a default rate before any.
+	*/
+	float getThroughput() const { return _throughput; }
+
+	/**
+	*	@return True if a grid is being built or waiting to be built.
+	*/
+	bool isBuilding();
+
+	/**
+	*	@brief Queues a new build. A request that did not start yet is replaced by this one, and the build in progress is cancelled.
+	*/
+	void request(const RenderingParameters& rendParams, const ivec3& subdivisions);
+};
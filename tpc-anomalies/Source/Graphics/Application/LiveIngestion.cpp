@@ -0,0 +1,183 @@
+#include "stdafx.h"
+#include "LiveIngestion.h"
+
+// Initialization of static attributes
+const unsigned LiveIngestion::FRAME_HEADER_SIZE = 2 * sizeof(uint32_t);
+const uint32_t LiveIngestion::FRAME_MAGIC = 0x4C435054;				// TPCL
+const unsigned LiveIngestion::FRAME_POINT_SIZE = 3 * sizeof(double) + sizeof(float);
+const unsigned LiveIngestion::IDLE_MILLISECONDS = 2;
+const unsigned LiveIngestion::MAX_FRAME_POINTS = 1 << 20;
+const unsigned LiveIngestion::QUEUE_CAPACITY = 256;
+const unsigned LiveIngestion::READ_SIZE = 1 << 20;
+const unsigned LiveIngestion::READ_TIMEOUT_MILLISECONDS = 50;
+
+/// [Public methods]
+
+LiveIngestion::LiveIngestion(RegularGrid* grid, const RenderingParameters& rendParams) :
+	_backBuffer(nullptr), _grid(grid), _numBatches(0), _numDiscarded(0), _numPoints(0), _numPublished(0), _offset(grid->getOffset()), _progress(false),
+	_queue(QUEUE_CAPACITY), _rendParams(rendParams), _stop(false)
+{
+}
+
+LiveIngestion::~LiveIngestion()
+{
+	_stop = true;
+	_progress.cancel();
+
+	if (_reader.joinable()) _reader.join();
+	if (_accumulator.joinable()) _accumulator.join();
+
+	Batch* batch;
+	while (_queue.pop(batch)) delete batch;
+
+	delete _backBuffer.exchange(nullptr);
+}
+
+bool LiveIngestion::start()
+{
+	if (_reader.joinable() || !_channel.open(InputChannel::Source(_rendParams._liveSource), _rendParams._livePipeBuffer, uint16_t(_rendParams._livePort))) return false;
+
+	_reader = std::thread(&LiveIngestion::readerLoop, this);
+	_accumulator = std::thread(&LiveIngestion::accumulatorLoop, this);
+
+	return true;
+}
+
+/// [Protected methods]
+
+void LiveIngestion::accumulatorLoop()
+{
+	const std::chrono::milliseconds refreshPeriod(std::max(_rendParams._liveRefreshMilliseconds, 0));
+	std::chrono::steady_clock::time_point lastPublished = std::chrono::steady_clock::now();
+	bool modified = false;
+
+	while (!_stop)
+	{
+		Batch* batch;
+		bool received = false;
+
+		// Batches keep arriving while the scanner is running, hence the refresh is checked between them rather than once the queue is empty
+		while (!_stop && !(modified && std::chrono::steady_clock::now() - lastPublished >= refreshPeriod) && _queue.pop(batch))
+		{
+			size_t numBinned = 0;
+			for (const vec4& point : *batch) numBinned += _grid->accumulatePoint(vec3(point), point.w);
+
+			_numPoints += numBinned;
+			_numDiscarded += batch->size() - numBinned;
+			modified |= numBinned > 0;
+			received = true;
+
+			delete batch;
+		}
+
+		if (modified && std::chrono::steady_clock::now() - lastPublished >= refreshPeriod)
+		{
+			try
+			{
+				this->publish();
+			}
+			catch (const TaskCancelled&)
+			{
+				return;
+			}
+			catch (const std::exception& exception)
+			{
+				std::cerr << "Live grid could not be published: " << exception.what() << std::endl;
+			}
+
+			lastPublished = std::chrono::steady_clock::now();
+			modified = false;
+		}
+		else if (!received)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_MILLISECONDS));
+		}
+	}
+}
+
+size_t LiveIngestion::decodeFrames(const std::vector<uint8_t>& bytes)
+{
+	size_t position = 0;
+
+	while (bytes.size() - position >= FRAME_HEADER_SIZE)
+	{
+		uint32_t magic, numPoints;
+		std::memcpy(&magic, &bytes[position], sizeof(uint32_t));
+		std::memcpy(&numPoints, &bytes[position + sizeof(uint32_t)], sizeof(uint32_t));
+
+		// Corrupted or misaligned bytes are skipped until the next frame header
+		if (magic != FRAME_MAGIC || numPoints > MAX_FRAME_POINTS)
+		{
+			++position;
+			continue;
+		}
+
+		const size_t frameSize = FRAME_HEADER_SIZE + size_t(numPoints) * FRAME_POINT_SIZE;
+		if (bytes.size() - position < frameSize) break;
+
+		// Points are moved into the world space of the cloud, i.e., Y up and relative to its offset, before they are rounded to floats
+		Batch* batch = new Batch(numPoints);
+		const uint8_t* pointData = &bytes[position + FRAME_HEADER_SIZE];
+
+		for (unsigned pointIdx = 0; pointIdx < numPoints; ++pointIdx, pointData += FRAME_POINT_SIZE)
+		{
+			double coordinates[3];
+			float thermal;
+			std::memcpy(coordinates, pointData, sizeof(coordinates));
+			std::memcpy(&thermal, pointData + sizeof(coordinates), sizeof(float));
+
+			(*batch)[pointIdx] = vec4(coordinates[0] - _offset.x, coordinates[2] - _offset.y, coordinates[1] - _offset.z, thermal);
+		}
+
+		// A full queue holds the reader back, which in turn holds back the writer instead of dropping its points
+		while (!_queue.push(batch))
+		{
+			if (_stop)
+			{
+				delete batch;
+				return position;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_MILLISECONDS));
+		}
+
+		++_numBatches;
+		position += frameSize;
+	}
+
+	return position;
+}
+
+void LiveIngestion::publish()
+{
+	// Accumulated points mark their bricks dirty, so only the voxels whose window reaches a changed brick are evaluated again
+	_grid->locateAnomalies(_rendParams._anomalyDetector, _rendParams._gridNeighbors, _rendParams._stdFactor, &_progress);
+
+	delete _backBuffer.exchange(AsyncGridBuilder::createBuffer(_grid.get(), _rendParams, _progress));
+	++_numPublished;
+}
+
+void LiveIngestion::readerLoop()
+{
+	std::vector<uint8_t> bytes;
+	unsigned session = _channel.getSession();
+
+	while (!_stop)
+	{
+		const size_t numBytes = bytes.size();
+		bytes.resize(numBytes + READ_SIZE);
+		bytes.resize(numBytes + _channel.read(&bytes[numBytes], READ_SIZE, READ_TIMEOUT_MILLISECONDS));
+
+		// The partial frame of a writer which left would otherwise be completed with the bytes of the next one
+		if (_channel.getSession() != session)
+		{
+			session = _channel.getSession();
+			bytes.clear();
+			continue;
+		}
+
+		bytes.erase(bytes.begin(), bytes.begin() + this->decodeFrames(bytes));
+	}
+
+	_channel.close();
+}
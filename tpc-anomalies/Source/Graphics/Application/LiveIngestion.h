@@ -0,0 +1,124 @@
+#pragma once
+
+#include "DataStructures/RegularGrid.h"
+#include "Graphics/Application/AsyncGridBuilder.h"
+#include "Graphics/Application/RenderingParameters.h"
+#include "Utilities/InputChannel.h"
+#include "Utilities/LockFreeQueue.h"
+#include "Utilities/TaskProgress.h"
+
+/**
+*	@file LiveIngestion.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Bins points streamed by another process into an existing grid while the application runs, e.g., from a scanner still capturing the site.
+*	A reader thread splits the stream into framed batches and hands them over through a lock-free queue to an accumulator thread, which updates the
+*	voxel means and, at a fixed cadence, locates anomalies again and publishes the grid into a back buffer as AsyncGridBuilder does.
+*
+*	Each frame is a header of two little-endian 32-bit words, FRAME_MAGIC and the number of points, followed by the points, each of them three doubles
+*	with the georeferenced (x, y, z) position, Z being up as in the loaded files, and a float with the temperature in the same units as the cloud.
+*/
+class LiveIngestion
+{
+protected:
+	typedef std::vector<vec4> Batch;								//!< World-space positions of received points, with their temperature as w
+
+protected:
+	const static unsigned		FRAME_HEADER_SIZE;					//!< Bytes of the magic number and point count of a frame
+	const static uint32_t		FRAME_MAGIC;						//!< Marks the start of a frame, so that the reader can recover from corrupted bytes
+	const static unsigned		FRAME_POINT_SIZE;					//!< Bytes of a point within a frame
+	const static unsigned		IDLE_MILLISECONDS;					//!< Sleep of the accumulator while the queue is empty
+	const static unsigned		MAX_FRAME_POINTS;					//!< Larger point counts are taken as corrupted headers
+	const static unsigned		QUEUE_CAPACITY;						//!< Batches waiting for the accumulator before the reader stops reading
+	const static unsigned		READ_SIZE;							//!< Maximum bytes requested from the channel at once
+	const static unsigned		READ_TIMEOUT_MILLISECONDS;			//!< Maximum wait of a read, which bounds the time needed to stop the reader
+
+protected:
+	std::thread					_accumulator;						//!< Thread where batches are binned and anomalies are located
+	std::atomic<AsyncGridBuilder::GridBuffer*> _backBuffer;			//!< Latest published grid, not yet acquired
+	InputChannel				_channel;							//!< Stream of framed points
+	std::unique_ptr<RegularGrid> _grid;								//!< Grid updated by the accumulator
+	std::atomic<size_t>			_numBatches;						//!< Frames received so far
+	std::atomic<size_t>			_numDiscarded;						//!< Received points which fell outside the grid
+	std::atomic<size_t>			_numPoints;							//!< Received points binned into the grid
+	std::atomic<size_t>			_numPublished;						//!< Grids published so far
+	glm::dvec3					_offset;							//!< Translation from world space to georeferenced coordinates, as (x, z, y)
+	TaskProgress				_progress;							//!< Cancels the anomaly search in progress once stopped
+	LockFreeQueue<Batch*>		_queue;								//!< Batches decoded by the reader and not yet binned
+	std::thread					_reader;							//!< Thread where the channel is read
+	RenderingParameters			_rendParams;						//!< Snapshot of the detector and hotspot settings
+	std::atomic<bool>			_stop;								//!< Both threads must finish
+
+protected:
+	/**
+	*	@brief Bins the queued batches and publishes the grid whenever the refresh period elapsed since the last time.
+	*/
+	void accumulatorLoop();
+
+	/**
+	*	@brief Decodes every whole frame at the start of the given bytes into a queued batch. Bytes not starting a valid frame are skipped one by one.
+	*	@return Number of consumed bytes.
+	*/
+	size_t decodeFrames(const std::vector<uint8_t>& bytes);
+
+	/**
+	*	@brief Locates anomalies in the current grid and publishes its rendering buffers.
+	*/
+	void publish();
+
+	/**
+	*	@brief Reads the channel and decodes frames until stopped.
+	*/
+	void readerLoop();
+
+public:
+	/**
+	*	@brief Constructor. Nothing is read until the ingestion is started.
+	*	@param grid Grid receiving the points, owned by the ingestion from now on. Anomalies are located with the given settings.
+	*/
+	LiveIngestion(RegularGrid* grid, const RenderingParameters& rendParams);
+
+	/**
+	*	@brief Invalid copy constructor.
+	*/
+	LiveIngestion(const LiveIngestion& ingestion) = delete;
+
+	/**
+	*	@brief Destructor. Stops both threads; points still queued are dropped.
+	*/
+	virtual ~LiveIngestion();
+
+	/**
+	*	@return Latest published grid, or null if none was published since the last call. The caller takes ownership.
+	*/
+	AsyncGridBuilder::GridBuffer* acquire() { return _backBuffer.exchange(nullptr); }
+
+	/**
+	*	@return Frames received so far.
+	*/
+	size_t getNumberOfBatches() const { return _numBatches; }
+
+	/**
+	*	@return Received points which fell outside the grid.
+	*/
+	size_t getNumberOfDiscardedPoints() const { return _numDiscarded; }
+
+	/**
+	*	@return Received points binned into the grid.
+	*/
+	size_t getNumberOfPoints() const { return _numPoints; }
+
+	/**
+	*	@return Grids published so far.
+	*/
+	size_t getNumberOfPublishedGrids() const { return _numPublished; }
+
+	/**
+	*	@brief Opens the channel given by the rendering parameters and launches the reader and accumulator threads.
+	*	@return False if the channel could not be opened.
+	*/
+	bool start();
+};
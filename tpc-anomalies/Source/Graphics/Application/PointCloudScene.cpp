@@ -14,12 +14,16 @@ const std::string PointCloudScene::POINT_CLOUD_PATH = "Assets/PointCloud/Thermal
 
 // [Public methods]
 
-PointCloudScene::PointCloudScene() : _aabbRenderer(nullptr), _meshGrid(nullptr), _pointCloud(nullptr)
+PointCloudScene::PointCloudScene() : _aabbRenderer(nullptr), _cloudLoader(nullptr), _gridBuilder(nullptr), _gridEstimate{ uvec3(1), .0f, .0f, .0f, 0, 0, .0f }, _gridEstimateOriented(false), _gridEstimateTarget(-1.0f), _liveIngestion(nullptr), _meshGrid(nullptr), _pointCloud(nullptr)
 {
 }
 
 PointCloudScene::~PointCloudScene()
 {
+	// Grids read the points, hence they are stopped before a cancelled load empties the cloud
+	delete _liveIngestion;
+	delete _gridBuilder;
+	delete _cloudLoader;
 	delete _aabbRenderer;
 	delete _meshGrid;
 	delete _pointCloud;
@@ -27,29 +31,43 @@ PointCloudScene::~PointCloudScene()
 
 void PointCloudScene::exportGrid(bool fillUnderVoxels)
 {
-	_meshGrid->exportGrid(fillUnderVoxels);
+	TaskProgress progress;
+
+	if (!_meshGrid) return;
+
+	// Export needs the full voxel array, which only lives as long as the export
+	std::unique_ptr<RegularGrid> grid(_meshGrid->unpack());
+	grid->exportGrid(fillUnderVoxels, &progress);
 }
 
-void PointCloudScene::rebuildGrid(ivec3 subdivisions)
+const GridResolution::Estimate& PointCloudScene::estimateGridResolution(float targetPointsPerVoxel, bool oriented)
 {
-	std::vector<AABB> aabbs;
-	std::vector<float> clusterIdx;
+	if (_gridBuilder && (targetPointsPerVoxel != _gridEstimateTarget || oriented != _gridEstimateOriented))
+	{
+		// The oriented frame needs a pass over every point, hence it is only computed once by the builder
+		AABB aabb = _sceneGroup[0]->getAABB();
+		mat4 frame(1.0f);
+		if (oriented && !_gridBuilder->getOrientedFrame(frame, aabb)) return _gridEstimate;
+
+		_gridEstimate = GridResolution::estimate(*_pointCloud->getPoints(), aabb, targetPointsPerVoxel, _gridBuilder->getThroughput(), frame);
+		_gridEstimateOriented = oriented;
+		_gridEstimateTarget = targetPointsPerVoxel;
+	}
 
-	delete _meshGrid;
-	_meshGrid = new RegularGrid(_sceneGroup[0]->getAABB(), subdivisions);
-	_meshGrid->fill(_pointCloud->getPoints(), _pointCloud->getTemperature());
-	if (Renderer::getInstance()->getRenderingParameters()->_fillUnderVoxels) _meshGrid->fillUnderCloud();
-	_meshGrid->getAABBs(aabbs);
-	_meshGrid->locateAnomalies();
+	return _gridEstimate;
+}
 
-	_aabbRenderer->load(aabbs);
-	_aabbRenderer->homogenize();
-	_aabbRenderer->setFloatBuffer(_meshGrid->data(), _meshGrid->getNumSubdivisions().x * _meshGrid->getNumSubdivisions().y * _meshGrid->getNumSubdivisions().z, _meshGrid->thermalData(), RendEnum::VBO_THERMAL_COLOR);
-	_aabbRenderer->setFloatBuffer(_meshGrid->data(), _meshGrid->getNumSubdivisions().x * _meshGrid->getNumSubdivisions().y * _meshGrid->getNumSubdivisions().z, _meshGrid->localPeak(), RendEnum::VBO_LOCAL_PEAK_COLOR);
+void PointCloudScene::rebuildGrid(ivec3 subdivisions)
+{
+	// Parameters are copied, so that they can be edited while the grid is being built
+	if (_gridBuilder) _gridBuilder->request(*Renderer::getInstance()->getRenderingParameters(), subdivisions);
 }
 
 void PointCloudScene::render(const mat4& mModel, RenderingParameters* rendParams)
 {
+	this->updateCloud();
+	this->updateGrid();
+
 	SSAOScene::render(mModel, rendParams);
 }
 
@@ -138,24 +156,111 @@ void PointCloudScene::loadLights()
 void PointCloudScene::loadModels()
 {
 	{
+		RenderingParameters* rendParams = Renderer::getInstance()->getRenderingParameters();
+		const size_t previewBudget = size_t(std::max(rendParams->_previewBudget, 0));
+
+		// Large clouds are rendered through a decimated preview from the start, whereas grids and anomalies use every point
 		_pointCloud = new PointCloud(POINT_CLOUD_PATH, true);
-		_pointCloud->load();
+		_pointCloud->setPreview(previewBudget, PointDecimation::CellPoint(rendParams->_previewCellPoint), rendParams->_previewBlueNoise);
+		_pointCloud->setFilter(rendParams->_duplicateTolerance, unsigned(std::max(rendParams->_outlierNeighbors, 0)), rendParams->_outlierStdFactor);
 
-		Group3D* group = new Group3D();
-		group->addComponent(_pointCloud, _pointCloud->getAABB());
-		group->registerScene();
-		_sceneGroup.push_back(group);
+		// Points are drawn as they are read, strided down to the same budget until the preview is ready
+		_cloudLoader = new AsyncCloudLoader(_pointCloud, previewBudget);
 
 		// Build octree and retrieve AABBs
 		_aabbRenderer = new AABBSet();
 		_aabbRenderer->load();
 		_aabbRenderer->setMaterial(MaterialList::getInstance()->getMaterial(CGAppEnum::MATERIAL_CAD_BLUE));
-		
+	}
+}
+
+void PointCloudScene::updateCloud()
+{
+	if (!_cloudLoader) return;
+
+	// Points are ready before the loader finishes, hence a finished loader is never deleted before they are seen
+	const bool finished = _cloudLoader->isFinished();
+
+	// The first uploaded points frame the camera, which is framed again once the whole cloud is known
+	const size_t numUploaded = _cloudLoader->upload();
+	if (numUploaded && numUploaded == _cloudLoader->getNumberOfUploadedPoints()) this->correctCameraSystem(_cameraManager->getActiveCamera(), _cloudLoader->getLoadedAABB());
+
+	if (_cloudLoader->isPointsReady() && !_gridBuilder)
+	{
+		RenderingParameters* rendParams = Renderer::getInstance()->getRenderingParameters();
+
+		Group3D* group = new Group3D();
+		group->addComponent(_pointCloud, _pointCloud->getAABB());
+		group->registerScene();
+		_sceneGroup.push_back(group);
+
 		this->correctCameraSystem(_cameraManager->getActiveCamera(), _pointCloud->getAABB());
-		this->rebuildGrid(Renderer::getInstance()->getRenderingParameters()->_gridSubdivisions);
+
+		// Grids only read the points, so they are built while the loader decimates the preview and writes the binary copy
+		_gridBuilder = new AsyncGridBuilder(_pointCloud, _sceneGroup[0]->getAABB());
+
+		if (rendParams->_autoGridResolution) rendParams->_gridSubdivisions = this->estimateGridResolution(rendParams->_targetPointsPerVoxel, rendParams->_orientedGrid)._subdivisions;
+
+		this->rebuildGrid(rendParams->_gridSubdivisions);
+	}
+
+	if (finished)
+	{
+		// Points drawn while loading are dropped as well if the load failed
+		_pointCloud->uploadRenderedPoints();
+
+		delete _cloudLoader;
+		_cloudLoader = nullptr;
 	}
 }
 
+bool PointCloudScene::startIngestion(const RenderingParameters& rendParams)
+{
+	if (!_meshGrid || _liveIngestion) return false;
+
+	// Received points are binned into the full voxel arrays, which only live as long as the ingestion
+	_liveIngestion = new LiveIngestion(_meshGrid->unpack(), rendParams);
+	if (_liveIngestion->start()) return true;
+
+	this->stopIngestion();
+
+	return false;
+}
+
+void PointCloudScene::stopIngestion()
+{
+	delete _liveIngestion;
+	_liveIngestion = nullptr;
+}
+
+void PointCloudScene::updatePreview(const RenderingParameters& rendParams)
+{
+	if (_pointCloud && !_cloudLoader) _pointCloud->setPreview(size_t(std::max(rendParams._previewBudget, 0)), PointDecimation::CellPoint(rendParams._previewCellPoint), rendParams._previewBlueNoise);
+}
+
+void PointCloudScene::updateGrid()
+{
+	AsyncGridBuilder::GridBuffer* gridBuffer = _gridBuilder ? _gridBuilder->acquire() : nullptr;
+
+	if (gridBuffer) this->stopIngestion();
+	else if (_liveIngestion) gridBuffer = _liveIngestion->acquire();
+	if (!gridBuffer) return;
+
+	delete _meshGrid;
+	_meshGrid = gridBuffer->_grid;
+	gridBuffer->_grid = nullptr;
+	_hotspots = std::move(gridBuffer->_hotspots);
+
+	// Boxes are given in grid space, which differs from world space for oriented grids
+	_aabbRenderer->load(gridBuffer->_aabbs);
+	_aabbRenderer->setModelMatrix(_meshGrid->getFrame());
+	_aabbRenderer->homogenize();
+	_aabbRenderer->setFloatBuffer(gridBuffer->_thermal, RendEnum::VBO_THERMAL_COLOR);
+	_aabbRenderer->setFloatBuffer(gridBuffer->_localPeak, RendEnum::VBO_LOCAL_PEAK_COLOR);
+
+	delete gridBuffer;
+}
+
 // [Rendering]
 
 void PointCloudScene::drawSceneAsPoints(RenderingShader* shader, RendEnum::RendShaderTypes shaderType, std::vector<mat4>* matrix, RenderingParameters* rendParams)
@@ -1,6 +1,11 @@
 #pragma once
 
-#include "DataStructures/RegularGrid.h"
+#include "DataStructures/GridResolution.h"
+#include "DataStructures/HotspotLabeling.h"
+#include "DataStructures/PackedGrid.h"
+#include "Graphics/Application/AsyncCloudLoader.h"
+#include "Graphics/Application/AsyncGridBuilder.h"
+#include "Graphics/Application/LiveIngestion.h"
 #include "Graphics/Application/SSAOScene.h"
 #include "Graphics/Core/AABBSet.h"
 #include "Graphics/Core/PointCloud.h"
@@ -17,11 +22,18 @@ class PointCloudScene: public SSAOScene
 {
 protected:
 	// Meshes to be tested
-	const static std::string POINT_CLOUD_PATH;					//!< Location of the first mesh in the file system
+	const static std::string POINT_CLOUD_PATH;					//!< Cloud location without extension: a single file, a folder or a wildcard pattern of per-station files
 
 protected:
 	AABBSet*			_aabbRenderer;							//!< Buffer of voxels
-	RegularGrid*		_meshGrid;								//!< Mesh regular grid
+	AsyncCloudLoader*	_cloudLoader;							//!< Loads the cloud away from the rendering thread, null once it finished
+	AsyncGridBuilder*	_gridBuilder;							//!< Builds grids away from the rendering thread
+	GridResolution::Estimate _gridEstimate;						//!< Last automatic resolution
+	bool				_gridEstimateOriented;					//!< The last automatic resolution was computed for an oriented grid
+	float				_gridEstimateTarget;					//!< Points per voxel of the last automatic resolution, negative if none
+	std::vector<HotspotLabeling::Hotspot> _hotspots;			//!< Connected anomalies of the current grid
+	LiveIngestion*		_liveIngestion;							//!< Bins streamed points into the current grid, null unless started
+	PackedGrid*			_meshGrid;								//!< Packed grid of the point cloud
 	PointCloud*			_pointCloud;
 
 protected:
@@ -60,6 +72,18 @@ protected:
 	*/
 	virtual void loadModels();
 
+	/**
+	*	@brief Uploads the points read since the last frame. Once the points are final, the scene is framed and the first grid is requested, and once the
+	*	load finishes, the preview replaces the points rendered while loading. Must be called from the OpenGL thread.
+	*/
+	void updateCloud();
+
+	/**
+	*	@brief Swaps in the latest grid finished by the builder or published by the live ingestion, if any, and uploads its buffers. A rebuilt grid
+	*	stops the ingestion, as it does not hold the received points. Must be called from the OpenGL thread.
+	*/
+	void updateGrid();
+
 	// ------------- Rendering ----------------
 
 	/**
@@ -118,13 +142,66 @@ public:
 	*/
 	virtual ~PointCloudScene();
 
+	/**
+	*	@brief Cancels the grid build in progress, if any. The current grid is kept.
+	*/
+	void cancelGridBuild() { if (_gridBuilder) _gridBuilder->cancel(); }
+
 	/**
 	*	@brief
 	*/
 	void exportGrid(bool fillUnderVoxels = false);
 
 	/**
-	*	@brief Rebuilds the whole grid to adapt it to a different number of subdivisions. 
+	*	@return Resolution which gives the requested points per occupied voxel, with its predicted memory and time. Estimates are reused while the target does not change.
+	*	@param oriented The grid follows the principal horizontal directions of the cloud.
+	*/
+	const GridResolution::Estimate& estimateGridResolution(float targetPointsPerVoxel, bool oriented);
+
+	/**
+	*	@return True if the points are ready to estimate a grid resolution, i.e. the cloud is no longer being read and, for oriented grids,
+	*	the builder already computed their frame.
+	*/
+	bool canEstimateGridResolution(bool oriented) { mat4 frame; AABB aabb; return _gridBuilder && (!oriented || _gridBuilder->getOrientedFrame(frame, aabb)); }
+
+	/**
+	*	@return Progress of the grid build in progress, or null if none is running.
+	*/
+	std::shared_ptr<TaskProgress> getGridProgress() { return _gridBuilder ? _gridBuilder->getProgress() : nullptr; }
+
+	/**
+	*	@return Progress of the cloud load in progress, or null if none is running.
+	*/
+	std::shared_ptr<TaskProgress> getCloudProgress() { return _cloudLoader ? _cloudLoader->getProgress() : nullptr; }
+
+	/**
+	*	@return Connected anomalies found in the last grid rebuild, sorted by size.
+	*/
+	const std::vector<HotspotLabeling::Hotspot>& getHotspots() const { return _hotspots; }
+
+	/**
+	*	@return Ingestion of streamed points, or null if it is not running.
+	*/
+	const LiveIngestion* getLiveIngestion() const { return _liveIngestion; }
+
+	/**
+	*	@return Loaded point cloud.
+	*/
+	PointCloud* getPointCloud() { return _pointCloud; }
+
+	/**
+	*	@return True while the cloud is being loaded, during which the preview cannot be changed.
+	*/
+	bool isCloudLoading() { return _cloudLoader != nullptr; }
+
+	/**
+	*	@return True while a requested grid is still being built.
+	*/
+	bool isGridBuilding() { return _gridBuilder && _gridBuilder->isBuilding(); }
+
+	/**
+	*	@brief Requests the whole grid to be rebuilt with a different number of subdivisions. The current grid is rendered until the new one is finished.
+	*	Requests are ignored until the points of the cloud are loaded.
 	*/
 	void rebuildGrid(ivec3 subdivisions);
 
@@ -134,5 +211,21 @@ public:
 	*	@param rendParams Rendering parameters to be taken into account.
 	*/
 	virtual void render(const mat4& mModel, RenderingParameters* rendParams);
+
+	/**
+	*	@brief Starts binning points streamed by another process into a copy of the current grid, which replaces it at the refresh cadence.
+	*	@return False if there is no grid yet, the ingestion is already running or its channel could not be opened.
+	*/
+	bool startIngestion(const RenderingParameters& rendParams);
+
+	/**
+	*	@brief Stops the live ingestion, if running. The last published grid is kept.
+	*/
+	void stopIngestion();
+
+	/**
+	*	@brief Decimates the rendered cloud again with the preview settings. Must be called from the OpenGL thread.
+	*/
+	void updatePreview(const RenderingParameters& rendParams);
 };
 
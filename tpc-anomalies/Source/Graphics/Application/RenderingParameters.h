@@ -19,6 +19,11 @@ public:
 		HEIGHT = 1
 	};
 
+	enum AnomalyDetector : int {
+		MEAN_DEVIATION = 0,
+		MEDIAN_MAD = 1
+	};
+
 public:
 	// Application
 	vec3							_backgroundColor;						//!< Clear color
@@ -36,7 +41,18 @@ public:
 	int								_visualizationMode;						//!< Only triangle mesh is defined here
 	
 	// Point cloud	
+	int								_anomalyDetector;						//!< Statistics used to locate thermal anomalies
+	float							_duplicateTolerance;					//!< Maximum distance between duplicates removed on load, negative to keep them
 	int								_gridNeighbors;							//!< 
+	bool							_locatePointAnomalies;					//!< Evaluates every point against its own neighbourhood besides the grid
+	int								_outlierNeighbors;						//!< Neighbours whose mean distance flags outliers removed on load, zero to keep them
+	float							_outlierStdFactor;						//!< Deviations above the mean neighbour distance beyond which points are outliers
+	int								_pointNeighbors;						//!< Minimum neighbourhood size of point-level anomalies
+	float							_pointRadius;							//!< Neighbourhood radius of point-level anomalies (zero for k-NN only)
+	float							_pointStdFactor;						//!< Multiplier to detect anomalies regarding a point surroundings
+	bool							_previewBlueNoise;						//!< Preview voxels are thinned into a Poisson-disk set
+	int								_previewBudget;							//!< Maximum number of rendered points, zero to render the whole cloud
+	int								_previewCellPoint;						//!< Point kept by each preview voxel (PointDecimation::CellPoint)
 	bool							_renderAnomalies;						//!<
 	bool							_renderThermals;						//!< 
 	float							_scenePointSize;						//!< Size of points in a cloud
@@ -61,10 +77,22 @@ public:
 	bool							_showTriangleMesh;						//!< Render original scene
 
 	// Grid
+	bool							_autoGridResolution;					//!< Subdivisions are chosen from the point density
 	bool							_fillUnderVoxels;						//!< Fills grid under occupied voxels
 	ivec3							_gridSubdivisions;						//!< Subdivisions of regular grid
-	bool							_launchGridGPU;							//!< Launchs grid subdivision in GPU
+	int								_hotspotConnectivity;					//!< Voxel connectivity (6, 18 or 26) used to group anomalies
+	int								_hotspotMinVoxels;						//!< Minimum size of reported hotspots
+	bool							_orientedGrid;							//!< Grid axes follow the principal horizontal directions of the cloud
 	float							_stdFactor;								//!< Multiplier to detect anomalies regarding a grid surroundings
+	float							_targetPointsPerVoxel;					//!< Average points per occupied voxel sought by the automatic resolution
+	bool							_quantizeGridThermal;					//!< Resident grids store temperatures as 16-bit levels
+	bool							_useGridCache;							//!< Grids and anomalies are reused from the on-disk cache
+
+	// Live ingestion
+	char							_livePipeBuffer[64];					//!< Named pipe read by the live ingestion
+	int								_livePort;								//!< Loopback port where the live ingestion accepts connections
+	int								_liveRefreshMilliseconds;				//!< Time between anomaly refreshes while points are being received
+	int								_liveSource;							//!< Stream read by the live ingestion (InputChannel::Source)
 
 public:
 	/**
@@ -82,6 +110,12 @@ public:
 
 		_visualizationMode(CGAppEnum::VIS_TRIANGLES),
 
+		_duplicateTolerance(-1.0f),
+		_outlierNeighbors(0),
+		_outlierStdFactor(3.0f),
+		_previewBlueNoise(false),
+		_previewBudget(20000000),
+		_previewCellPoint(0),
 		_scenePointSize(2.0f),
 		_scenePointCloudColor(1.0f, .0f, .0f),
 
@@ -99,13 +133,29 @@ public:
 		_showBVH(false),
 		_showTriangleMesh(true),
 
+		_autoGridResolution(false),
 		_fillUnderVoxels(false),
+		_anomalyDetector(AnomalyDetector::MEAN_DEVIATION),
 		_gridNeighbors(5),
+		_locatePointAnomalies(false),
+		_pointNeighbors(16),
+		_pointRadius(.0f),
+		_pointStdFactor(3.0f),
 		_gridSubdivisions(180),
-		_launchGridGPU(true),
+		_hotspotConnectivity(26),
+		_hotspotMinVoxels(1),
+		_orientedGrid(false),
 		_renderAnomalies(false),
 		_renderThermals(true),
-		_stdFactor(6.0f)
+		_stdFactor(6.0f),
+		_targetPointsPerVoxel(16.0f),
+		_quantizeGridThermal(true),
+		_useGridCache(true),
+
+		_livePipeBuffer("tpc-points"),
+		_livePort(7620),
+		_liveRefreshMilliseconds(1000),
+		_liveSource(2)
 	{
 	}
 };
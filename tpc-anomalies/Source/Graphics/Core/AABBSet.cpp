@@ -93,6 +93,11 @@ void AABBSet::setFloatBuffer(uint16_t* colorBuffer, unsigned size, std::vector<f
 	_modelComp[0]->_vao->setVBOData(vboType, thermalColor);
 }
 
+void AABBSet::setFloatBuffer(const std::vector<float>& compactBuffer, RendEnum::VBOTypes vboType)
+{
+	_modelComp[0]->_vao->setVBOData(vboType, compactBuffer);
+}
+
 // [Protected methods]
 
 void AABBSet::renderTriangles(RenderingShader* shader, const RendEnum::RendShaderTypes shaderType, std::vector<mat4>& matrix, ModelComponent* modelComp, const GLuint primitive)
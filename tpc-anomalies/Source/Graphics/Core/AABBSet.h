@@ -69,5 +69,10 @@ public:
 	*	@brief Defines the content of voxel's float values.
 	*/
 	void setFloatBuffer(uint16_t* colorBuffer, unsigned size, std::vector<float>* thermalBuffer, RendEnum::VBOTypes vboType);
+
+	/**
+	*	@brief Defines the content of voxel's float values from a buffer which is already compacted to non-empty voxels.
+	*/
+	void setFloatBuffer(const std::vector<float>& compactBuffer, RendEnum::VBOTypes vboType);
 };
 
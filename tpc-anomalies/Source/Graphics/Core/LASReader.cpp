@@ -0,0 +1,245 @@
+#include "stdafx.h"
+#include "LASReader.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define LAS_READER_SSE2
+#include <emmintrin.h>
+#endif
+
+// Initialization of static attributes
+const unsigned LASReader::EVLR_HEADER_SIZE = 60;
+const unsigned LASReader::EXTRA_BYTES_DESCRIPTOR_SIZE = 192;
+const uint16_t LASReader::EXTRA_BYTES_RECORD_ID = 4;
+const unsigned LASReader::HEADER_MIN_SIZE = 227;
+const unsigned LASReader::NUM_POINT_FORMATS = 11;
+const int LASReader::POINT_FORMAT_COLOR_OFFSET[] = { -1, -1, 20, 28, -1, 28, -1, 30, 30, -1, 30 };
+const unsigned LASReader::POINT_FORMAT_SIZE[] = { 20, 28, 26, 34, 57, 63, 30, 36, 38, 59, 67 };
+const unsigned LASReader::VLR_HEADER_SIZE = 54;
+
+/// [Public methods]
+
+LASReader::LASReader() :
+	_colorOffset(-1), _numPoints(0), _offset(.0), _pointDataOffset(0), _pointFormat(0), _recordLength(0), _scale(1.0)
+{
+}
+
+LASReader::~LASReader()
+{
+}
+
+bool LASReader::open(const std::string& filename)
+{
+	_filename = filename;
+	_numPoints = 0;
+	_temperature.reset();
+
+	if (!_file.open(filename)) return false;
+
+	const uint8_t* data = _file.data();
+	const size_t fileSize = _file.size();
+
+	if (fileSize < HEADER_MIN_SIZE || std::memcmp(data, "LASF", 4))
+	{
+		std::cerr << filename << " is not a LAS file" << std::endl;
+		return false;
+	}
+
+	// LAZ sets the highest bits of the point format
+	const uint8_t versionMinor = data[25], pointFormat = data[104];
+	const uint16_t headerSize = LASReader::readValue<uint16_t>(data + 94);
+
+	if (pointFormat & 0xC0)
+	{
+		std::cerr << filename << " is compressed, which is not supported" << std::endl;
+		return false;
+	}
+
+	_pointFormat = pointFormat;
+	if (_pointFormat >= NUM_POINT_FORMATS)
+	{
+		std::cerr << filename << " uses an unknown point format (" << unsigned(_pointFormat) << ")" << std::endl;
+		return false;
+	}
+
+	_pointDataOffset = LASReader::readValue<uint32_t>(data + 96);
+	_recordLength = LASReader::readValue<uint16_t>(data + 105);
+	_colorOffset = POINT_FORMAT_COLOR_OFFSET[_pointFormat];
+	_numPoints = LASReader::readValue<uint32_t>(data + 107);
+	_scale = glm::dvec3(LASReader::readValue<double>(data + 131), LASReader::readValue<double>(data + 139), LASReader::readValue<double>(data + 147));
+	_offset = glm::dvec3(LASReader::readValue<double>(data + 155), LASReader::readValue<double>(data + 163), LASReader::readValue<double>(data + 171));
+	_minPoint = glm::dvec3(LASReader::readValue<double>(data + 187), LASReader::readValue<double>(data + 219), LASReader::readValue<double>(data + 203));
+
+	// LAS 1.4 keeps a 64-bit count, whereas the legacy one is zero for formats above 5
+	if (versionMinor >= 4 && headerSize >= 255 && fileSize >= 255) _numPoints = size_t(LASReader::readValue<uint64_t>(data + 247));
+
+	if (_recordLength < POINT_FORMAT_SIZE[_pointFormat])
+	{
+		std::cerr << filename << " has records shorter than its point format" << std::endl;
+		_numPoints = 0;
+		return false;
+	}
+
+	// Variable length records lie between the header and the points
+	const uint32_t numVLRs = LASReader::readValue<uint32_t>(data + 100);
+	size_t recordOffset = headerSize;
+
+	for (uint32_t recordIdx = 0; recordIdx < numVLRs && recordOffset + VLR_HEADER_SIZE <= fileSize; ++recordIdx)
+	{
+		const uint16_t recordID = LASReader::readValue<uint16_t>(data + recordOffset + 18), length = LASReader::readValue<uint16_t>(data + recordOffset + 20);
+
+		if (!std::strncmp(reinterpret_cast<const char*>(data + recordOffset + 2), "LASF_Spec", 16) && recordID == EXTRA_BYTES_RECORD_ID && recordOffset + VLR_HEADER_SIZE + length <= fileSize)
+			this->parseExtraBytes(data + recordOffset + VLR_HEADER_SIZE, length);
+
+		recordOffset += VLR_HEADER_SIZE + length;
+	}
+
+	// Extended records follow the points in LAS 1.4
+	if (versionMinor >= 4 && headerSize >= 247)
+	{
+		const uint32_t numEVLRs = LASReader::readValue<uint32_t>(data + 243);
+		recordOffset = size_t(LASReader::readValue<uint64_t>(data + 235));
+
+		for (uint32_t recordIdx = 0; recordIdx < numEVLRs && recordOffset && recordOffset + EVLR_HEADER_SIZE <= fileSize; ++recordIdx)
+		{
+			const uint16_t recordID = LASReader::readValue<uint16_t>(data + recordOffset + 18);
+			const uint64_t length = LASReader::readValue<uint64_t>(data + recordOffset + 20);
+
+			if (length > fileSize - recordOffset - EVLR_HEADER_SIZE) break;
+			if (!std::strncmp(reinterpret_cast<const char*>(data + recordOffset + 2), "LASF_Spec", 16) && recordID == EXTRA_BYTES_RECORD_ID)
+				this->parseExtraBytes(data + recordOffset + EVLR_HEADER_SIZE, size_t(length));
+
+			recordOffset += EVLR_HEADER_SIZE + size_t(length);
+		}
+	}
+
+	// Truncated files are read up to their last complete record
+	const size_t availablePoints = fileSize > _pointDataOffset ? size_t((fileSize - _pointDataOffset) / _recordLength) : 0;
+	if (availablePoints < _numPoints)
+	{
+		std::cerr << filename << " is truncated, only " << availablePoints << " of " << _numPoints << " points are read" << std::endl;
+		_numPoints = availablePoints;
+	}
+
+	return _numPoints > 0;
+}
+
+AABB LASReader::read(size_t firstPoint, size_t numPoints, ThermalSource thermalSource, const glm::dvec3& origin, vec4* points, vec3* rgb, float* thermal) const
+{
+	const uint8_t* record = _file.data() + _pointDataOffset + firstPoint * _recordLength;
+	const size_t lastPoint = std::min(_numPoints, firstPoint + numPoints);
+
+	// The origin is folded into the offset, so that large coordinates are cancelled before the conversion to float
+	const glm::dvec3 offset = _offset - glm::dvec3(origin.x, origin.z, origin.y);
+	vec3 minPoint(std::numeric_limits<float>::max()), maxPoint(-std::numeric_limits<float>::max());
+
+#ifdef LAS_READER_SSE2
+	// The fourth lane scales the intensity by zero and adds one, hence it becomes the homogeneous coordinate
+	const __m128d scaleXY = _mm_set_pd(_scale.y, _scale.x), offsetXY = _mm_set_pd(offset.y, offset.x);
+	const __m128d scaleZ = _mm_set_pd(.0, _scale.z), offsetZ = _mm_set_pd(1.0, offset.z);
+	__m128 minVector = _mm_set1_ps(std::numeric_limits<float>::max()), maxVector = _mm_set1_ps(-std::numeric_limits<float>::max());
+#endif
+
+	for (size_t pointIdx = firstPoint; pointIdx < lastPoint; ++pointIdx, record += _recordLength)
+	{
+		const size_t outputIdx = pointIdx - firstPoint;
+
+#ifdef LAS_READER_SSE2
+		// Every record format is at least 20 bytes long, so the 16-byte load stays within the record
+		const __m128i xyzi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(record));
+		const __m128d xy = _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(xyzi), scaleXY), offsetXY);
+		const __m128d zw = _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(xyzi, xyzi)), scaleZ), offsetZ);
+		const __m128 xyzw = _mm_movelh_ps(_mm_cvtpd_ps(xy), _mm_cvtpd_ps(zw));
+		const __m128 xzyw = _mm_shuffle_ps(xyzw, xyzw, _MM_SHUFFLE(3, 1, 2, 0));
+
+		_mm_storeu_ps(&points[outputIdx].x, xzyw);
+		minVector = _mm_min_ps(minVector, xzyw);
+		maxVector = _mm_max_ps(maxVector, xzyw);
+#else
+		const glm::dvec3 position = glm::dvec3(LASReader::readValue<int32_t>(record), LASReader::readValue<int32_t>(record + 4), LASReader::readValue<int32_t>(record + 8)) * _scale + offset;
+
+		points[outputIdx] = vec4(float(position.x), float(position.z), float(position.y), 1.0f);
+		minPoint = glm::min(minPoint, vec3(points[outputIdx]));
+		maxPoint = glm::max(maxPoint, vec3(points[outputIdx]));
+#endif
+
+		if (_colorOffset >= 0)
+		{
+			const uint8_t* color = record + _colorOffset;
+			rgb[outputIdx] = vec3(LASReader::readValue<uint16_t>(color), LASReader::readValue<uint16_t>(color + 2), LASReader::readValue<uint16_t>(color + 4));
+		}
+
+		if (thermalSource == EXTRA_BYTES && _temperature)
+		{
+			const uint8_t* value = record + _temperature->_offset;
+			double temperature = .0;
+
+			switch (_temperature->_type)
+			{
+			case 1: temperature = LASReader::readValue<uint8_t>(value); break;
+			case 2: temperature = LASReader::readValue<int8_t>(value); break;
+			case 3: temperature = LASReader::readValue<uint16_t>(value); break;
+			case 4: temperature = LASReader::readValue<int16_t>(value); break;
+			case 5: temperature = LASReader::readValue<uint32_t>(value); break;
+			case 6: temperature = LASReader::readValue<int32_t>(value); break;
+			case 7: temperature = double(LASReader::readValue<uint64_t>(value)); break;
+			case 8: temperature = double(LASReader::readValue<int64_t>(value)); break;
+			case 9: temperature = LASReader::readValue<float>(value); break;
+			case 10: temperature = LASReader::readValue<double>(value); break;
+			}
+
+			thermal[outputIdx] = float(temperature * _temperature->_scale + _temperature->_valueOffset);
+		}
+		else if (thermalSource == RED_CHANNEL && _colorOffset >= 0)
+		{
+			thermal[outputIdx] = LASReader::readValue<uint16_t>(record + _colorOffset);
+		}
+		else
+		{
+			thermal[outputIdx] = LASReader::readValue<uint16_t>(record + 12);
+		}
+	}
+
+#ifdef LAS_READER_SSE2
+	vec4 minLanes, maxLanes;
+	_mm_storeu_ps(&minLanes.x, minVector);
+	_mm_storeu_ps(&maxLanes.x, maxVector);
+
+	minPoint = vec3(minLanes);
+	maxPoint = vec3(maxLanes);
+#endif
+
+	return lastPoint > firstPoint ? AABB(minPoint, maxPoint) : AABB();
+}
+
+/// [Protected methods]
+
+void LASReader::parseExtraBytes(const uint8_t* descriptors, size_t length)
+{
+	// Attributes are laid out after the fields of the point format, in the order of their descriptors
+	const unsigned typeSize[] = { 0, 1, 1, 2, 2, 4, 4, 8, 8, 4, 8 };
+	unsigned attributeOffset = POINT_FORMAT_SIZE[_pointFormat];
+
+	for (size_t descriptorOffset = 0; descriptorOffset + EXTRA_BYTES_DESCRIPTOR_SIZE <= length; descriptorOffset += EXTRA_BYTES_DESCRIPTOR_SIZE)
+	{
+		const uint8_t* descriptor = descriptors + descriptorOffset;
+		const uint8_t type = descriptor[2], options = descriptor[3];
+
+		// Undocumented attributes keep their size in the options, whereas deprecated array types are skipped as a whole
+		unsigned size = type == 0 ? options : 0;
+		if (type > 0 && type <= 10) size = typeSize[type];
+		else if (type > 10 && type <= 30) size = typeSize[(type - 1) % 10 + 1] * ((type - 1) / 10 + 1);
+
+		std::string name(reinterpret_cast<const char*>(descriptor + 4), 32);
+		name = name.substr(0, name.find('\0'));
+		std::transform(name.begin(), name.end(), name.begin(), [](char character) { return char(std::tolower(static_cast<unsigned char>(character))); });
+
+		if (!_temperature && type > 0 && type <= 10 && (name.find("temp") != std::string::npos || name.find("thermal") != std::string::npos) && attributeOffset + size <= _recordLength)
+		{
+			_temperature.reset(new ExtraAttribute{ attributeOffset, type, 1.0, .0 });
+			if (options & 0x08) _temperature->_scale = LASReader::readValue<double>(descriptor + 112);
+			if (options & 0x10) _temperature->_valueOffset = LASReader::readValue<double>(descriptor + 136);
+		}
+
+		attributeOffset += size;
+	}
+}
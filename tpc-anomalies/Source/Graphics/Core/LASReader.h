@@ -0,0 +1,130 @@
+#pragma once
+
+#include "Geometry/3D/AABB.h"
+#include "Utilities/MappedFile.h"
+
+/**
+*	@file LASReader.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Reader of uncompressed LAS files (versions 1.0 to 1.4, point formats 0 to 10). The file is mapped into memory and point records
+*	are decoded in place, so that disjoint ranges of points can be decoded by several threads at once. Temperatures are taken from an extra-bytes
+*	attribute named after temperature, or else from the red channel, or else from the intensity.
+*/
+class LASReader
+{
+public:
+	enum ThermalSource : uint8_t
+	{
+		EXTRA_BYTES, RED_CHANNEL, INTENSITY
+	};
+
+protected:
+	/**
+	*	@brief Location and decoding of the extra-bytes attribute holding temperatures.
+	*/
+	struct ExtraAttribute
+	{
+		unsigned	_offset;										//!< Offset of the attribute from the start of a point record
+		uint8_t		_type;											//!< Data type as defined by the LAS specification, from 1 (uchar) to 10 (double)
+		double		_scale;											//!< Scale applied to the stored value
+		double		_valueOffset;									//!< Offset applied after the scale
+	};
+
+protected:
+	const static unsigned		EVLR_HEADER_SIZE;					//!< Bytes of an extended variable length record header
+	const static unsigned		EXTRA_BYTES_DESCRIPTOR_SIZE;		//!< Bytes of the description of a single extra-bytes attribute
+	const static uint16_t		EXTRA_BYTES_RECORD_ID;				//!< Record identifier of the extra-bytes description
+	const static unsigned		HEADER_MIN_SIZE;					//!< Bytes of the shortest public header, i.e., LAS 1.0
+	const static unsigned		NUM_POINT_FORMATS;					//!< Number of known point formats
+	const static int			POINT_FORMAT_COLOR_OFFSET[];		//!< Offset of the RGB channels in each point format, negative if there is none
+	const static unsigned		POINT_FORMAT_SIZE[];				//!< Bytes of the fields defined by each point format, before any extra bytes
+	const static unsigned		VLR_HEADER_SIZE;					//!< Bytes of a variable length record header
+
+protected:
+	int							_colorOffset;						//!< Offset of the RGB channels in a point record, negative if there is none
+	MappedFile					_file;								//!< Mapped content of the file
+	std::string					_filename;							//!< Path of the open file
+	glm::dvec3					_minPoint;							//!< Lower corner of the bounding box given by the header, as (x, z, y)
+	size_t						_numPoints;							//!< Number of point records
+	glm::dvec3					_offset;							//!< Offset of stored coordinates, after the scale
+	uint64_t					_pointDataOffset;					//!< Offset of the first point record from the start of the file
+	uint8_t						_pointFormat;						//!< Point data record format
+	uint16_t					_recordLength;						//!< Bytes of each point record
+	glm::dvec3					_scale;								//!< Scale of stored coordinates
+	std::unique_ptr<ExtraAttribute>	_temperature;					//!< Extra-bytes attribute with temperatures, if any
+
+protected:
+	/**
+	*	@brief Searches the extra-bytes description of a record payload for a temperature attribute.
+	*/
+	void parseExtraBytes(const uint8_t* descriptors, size_t length);
+
+	/**
+	*	@return Value of the given type stored at a possibly unaligned address.
+	*/
+	template<typename T>
+	static T readValue(const uint8_t* data) { T value; std::memcpy(&value, data, sizeof(T)); return value; }
+
+public:
+	/**
+	*	@brief Constructor.
+	*/
+	LASReader();
+
+	/**
+	*	@brief Invalid copy constructor.
+	*/
+	LASReader(const LASReader& reader) = delete;
+
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~LASReader();
+
+	/**
+	*	@brief Maps a file and parses its header and variable length records. Compressed (LAZ) files are rejected.
+	*	@return True if the file holds decodable points.
+	*/
+	bool open(const std::string& filename);
+
+	/**
+	*	@brief Decodes a range of point records. Positions are stored as (x, z, y, 1) to keep the Y-up convention of the PLY loader,
+	*	whereas colours and temperatures keep their stored range, e.g., 16-bit colours, so that they can be normalized over several files.
+	*	@param origin Georeferenced position, as (x, z, y), subtracted in double precision before positions are stored as floats.
+	*	@param rgb Destination of colours, left untouched if the point format has none.
+	*	@return Bounding box of the decoded positions.
+	*/
+	AABB read(size_t firstPoint, size_t numPoints, ThermalSource thermalSource, const glm::dvec3& origin, vec4* points, vec3* rgb, float* thermal) const;
+
+	// Getters
+
+	/**
+	*	@return Path of the open file.
+	*/
+	std::string getFilename() const { return _filename; }
+
+	/**
+	*	@return Lower corner of the bounding box given by the header, as (x, z, y).
+	*/
+	glm::dvec3 getMinPoint() const { return _minPoint; }
+
+	/**
+	*	@return Number of point records.
+	*/
+	size_t getNumberOfPoints() const { return _numPoints; }
+
+	/**
+	*	@return Most specific source of temperatures available in the file.
+	*/
+	ThermalSource getThermalSource() const { return _temperature ? EXTRA_BYTES : (this->hasColor() ? RED_CHANNEL : INTENSITY); }
+
+	/**
+	*	@return True if point records hold RGB channels.
+	*/
+	bool hasColor() const { return _colorOffset >= 0; }
+};
+
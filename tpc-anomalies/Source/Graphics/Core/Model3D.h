@@ -16,6 +16,7 @@ class TriangleMesh;
 class VAO;
 
 #define BINARY_EXTENSION ".bin"
+#define LAS_EXTENSION ".las"
 #define OBJ_EXTENSION ".obj"
 #define PLY_EXTENSION ".ply"
 
@@ -0,0 +1,426 @@
+#include "stdafx.h"
+#include "OBJReader.h"
+
+#include "Utilities/ThreadPool.h"
+
+// Initialization of static attributes
+const unsigned OBJReader::INVALID_INDEX = std::numeric_limits<unsigned>::max();
+const unsigned OBJReader::PARSE_BLOCK_SIZE = 1 << 20;
+const unsigned OBJReader::VERTEX_BLOCK_SIZE = 1 << 14;
+
+/// [Public methods]
+
+OBJReader::OBJReader()
+{
+}
+
+OBJReader::~OBJReader()
+{
+}
+
+bool OBJReader::read(const std::string& filename, std::vector<vec4>& positions, std::vector<vec3>& normals, std::vector<vec2>& textCoords, std::vector<uvec3>& faces)
+{
+	positions.clear();
+	normals.clear();
+	textCoords.clear();
+	faces.clear();
+
+	if (!_file.open(filename)) return false;
+
+	ThreadPool* threadPool = ThreadPool::getInstance();
+	const size_t numBlocks = (_file.size() + PARSE_BLOCK_SIZE - 1) / PARSE_BLOCK_SIZE;
+	std::vector<Block> blocks(numBlocks);
+
+	// Each block covers the lines starting within its range of bytes, so that no line is split
+	threadPool->parallelFor(numBlocks, [&](size_t blockIdx)
+	{
+		blocks[blockIdx]._begin = this->getLineStart(blockIdx * PARSE_BLOCK_SIZE);
+		blocks[blockIdx]._end = this->getLineStart((blockIdx + 1) * PARSE_BLOCK_SIZE);
+		this->countElements(blocks[blockIdx]);
+	});
+
+	size_t numPositions = 0, numTextCoords = 0, numNormals = 0;
+	for (Block& block : blocks)
+	{
+		block._firstPosition = numPositions;
+		block._firstTextCoord = numTextCoords;
+		block._firstNormal = numNormals;
+		numPositions += block._numPositions;
+		numTextCoords += block._numTextCoords;
+		numNormals += block._numNormals;
+	}
+
+	std::vector<vec3> filePositions(numPositions), fileNormals(numNormals);
+	std::vector<vec2> fileTextCoords(numTextCoords);
+
+	threadPool->parallelFor(numBlocks, [&](size_t blockIdx)
+	{
+		this->parseBlock(blocks[blockIdx], numPositions, numTextCoords, numNormals, filePositions, fileTextCoords, fileNormals);
+	});
+
+	_file.close();
+
+	// Corners are gathered in file order
+	std::vector<size_t> cornerOffset(numBlocks + 1, 0);
+	unsigned numInvalidFaces = 0;
+	bool attributes = false;
+
+	for (size_t blockIdx = 0; blockIdx < numBlocks; ++blockIdx)
+	{
+		cornerOffset[blockIdx + 1] = cornerOffset[blockIdx] + blocks[blockIdx]._corner.size();
+		numInvalidFaces += blocks[blockIdx]._numInvalidFaces;
+		attributes = attributes || blocks[blockIdx]._attributes;
+	}
+
+	const size_t numCorners = cornerOffset.back();
+	std::vector<Corner> corners(numCorners);
+
+	threadPool->parallelFor(numBlocks, [&](size_t blockIdx)
+	{
+		std::copy(blocks[blockIdx]._corner.begin(), blocks[blockIdx]._corner.end(), corners.begin() + cornerOffset[blockIdx]);
+		std::vector<Corner>().swap(blocks[blockIdx]._corner);
+	});
+
+	if (numInvalidFaces)
+	{
+		std::cerr << filename << " has " << numInvalidFaces << " faces with less than three corners or indices out of range, which were skipped" << std::endl;
+	}
+
+	const size_t numVertexBlocks = (numPositions + VERTEX_BLOCK_SIZE - 1) / VERTEX_BLOCK_SIZE;
+	std::vector<unsigned> cornerVertex(numCorners), groupCorner;
+	std::vector<size_t> firstVertex(numPositions + 1), groupOffset;
+
+	if (!attributes)
+	{
+		// Without texture coordinates or normals, every position is a vertex
+		std::iota(firstVertex.begin(), firstVertex.end(), size_t(0));
+		std::transform(corners.begin(), corners.end(), cornerVertex.begin(), [](const Corner& corner) { return corner._position; });
+	}
+	else
+	{
+		// Corners are grouped by position, and the distinct attributes of each group become vertices in order of appearance
+		groupOffset.resize(numPositions + 1, 0);
+		groupCorner.resize(numCorners);
+
+		for (const Corner& corner : corners) ++groupOffset[corner._position + 1];
+		std::partial_sum(groupOffset.begin(), groupOffset.end(), groupOffset.begin());
+
+		std::vector<size_t> groupEnd(groupOffset.begin(), groupOffset.end() - 1);
+		for (size_t cornerIdx = 0; cornerIdx < numCorners; ++cornerIdx) groupCorner[groupEnd[corners[cornerIdx]._position]++] = unsigned(cornerIdx);
+
+		firstVertex[0] = 0;
+
+		threadPool->parallelFor(numVertexBlocks, [&](size_t blockIdx)
+		{
+			std::vector<unsigned> distinctCorner;
+
+			for (size_t positionIdx = blockIdx * VERTEX_BLOCK_SIZE; positionIdx < std::min(numPositions, (blockIdx + 1) * VERTEX_BLOCK_SIZE); ++positionIdx)
+			{
+				distinctCorner.clear();
+
+				for (size_t groupIdx = groupOffset[positionIdx]; groupIdx < groupOffset[positionIdx + 1]; ++groupIdx)
+				{
+					const Corner& corner = corners[groupCorner[groupIdx]];
+					unsigned vertexIdx = 0;
+
+					while (vertexIdx < distinctCorner.size() && (corners[distinctCorner[vertexIdx]]._textCoord != corner._textCoord || corners[distinctCorner[vertexIdx]]._normal != corner._normal)) ++vertexIdx;
+					if (vertexIdx == distinctCorner.size()) distinctCorner.push_back(groupCorner[groupIdx]);
+
+					cornerVertex[groupCorner[groupIdx]] = vertexIdx;
+				}
+
+				// Positions without corners are kept as well
+				firstVertex[positionIdx + 1] = std::max(distinctCorner.size(), size_t(1));
+			}
+		});
+
+		std::partial_sum(firstVertex.begin(), firstVertex.end(), firstVertex.begin());
+
+		threadPool->parallelFor((numCorners + VERTEX_BLOCK_SIZE - 1) / VERTEX_BLOCK_SIZE, [&](size_t blockIdx)
+		{
+			for (size_t cornerIdx = blockIdx * VERTEX_BLOCK_SIZE; cornerIdx < std::min(numCorners, (blockIdx + 1) * VERTEX_BLOCK_SIZE); ++cornerIdx)
+			{
+				cornerVertex[cornerIdx] += unsigned(firstVertex[corners[cornerIdx]._position]);
+			}
+		});
+	}
+
+	const size_t numVertices = firstVertex.back();
+	positions.resize(numVertices);
+	normals.resize(numVertices, vec3(.0f));
+	textCoords.resize(numVertices, vec2(.0f));
+
+	threadPool->parallelFor(numVertexBlocks, [&](size_t blockIdx)
+	{
+		for (size_t positionIdx = blockIdx * VERTEX_BLOCK_SIZE; positionIdx < std::min(numPositions, (blockIdx + 1) * VERTEX_BLOCK_SIZE); ++positionIdx)
+		{
+			for (size_t vertexIdx = firstVertex[positionIdx]; vertexIdx < firstVertex[positionIdx + 1]; ++vertexIdx) positions[vertexIdx] = vec4(filePositions[positionIdx], 1.0f);
+			if (!attributes) continue;
+
+			// Vertices of a position are only written by the task of that position
+			for (size_t groupIdx = groupOffset[positionIdx]; groupIdx < groupOffset[positionIdx + 1]; ++groupIdx)
+			{
+				const Corner& corner = corners[groupCorner[groupIdx]];
+				const unsigned vertexIdx = cornerVertex[groupCorner[groupIdx]];
+
+				if (corner._normal != INVALID_INDEX) normals[vertexIdx] = fileNormals[corner._normal];
+				if (corner._textCoord != INVALID_INDEX) textCoords[vertexIdx] = fileTextCoords[corner._textCoord];
+			}
+		}
+	});
+
+	faces.resize(numCorners / 3);
+
+	threadPool->parallelFor((faces.size() + VERTEX_BLOCK_SIZE - 1) / VERTEX_BLOCK_SIZE, [&](size_t blockIdx)
+	{
+		for (size_t faceIdx = blockIdx * VERTEX_BLOCK_SIZE; faceIdx < std::min(faces.size(), (blockIdx + 1) * VERTEX_BLOCK_SIZE); ++faceIdx)
+		{
+			faces[faceIdx] = uvec3(cornerVertex[faceIdx * 3], cornerVertex[faceIdx * 3 + 1], cornerVertex[faceIdx * 3 + 2]);
+		}
+	});
+
+	return true;
+}
+
+/// [Protected methods]
+
+void OBJReader::countElements(Block& block) const
+{
+	const char* text = reinterpret_cast<const char*>(_file.data());
+	const char *line = text + block._begin, *end = text + block._end, *arguments;
+
+	block._numPositions = block._numTextCoords = block._numNormals = 0;
+
+	while (line < end)
+	{
+		line = OBJReader::skipSpaces(line, end);
+
+		const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+		if (!lineEnd) lineEnd = end;
+
+		switch (OBJReader::getLineType(line, lineEnd, arguments))
+		{
+		case POSITION: ++block._numPositions; break;
+		case TEXT_COORD: ++block._numTextCoords; break;
+		case NORMAL: ++block._numNormals; break;
+		default: break;
+		}
+
+		line = lineEnd + 1;
+	}
+}
+
+void OBJReader::parseBlock(Block& block, size_t numPositions, size_t numTextCoords, size_t numNormals, std::vector<vec3>& positions, std::vector<vec2>& textCoords, std::vector<vec3>& normals) const
+{
+	const char* text = reinterpret_cast<const char*>(_file.data());
+	const char *line = text + block._begin, *end = text + block._end, *arguments;
+	size_t positionIdx = block._firstPosition, textCoordIdx = block._firstTextCoord, normalIdx = block._firstNormal;
+	std::vector<Corner> polygon;
+
+	block._corner.clear();
+	block._numInvalidFaces = 0;
+	block._attributes = false;
+
+	while (line < end)
+	{
+		line = OBJReader::skipSpaces(line, end);
+
+		const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+		if (!lineEnd) lineEnd = end;
+
+		const LineType lineType = OBJReader::getLineType(line, lineEnd, arguments);
+
+		if (lineType == POSITION || lineType == NORMAL)
+		{
+			// Further values, such as vertex colours, are ignored
+			vec3 value(.0f);
+			for (int axis = 0; axis < 3; ++axis) arguments = OBJReader::parseFloat(OBJReader::skipSpaces(arguments, lineEnd), lineEnd, value[axis]);
+
+			if (lineType == POSITION) positions[positionIdx++] = value;
+			else normals[normalIdx++] = value;
+		}
+		else if (lineType == TEXT_COORD)
+		{
+			vec2 value(.0f);
+			for (int axis = 0; axis < 2; ++axis) arguments = OBJReader::parseFloat(OBJReader::skipSpaces(arguments, lineEnd), lineEnd, value[axis]);
+
+			textCoords[textCoordIdx++] = value;
+		}
+		else if (lineType == FACE)
+		{
+			const char* cursor = OBJReader::skipSpaces(arguments, lineEnd);
+			bool valid = true;
+
+			polygon.clear();
+
+			while (cursor < lineEnd && *cursor != '#')
+			{
+				Corner corner{ 0, INVALID_INDEX, INVALID_INDEX };
+				const char* next = OBJReader::parseIndex(cursor, lineEnd, positionIdx, numPositions, corner._position, valid);
+
+				if (next == cursor)
+				{
+					valid = false;
+					break;
+				}
+
+				// Either form of v, v/vt, v//vn or v/vt/vn
+				cursor = next;
+				if (cursor < lineEnd && *cursor == '/')
+				{
+					cursor = OBJReader::parseIndex(cursor + 1, lineEnd, textCoordIdx, numTextCoords, corner._textCoord, valid);
+					if (cursor < lineEnd && *cursor == '/') cursor = OBJReader::parseIndex(cursor + 1, lineEnd, normalIdx, numNormals, corner._normal, valid);
+				}
+
+				polygon.push_back(corner);
+				cursor = OBJReader::skipSpaces(cursor, lineEnd);
+			}
+
+			if (!valid || polygon.size() < 3)
+			{
+				++block._numInvalidFaces;
+			}
+			else
+			{
+				for (size_t cornerIdx = 1; cornerIdx + 1 < polygon.size(); ++cornerIdx)
+				{
+					block._corner.push_back(polygon[0]);
+					block._corner.push_back(polygon[cornerIdx]);
+					block._corner.push_back(polygon[cornerIdx + 1]);
+				}
+
+				for (const Corner& corner : polygon) block._attributes = block._attributes || corner._textCoord != INVALID_INDEX || corner._normal != INVALID_INDEX;
+			}
+		}
+
+		line = lineEnd + 1;
+	}
+}
+
+size_t OBJReader::getLineStart(size_t offset) const
+{
+	const size_t size = _file.size();
+	if (!offset) return 0;
+	if (offset >= size) return size;
+
+	const void* lineBreak = std::memchr(_file.data() + offset - 1, '\n', size - offset + 1);
+
+	return lineBreak ? size_t(static_cast<const uint8_t*>(lineBreak) - _file.data()) + 1 : size;
+}
+
+OBJReader::LineType OBJReader::getLineType(const char* line, const char* lineEnd, const char*& arguments)
+{
+	// Keywords are followed by a space or a tab
+	auto isKeyword = [&](const char* keyword, size_t length)
+	{
+		return size_t(lineEnd - line) > length && !std::memcmp(line, keyword, length) && (line[length] == ' ' || line[length] == '\t');
+	};
+
+	if (isKeyword("v", 1)) { arguments = line + 1; return POSITION; }
+	if (isKeyword("vt", 2)) { arguments = line + 2; return TEXT_COORD; }
+	if (isKeyword("vn", 2)) { arguments = line + 2; return NORMAL; }
+	if (isKeyword("f", 1)) { arguments = line + 1; return FACE; }
+
+	return OTHER;
+}
+
+const char* OBJReader::parseFloat(const char* text, const char* end, float& value)
+{
+	const static double POWER_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	const int MAX_DIGITS = 19, MAX_EXACT_EXPONENT = 22;
+
+	const char* cursor = text;
+	const bool negative = cursor < end && *cursor == '-';
+	if (cursor < end && (*cursor == '-' || *cursor == '+')) ++cursor;
+
+	// Significant digits are accumulated as an integer while they fit, and further ones only shift the exponent
+	uint64_t mantissa = 0;
+	int exponent = 0, numDigits = 0;
+	bool anyDigit = false;
+
+	for (; cursor < end && unsigned(*cursor - '0') < 10; ++cursor)
+	{
+		anyDigit = true;
+
+		if (numDigits < MAX_DIGITS)
+		{
+			mantissa = mantissa * 10 + unsigned(*cursor - '0');
+			numDigits += mantissa > 0;
+		}
+		else ++exponent;
+	}
+
+	if (cursor < end && *cursor == '.')
+	{
+		for (++cursor; cursor < end && unsigned(*cursor - '0') < 10; ++cursor)
+		{
+			anyDigit = true;
+
+			if (numDigits < MAX_DIGITS)
+			{
+				mantissa = mantissa * 10 + unsigned(*cursor - '0');
+				numDigits += mantissa > 0;
+				--exponent;
+			}
+		}
+	}
+
+	if (!anyDigit) return text;
+
+	if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+	{
+		const char* exponentCursor = cursor + 1;
+		const bool negativeExponent = exponentCursor < end && *exponentCursor == '-';
+		if (exponentCursor < end && (*exponentCursor == '-' || *exponentCursor == '+')) ++exponentCursor;
+
+		// The exponent is only consumed if it has digits
+		if (exponentCursor < end && unsigned(*exponentCursor - '0') < 10)
+		{
+			int exponentValue = 0;
+			for (; exponentCursor < end && unsigned(*exponentCursor - '0') < 10; ++exponentCursor)
+			{
+				exponentValue = std::min(exponentValue * 10 + int(*exponentCursor - '0'), 100000);
+			}
+
+			exponent += negativeExponent ? -exponentValue : exponentValue;
+			cursor = exponentCursor;
+		}
+	}
+
+	// Powers of ten up to 1e22 are exact in double precision, hence the usual case is correctly rounded before narrowing it to float
+	double result = double(mantissa);
+	if (exponent < 0) result = exponent >= -MAX_EXACT_EXPONENT ? result / POWER_OF_TEN[-exponent] : result * std::pow(10.0, exponent);
+	else if (exponent > 0) result = exponent <= MAX_EXACT_EXPONENT ? result * POWER_OF_TEN[exponent] : result * std::pow(10.0, exponent);
+
+	value = float(negative ? -result : result);
+
+	return cursor;
+}
+
+const char* OBJReader::parseIndex(const char* text, const char* end, size_t numPrevious, size_t numElements, unsigned& index, bool& valid)
+{
+	const char* cursor = text;
+	const bool negative = cursor < end && *cursor == '-';
+	if (negative) ++cursor;
+
+	const char* firstDigit = cursor;
+	int64_t value = 0;
+
+	for (; cursor < end && unsigned(*cursor - '0') < 10; ++cursor) value = std::min(value * 10 + int64_t(*cursor - '0'), int64_t(1) << 40);
+	if (cursor == firstDigit) return text;
+
+	// Indices start at one, whereas negative ones count backwards from the last element defined before the face
+	const int64_t elementIdx = negative ? int64_t(numPrevious) - value : value - 1;
+
+	if (value == 0 || elementIdx < 0 || elementIdx >= int64_t(numElements)) valid = false;
+	else index = unsigned(elementIdx);
+
+	return cursor;
+}
+
+const char* OBJReader::skipSpaces(const char* text, const char* end)
+{
+	while (text < end && (*text == ' ' || *text == '\t' || *text == '\r')) ++text;
+
+	return text;
+}
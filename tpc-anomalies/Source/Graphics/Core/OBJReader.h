@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Utilities/MappedFile.h"
+
+/**
+*	@file OBJReader.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Reader of the geometry of Wavefront OBJ files. The file is mapped into memory and split into blocks at line boundaries, which are parsed
+*	by several threads: a first pass counts the elements of each block, so that the second one stores them in place and resolves relative indices.
+*	Faces may use any index form (v, v/vt, v//vn, v/vt/vn) and negative indices; polygons are triangulated as fans. Corners sharing position,
+*	texture coordinate and normal are merged into a single vertex, hence vertices match the positions of the file if no other attribute is referenced.
+*/
+class OBJReader
+{
+protected:
+	/**
+	*	@brief Indices of the position, texture coordinate and normal of a face corner, starting at zero.
+	*/
+	struct Corner
+	{
+		unsigned	_position;										//!< Index of the position
+		unsigned	_textCoord;										//!< Index of the texture coordinate, or INVALID_INDEX
+		unsigned	_normal;										//!< Index of the normal, or INVALID_INDEX
+	};
+
+	/**
+	*	@brief Kind of element defined by a line.
+	*/
+	enum LineType : uint8_t
+	{
+		POSITION, TEXT_COORD, NORMAL, FACE, OTHER
+	};
+
+	/**
+	*	@brief Content of the lines starting within a range of bytes.
+	*/
+	struct Block
+	{
+		size_t		_begin, _end;									//!< Range of the file, from the start of a line to the start of another one
+		size_t		_firstPosition, _numPositions;					//!< Global index of the first position of the block, and number of positions
+		size_t		_firstTextCoord, _numTextCoords;				//!< Global index of the first texture coordinate, and number of them
+		size_t		_firstNormal, _numNormals;						//!< Global index of the first normal, and number of them
+		std::vector<Corner>	_corner;								//!< Corners of triangulated faces, three per triangle
+		unsigned	_numInvalidFaces;								//!< Faces with less than three corners or with indices out of range
+		bool		_attributes;									//!< Any corner refers to a texture coordinate or normal
+	};
+
+protected:
+	const static unsigned		INVALID_INDEX;						//!< Missing attribute of a corner
+	const static unsigned		PARSE_BLOCK_SIZE;					//!< Bytes parsed by a single task, rounded to whole lines
+	const static unsigned		VERTEX_BLOCK_SIZE;					//!< Positions whose corners are merged by a single task
+
+protected:
+	MappedFile					_file;								//!< Mapped content of the file
+
+protected:
+	/**
+	*	@brief Counts the positions, texture coordinates and normals defined within a block.
+	*/
+	void countElements(Block& block) const;
+
+	/**
+	*	@brief Parses the lines of a block. Elements are stored from the global offsets of the block, which were given by countElements.
+	*/
+	void parseBlock(Block& block, size_t numPositions, size_t numTextCoords, size_t numNormals, std::vector<vec3>& positions, std::vector<vec2>& textCoords, std::vector<vec3>& normals) const;
+
+	/**
+	*	@return Offset of the first line starting at or after the given offset.
+	*/
+	size_t getLineStart(size_t offset) const;
+
+	/**
+	*	@return Kind of element defined by a line without leading spaces. Its arguments start at the returned character.
+	*/
+	static LineType getLineType(const char* line, const char* lineEnd, const char*& arguments);
+
+	/**
+	*	@brief Parses a decimal number with optional sign, fraction and exponent, regardless of the locale.
+	*	@return Character following the number, or text if there is no number.
+	*/
+	static const char* parseFloat(const char* text, const char* end, float& value);
+
+	/**
+	*	@brief Parses a face index, given by the number of elements defined so far if it is negative.
+	*	@return Character following the index, or text if there is no index.
+	*/
+	static const char* parseIndex(const char* text, const char* end, size_t numPrevious, size_t numElements, unsigned& index, bool& valid);
+
+	/**
+	*	@return First character which is not a space, a tab or a carriage return.
+	*/
+	static const char* skipSpaces(const char* text, const char* end);
+
+public:
+	/**
+	*	@brief Constructor.
+	*/
+	OBJReader();
+
+	/**
+	*	@brief Invalid copy constructor.
+	*/
+	OBJReader(const OBJReader& reader) = delete;
+
+	/**
+	*	@brief Destructor.
+	*/
+	virtual ~OBJReader();
+
+	/**
+	*	@brief Reads the triangles of a file. Attributes not given by a corner are left as zero.
+	*	@param positions Positions of vertices, as (x, y, z, 1).
+	*	@param faces Vertex indices of each triangle.
+	*	@return True if the file could be read.
+	*/
+	bool read(const std::string& filename, std::vector<vec4>& positions, std::vector<vec3>& normals, std::vector<vec2>& textCoords, std::vector<uvec3>& faces);
+};
+
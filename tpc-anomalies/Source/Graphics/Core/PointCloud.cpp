@@ -2,50 +2,141 @@
 #include "PointCloud.h"
 
 #include <filesystem>
+#include "DataStructures/GridCache.h"
+#include "DataStructures/PointFilter.h"
+#include "DataStructures/RegularGrid.h"
 #include "Graphics/Application/TextureList.h"
+#include "Graphics/Core/LASReader.h"
 #include "Graphics/Core/ShaderList.h"
 #include "Graphics/Core/VAO.h"
+#include "Utilities/ThreadPool.h"
 #include "tinyply.h"
 
 // Initialization of static attributes
+const unsigned PointCloud::ANOMALY_BLOCK_SIZE = 4096;
+const unsigned PointCloud::LAS_BLOCK_SIZE = 1 << 16;
+const float PointCloud::MAD_TO_STD = 1.4826f;
+const float PointCloud::MIN_TEMPERATURE_SPREAD = 0.01f;
+const unsigned PointCloud::UPLOAD_CHUNK_SIZE = 1 << 22;
 const std::string PointCloud::WRITE_POINT_CLOUD_FOLDER = "PointClouds/";
 
 /// Public methods
 
 PointCloud::PointCloud(const std::string& filename, const bool useBinary, const mat4& modelMatrix) :
-	Model3D(modelMatrix, 1), _filename(filename), _offset(.0f), _useBinary(useBinary)
+	Model3D(modelMatrix, 1), _filename(filename), _offset(.0), _useBinary(useBinary), _duplicateTolerance(-1.0f), _outlierNeighbors(0), _outlierStdFactor(3.0f), _previewBudget(0), _previewCellPoint(PointDecimation::NEAREST_TO_CENTER), _previewBlueNoise(false),
+	_kdTree(nullptr), _contentHash(0)
 {
 }
 
+PointCloud::PointCloud(const std::vector<std::string>& filenames, const std::string& name, const bool useBinary, const mat4& modelMatrix) :
+	PointCloud(name, useBinary, modelMatrix)
+{
+	_inputFiles = filenames;
+}
+
 PointCloud::~PointCloud()
 {
+	delete _kdTree;
+}
+
+KdTree* PointCloud::getKdTree()
+{
+	if (!_kdTree)
+	{
+		_kdTree = new KdTree(_points);
+	}
+
+	return _kdTree;
+}
+
+uint64_t PointCloud::getContentHash()
+{
+	if (!_contentHash)
+	{
+		const size_t numPoints = _points.size(), numBlocks = _points.getNumBlocks();
+		std::vector<uint64_t> blockHash(numBlocks);
+
+		// Blocks are hashed independently and then chained in order, so the result does not depend on the number of threads
+		ThreadPool::getInstance()->parallelFor(numBlocks, [&](size_t blockIdx)
+		{
+			blockHash[blockIdx] = _points.hashBlock(blockIdx, GridCache::hash(&blockIdx, sizeof(size_t)));
+		});
+
+		// Equal local points are different clouds if they lie elsewhere, which matters to exported grids
+		_contentHash = GridCache::hash(&numPoints, sizeof(size_t));
+		_contentHash = GridCache::hash(&_offset, sizeof(glm::dvec3), _contentHash);
+		if (numBlocks) _contentHash = GridCache::hash(blockHash.data(), numBlocks * sizeof(uint64_t), _contentHash);
+		if (!_contentHash) _contentHash = 1;
+	}
+
+	return _contentHash;
 }
 
 bool PointCloud::load(const mat4& modelMatrix)
+{
+	return this->load(modelMatrix, nullptr);
+}
+
+bool PointCloud::load(const mat4& modelMatrix, TaskProgress* progress, LoadListener* listener)
 {
 	if (!_loaded)
 	{
-		bool success = false, binaryExists = false;
+		bool success = false, binaryLoaded = false;
+		TaskProgress silentProgress(false);
+		if (!progress) progress = &silentProgress;
 
-		if (_useBinary && (binaryExists = std::filesystem::exists(_filename + BINARY_EXTENSION)))
+		try
 		{
-			success = this->loadModelFromBinaryFile();
-		}
+			if (_useBinary && std::filesystem::exists(this->getBinaryFilename()))
+			{
+				// Binaries of an older layout are rejected, and then replaced once the source files are read
+				progress->beginStage("Reading binary cloud", 0, "points");
+				success = binaryLoaded = this->loadModelFromBinaryFile();
+				progress->advance(_points.size());
+				progress->endStage();
+			}
+
+			if (!success)
+			{
+				success = this->loadModelFromLAS(progress, listener);
+			}
+
+			if (!success)
+			{
+				success = this->loadModelFromPLY(modelMatrix, progress, listener);
+			}
 
-		if (!success)
+			if (success && !binaryLoaded)
+			{
+				this->filterPoints(progress);
+			}
+
+			if (success)
+			{
+				if (listener) listener->pointsReady();
+				this->buildPreview(progress);
+			}
+		}
+		catch (const TaskCancelled&)
 		{
-			success = this->loadModelFromPLY(modelMatrix);
+			_points.clear();
+			_preview.clear();
+			_aabb = AABB();
+			_offset = glm::dvec3(.0);
+			std::cout << "Point cloud loading cancelled" << std::endl;
+
+			return false;
 		}
 
 		std::cout << "Number of Points: " << _points.size() << std::endl;
 
 		if (success)
 		{
-			this->setVAOData();
+			if (!listener) this->setVAOData();
 
-			if (!binaryExists)
+			if (_useBinary && !binaryLoaded)
 			{
-				this->writeToBinary(_filename + BINARY_EXTENSION);
+				this->writeToBinary(this->getBinaryFilename());
 			}
 		}
 
@@ -57,45 +148,479 @@ bool PointCloud::load(const mat4& modelMatrix)
 	return false;
 }
 
+size_t PointCloud::locateAnomalies(bool robust, unsigned numNeighbors, float radius, float stdFactor, TaskProgress* progress)
+{
+	const size_t numPoints = _points.size();
+	if (!numPoints) return 0;
+
+	TaskProgress silentProgress(false);
+	if (!progress) progress = &silentProgress;
+
+	const KdTree* kdTree = this->getKdTree();
+	const size_t numBlocks = (numPoints + ANOMALY_BLOCK_SIZE - 1) / ANOMALY_BLOCK_SIZE;
+
+	_anomalyScore.resize(numPoints);
+	_anomalyFlag.resize(numPoints);
+	progress->beginStage("Locating point anomalies", numPoints, "points");
+
+	const size_t numAnomalies = ThreadPool::getInstance()->parallelReduce(numBlocks, size_t(0), [&](size_t blockIdx)
+	{
+		std::vector<unsigned> neighbors, nearest(numNeighbors + 1);
+		std::vector<float> distances2(numNeighbors + 1), temperature;
+		size_t numAnomalies = 0;
+
+		for (size_t pointIdx = blockIdx * ANOMALY_BLOCK_SIZE; pointIdx < std::min(numPoints, (blockIdx + 1) * ANOMALY_BLOCK_SIZE); ++pointIdx)
+		{
+			const vec3 query = _points.getPoint(pointIdx);
+
+			// One more neighbour is requested, as the point itself is found as well
+			neighbors.clear();
+			if (radius > .0f) kdTree->radiusSearch(query, radius, neighbors);
+
+			if (neighbors.size() < numNeighbors + 1)
+			{
+				kdTree->knnSearch(query, numNeighbors + 1, nearest.data(), distances2.data());
+				neighbors.assign(nearest.begin(), std::find(nearest.begin(), nearest.end(), KdTree::INVALID_INDEX));
+			}
+
+			temperature.clear();
+			for (unsigned neighborIdx : neighbors)
+			{
+				if (neighborIdx != pointIdx) temperature.push_back(_points.getThermal(neighborIdx));
+			}
+
+			const float pointTemperature = _points.getThermal(pointIdx);
+			float center = pointTemperature, spread = .0f;
+
+			if (!temperature.empty())
+			{
+				if (robust)
+				{
+					const size_t middle = temperature.size() / 2;
+					std::nth_element(temperature.begin(), temperature.begin() + middle, temperature.end());
+					center = temperature[middle];
+
+					for (float& value : temperature) value = std::abs(value - center);
+					std::nth_element(temperature.begin(), temperature.begin() + middle, temperature.end());
+					spread = MAD_TO_STD * temperature[middle];
+				}
+				else
+				{
+					float sum = .0f, sum2 = .0f;
+					for (float value : temperature) { sum += value; sum2 += value * value; }
+
+					center = sum / temperature.size();
+					spread = std::sqrt(std::max(.0f, sum2 / temperature.size() - center * center));
+				}
+			}
+
+			const float score = (pointTemperature - center) / std::max(spread, MIN_TEMPERATURE_SPREAD);
+
+			_anomalyScore[pointIdx] = score;
+			_anomalyFlag[pointIdx] = score > stdFactor ? LOCAL_PEAK_MAX : (score < -stdFactor ? LOCAL_PEAK_MIN : LOCAL_PEAK_NONE);
+			numAnomalies += _anomalyFlag[pointIdx] != LOCAL_PEAK_NONE;
+		}
+
+		progress->advance(std::min(numPoints, (blockIdx + 1) * ANOMALY_BLOCK_SIZE) - blockIdx * ANOMALY_BLOCK_SIZE);
+
+		return numAnomalies;
+	}, [](size_t& accumulated, size_t& partial) { accumulated += partial; });
+
+	progress->endStage();
+
+	return numAnomalies;
+}
+
+void PointCloud::setPreview(size_t budget, PointDecimation::CellPoint cellPoint, bool blueNoise)
+{
+	_previewBudget = budget;
+	_previewCellPoint = cellPoint;
+	_previewBlueNoise = blueNoise;
+
+	if (_loaded)
+	{
+		TaskProgress progress;
+		this->buildPreview(&progress);
+		this->uploadRenderedPoints();
+	}
+}
+
+void PointCloud::appendRenderedPoints(size_t firstPoint, size_t numPoints, const vec4* points, const vec3* rgb)
+{
+	ModelComponent* modelComp = _modelComp[0];
+	if (!modelComp->_vao || !numPoints) return;
+
+	// Ranges arrive in any order, hence slots are drawn through indices which are appended in the same order
+	std::vector<GLuint> indices(numPoints);
+	std::iota(indices.begin(), indices.end(), GLuint(firstPoint));
+
+	modelComp->_vao->setVBOSubData(RendEnum::VBO_POSITION, points, GLuint(firstPoint), GLuint(numPoints));
+	modelComp->_vao->setVBOSubData(RendEnum::VBO_COLOR_01, rgb, GLuint(firstPoint), GLuint(numPoints));
+	modelComp->_vao->setIBOSubData(RendEnum::IBO_POINT_CLOUD, indices.data(), modelComp->_topologyIndicesLength[RendEnum::IBO_POINT_CLOUD], GLuint(numPoints));
+	modelComp->_topologyIndicesLength[RendEnum::IBO_POINT_CLOUD] += unsigned(numPoints);
+}
+
+void PointCloud::reserveRenderedPoints(size_t numPoints)
+{
+	VAO* vao = new VAO(false);
+	ModelComponent* modelComp = _modelComp[0];
+
+	vao->defineVBO(RendEnum::VBO_COLOR_01, vec3(.0f), GL_FLOAT);
+	vao->setVBOData(RendEnum::VBO_POSITION, static_cast<vec4*>(nullptr), GLuint(numPoints), GL_DYNAMIC_DRAW);
+	vao->setVBOData(RendEnum::VBO_COLOR_01, static_cast<vec3*>(nullptr), GLuint(numPoints), GL_DYNAMIC_DRAW);
+	vao->setIBOData(RendEnum::IBO_POINT_CLOUD, nullptr, GLuint(numPoints), GL_DYNAMIC_DRAW);
+
+	delete modelComp->_vao;
+	modelComp->_vao = vao;
+	modelComp->_topologyIndicesLength[RendEnum::IBO_POINT_CLOUD] = 0;
+}
+
+void PointCloud::uploadRenderedPoints()
+{
+	delete _modelComp[0]->_vao;
+	_modelComp[0]->_vao = nullptr;
+	this->setVAOData();
+}
+
 /// [Protected methods]
 
+void PointCloud::buildPreview(TaskProgress* progress)
+{
+	const float spacing = PointDecimation::decimate(_points, _aabb, _previewBudget, _previewCellPoint, _previewBlueNoise, _preview, progress);
+
+	if (_preview.size()) std::cout << "Rendering a preview of " << _preview.size() << " points, spaced " << spacing << " apart" << std::endl;
+}
+
 void PointCloud::computeCloudData()
 {
 	ModelComponent* modelComp = _modelComp[0];
 
 	// Fill point cloud indices with iota
-	modelComp->_pointCloud.resize(_points.size());
+	modelComp->_pointCloud.resize(this->getNumberOfRenderedPoints());
 	std::iota(modelComp->_pointCloud.begin(), modelComp->_pointCloud.end(), 0);
 }
 
+void PointCloud::filterPoints(TaskProgress* progress)
+{
+	std::vector<uint8_t> keep;
+	size_t numDuplicates = 0, numOutliers = 0;
+
+	if (_duplicateTolerance >= .0f)
+	{
+		numDuplicates = PointFilter::flagDuplicates(_points, _aabb, _duplicateTolerance, keep, progress);
+		if (numDuplicates) _points.compact(keep);
+	}
+
+	// Duplicates would otherwise shorten the neighbour distances of overlaps, hiding their outliers
+	if (_outlierNeighbors)
+	{
+		std::unique_ptr<KdTree> kdTree(new KdTree(_points));
+		numOutliers = PointFilter::flagOutliers(_points, *kdTree, _outlierNeighbors, _outlierStdFactor, keep, progress);
+		kdTree.reset();
+
+		if (numOutliers) _points.compact(keep);
+	}
+
+	if (numOutliers) _aabb = _points.getAABB();
+	if (numDuplicates || numOutliers) std::cout << "Removed " << numDuplicates << " duplicates and " << numOutliers << " outliers" << std::endl;
+}
+
+std::string PointCloud::getBinaryFilename() const
+{
+	// Wildcards are not valid in file names, hence patterns are cached under a sanitized name
+	std::string filename = _filename;
+	std::replace(filename.begin(), filename.end(), '*', '_');
+	std::replace(filename.begin(), filename.end(), '?', '_');
+
+	return filename + BINARY_EXTENSION;
+}
+
+std::vector<std::string> PointCloud::getInputFiles(const std::string& extension) const
+{
+	const auto toLower = [](std::string text) { std::transform(text.begin(), text.end(), text.begin(), [](char character) { return char(std::tolower(static_cast<unsigned char>(character))); }); return text; };
+	const auto hasExtension = [&](const std::filesystem::path& path) { return toLower(path.extension().string()) == extension; };
+
+	std::vector<std::string> filenames;
+	std::error_code error;
+
+	if (!_inputFiles.empty())
+	{
+		for (const std::string& filename : _inputFiles)
+		{
+			if (hasExtension(filename)) filenames.push_back(filename);
+		}
+	}
+	else if (std::filesystem::is_regular_file(_filename + extension, error))
+	{
+		filenames.push_back(_filename + extension);
+	}
+	else if (std::filesystem::is_directory(_filename, error))
+	{
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(_filename, error))
+		{
+			if (entry.is_regular_file(error) && hasExtension(entry.path())) filenames.push_back(entry.path().string());
+		}
+
+		std::sort(filenames.begin(), filenames.end());
+	}
+	else if (_filename.find_first_of("*?") != std::string::npos)
+	{
+		// Patterns without the extension, e.g., Station_*, are completed with it
+		const std::filesystem::path pattern(_filename);
+		const std::filesystem::path folder = pattern.has_parent_path() ? pattern.parent_path() : std::filesystem::path(".");
+		const std::string namePattern = toLower(pattern.filename().string() + (hasExtension(pattern) ? "" : extension));
+
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(folder, error))
+		{
+			if (entry.is_regular_file(error) && PointCloud::matchWildcard(toLower(entry.path().filename().string()), namePattern)) filenames.push_back(entry.path().string());
+		}
+
+		std::sort(filenames.begin(), filenames.end());
+	}
+
+	return filenames;
+}
+
 bool PointCloud::loadModelFromBinaryFile()
 {
-	return this->readBinary(_filename + BINARY_EXTENSION, _modelComp);
+	return this->readBinary(this->getBinaryFilename(), _modelComp);
 }
 
-bool PointCloud::loadModelFromPLY(const mat4& modelMatrix)
+bool PointCloud::loadModelFromLAS(TaskProgress* progress, LoadListener* listener)
+{
+	const std::vector<std::string> filenames = this->getInputFiles(LAS_EXTENSION);
+	if (filenames.empty()) return false;
+
+	// Headers are parsed first, so that every file is decoded straight into its slice of the cloud
+	std::vector<std::unique_ptr<LASReader>> readers;
+	std::vector<size_t> readerOffset;
+	glm::dvec3 minPoint(std::numeric_limits<double>::max());
+	LASReader::ThermalSource thermalSource = LASReader::EXTRA_BYTES;
+	size_t numPoints = 0;
+	bool hasColor = true;
+
+	for (const std::string& filename : filenames)
+	{
+		std::unique_ptr<LASReader> reader(new LASReader);
+		if (!reader->open(filename)) continue;
+
+		// Files without a temperature attribute force every file to fall back on the same, less specific source
+		thermalSource = std::max(thermalSource, reader->getThermalSource());
+		hasColor &= reader->hasColor();
+		minPoint = glm::min(minPoint, reader->getMinPoint());
+		readerOffset.push_back(numPoints);
+		numPoints += reader->getNumberOfPoints();
+		readers.push_back(std::move(reader));
+	}
+
+	if (readers.empty()) return false;
+
+	// Whole units keep the offset readable, whereas local coordinates stay within the extent of the cloud
+	_offset = glm::floor(minPoint);
+
+	std::vector<std::pair<unsigned, size_t>> tasks;
+	for (unsigned readerIdx = 0; readerIdx < readers.size(); ++readerIdx)
+	{
+		for (size_t firstPoint = 0; firstPoint < readers[readerIdx]->getNumberOfPoints(); firstPoint += LAS_BLOCK_SIZE) tasks.emplace_back(readerIdx, firstPoint);
+	}
+
+	// Points are decoded at full precision and then packed, as temperatures and colours are normalized over every file
+	std::vector<vec4> points(numPoints);
+	std::vector<vec3> rgb(numPoints, vec3(.0f));
+	std::vector<float> thermal(numPoints);
+
+	if (listener) listener->reserve(numPoints);
+	progress->beginStage("Reading LAS", numPoints, "points");
+
+	_aabb = ThreadPool::getInstance()->parallelReduce(tasks.size(), AABB(), [&](size_t taskIdx)
+	{
+		const LASReader* reader = readers[tasks[taskIdx].first].get();
+		const size_t firstPoint = tasks[taskIdx].second, pointIdx = readerOffset[tasks[taskIdx].first] + firstPoint;
+		const size_t blockPoints = std::min(reader->getNumberOfPoints(), firstPoint + LAS_BLOCK_SIZE) - firstPoint;
+
+		const AABB aabb = reader->read(firstPoint, blockPoints, thermalSource, _offset, &points[pointIdx], &rgb[pointIdx], &thermal[pointIdx]);
+		progress->advance(blockPoints);
+
+		if (listener)
+		{
+			// Colours are normalized over every file later on; meanwhile, each block guesses its own depth, and clouds without colours are grey
+			float maxColor = .0f;
+			for (size_t idx = pointIdx; idx < pointIdx + blockPoints; ++idx) maxColor = std::max(maxColor, std::max(rgb[idx].r, std::max(rgb[idx].g, rgb[idx].b)));
+
+			std::vector<vec3> blockColors(blockPoints, vec3(.5f));
+			if (hasColor)
+				std::transform(rgb.begin() + pointIdx, rgb.begin() + pointIdx + blockPoints, blockColors.begin(), [&](const vec3& color) { return color / (maxColor > 255.0f ? 65535.0f : 255.0f); });
+
+			listener->append(pointIdx, blockPoints, &points[pointIdx], blockColors.data(), _offset);
+		}
+
+		return aabb;
+	}, [](AABB& accumulated, AABB& partial) { if (partial.min().x <= partial.max().x) accumulated.update(partial); });
+
+	progress->endStage();
+
+	// LAS colours are meant to be 16-bit, although many writers store 8-bit values
+	const float maxColor = std::transform_reduce(std::execution::par_unseq, rgb.begin(), rgb.end(), .0f, [](float a, float b) { return std::max(a, b); },
+		[](const vec3& color) { return std::max(color.r, std::max(color.g, color.b)); });
+	const float colorScale = 1.0f / (maxColor > 255.0f ? 65535.0f : 255.0f);
+
+	const auto thermalRange = std::minmax_element(std::execution::par_unseq, thermal.begin(), thermal.end());
+	const float minThermal = *thermalRange.first, thermalSpread = *thermalRange.second - *thermalRange.first;
+
+	std::transform(std::execution::par_unseq, thermal.begin(), thermal.end(), thermal.begin(), [&](float temperature)
+	{
+		if (thermalSource == LASReader::RED_CHANNEL) return temperature * colorScale;
+
+		return thermalSpread > .0f ? (temperature - minThermal) / thermalSpread : .0f;
+	});
+
+	if (hasColor)
+		std::transform(std::execution::par_unseq, rgb.begin(), rgb.end(), rgb.begin(), [colorScale](const vec3& color) { return color * colorScale; });
+	else
+		std::transform(std::execution::par_unseq, thermal.begin(), thermal.end(), rgb.begin(), [](float temperature) { return vec3(temperature); });
+
+	_points.pack(points, rgb, thermal);
+	std::cout << "Read " << readers.size() << " LAS file(s)" << (thermalSource == LASReader::EXTRA_BYTES ? " with temperature attribute" : "") << std::endl;
+
+	return true;
+}
+
+bool PointCloud::loadModelFromPLY(const mat4& modelMatrix, TaskProgress* progress, LoadListener* listener)
+{
+	const std::vector<std::string> filenames = this->getInputFiles(PLY_EXTENSION);
+	if (filenames.empty()) return false;
+
+	// Headers are parsed first, so that the cloud is allocated once and every file is read straight into its own slice
+	std::vector<size_t> fileOffset(filenames.size() + 1, 0);
+	size_t totalBytes = 0;
+	bool hasTemperature = true;
+
+	progress->beginStage("Scanning PLY headers", filenames.size(), "files");
+
+	for (size_t fileIdx = 0; fileIdx < filenames.size(); ++fileIdx)
+	{
+		std::ifstream fileStream(filenames[fileIdx], std::ios::binary);
+		size_t numVertices = 0;
+		bool fileTemperature = false;
+
+		try
+		{
+			tinyply::PlyFile file;
+			if (fileStream.is_open() && file.parse_header(fileStream))
+			{
+				for (const tinyply::PlyElement& element : file.get_elements())
+				{
+					if (element.name != "vertex") continue;
+
+					numVertices = element.size;
+					fileTemperature = std::any_of(element.properties.begin(), element.properties.end(), [](const tinyply::PlyProperty& property) { return property.name == "temperature"; });
+				}
+			}
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "Caught tinyply exception: " << e.what() << std::endl;
+		}
+
+		if (!numVertices)
+		{
+			std::cerr << filenames[fileIdx] << " could not be read" << std::endl;
+			return false;
+		}
+
+		// Files without a temperature attribute force every file to fall back on the red channel, as LAS clouds do
+		hasTemperature &= fileTemperature;
+
+		std::error_code error;
+		totalBytes += size_t(std::filesystem::file_size(filenames[fileIdx], error));
+		fileOffset[fileIdx + 1] = fileOffset[fileIdx] + numVertices;
+		progress->advance(1);
+	}
+
+	progress->endStage();
+
+	const size_t numPoints = fileOffset.back();
+	std::atomic<bool> success(true);
+
+	std::vector<vec4> points(numPoints);
+	std::vector<vec3> rgb(numPoints);
+	std::vector<float> thermal(numPoints);
+
+	std::vector<glm::dvec3> fileOrigin(filenames.size());
+	std::vector<AABB> fileAABB(filenames.size());
+
+	if (listener) listener->reserve(numPoints);
+	progress->beginStage("Reading PLY", totalBytes, "bytes");
+
+	// tinyply reads whole files, hence merged clouds are handed over file by file
+	ThreadPool::getInstance()->parallelFor(filenames.size(), [&](size_t fileIdx)
+	{
+		const size_t firstPoint = fileOffset[fileIdx];
+		if (!this->readPLY(filenames[fileIdx], fileOffset[fileIdx + 1] - firstPoint, &points[firstPoint], &rgb[firstPoint], &thermal[firstPoint], hasTemperature, fileOrigin[fileIdx], fileAABB[fileIdx], progress)) success = false;
+		else if (listener) listener->append(firstPoint, fileOffset[fileIdx + 1] - firstPoint, &points[firstPoint], &rgb[firstPoint], fileOrigin[fileIdx]);
+	});
+
+	progress->endStage();
+
+	// Files are moved from their own origin to the lowest one; origins are whole units, so the shift is exact and only rounds at the scale of the cloud
+	const auto isRead = [&](size_t fileIdx) { return fileAABB[fileIdx].min().x <= fileAABB[fileIdx].max().x; };
+	_offset = glm::dvec3(std::numeric_limits<double>::max());
+	_aabb = AABB();
+
+	for (size_t fileIdx = 0; fileIdx < filenames.size(); ++fileIdx)
+	{
+		if (isRead(fileIdx)) _offset = glm::min(_offset, fileOrigin[fileIdx]);
+	}
+
+	if (_offset.x == std::numeric_limits<double>::max()) _offset = glm::dvec3(.0);
+
+	for (size_t fileIdx = 0; fileIdx < filenames.size(); ++fileIdx)
+	{
+		if (!isRead(fileIdx)) continue;
+		const vec3 shift = vec3(fileOrigin[fileIdx] - _offset);
+
+		if (shift != vec3(.0f))
+		{
+			std::for_each(std::execution::par_unseq, points.begin() + fileOffset[fileIdx], points.begin() + fileOffset[fileIdx + 1], [shift](vec4& point) { point += vec4(shift, .0f); });
+		}
+
+		_aabb.update(AABB(fileAABB[fileIdx].min() + shift, fileAABB[fileIdx].max() + shift));
+	}
+
+	// Temperature attributes are given in the units of the capture, and are normalized over every file as LAS attributes are
+	if (hasTemperature && numPoints)
+	{
+		const auto thermalRange = std::minmax_element(std::execution::par_unseq, thermal.begin(), thermal.end());
+		const float minThermal = *thermalRange.first, thermalSpread = *thermalRange.second - *thermalRange.first;
+
+		std::transform(std::execution::par_unseq, thermal.begin(), thermal.end(), thermal.begin(), [&](float temperature)
+		{
+			return thermalSpread > .0f ? (temperature - minThermal) / thermalSpread : .0f;
+		});
+	}
+
+	progress->checkpoint();
+	_points.pack(points, rgb, thermal);
+
+	if (filenames.size() > 1) std::cout << "Merged " << filenames.size() << " PLY files" << std::endl;
+
+	return success;
+}
+
+bool PointCloud::readPLY(const std::string& filename, size_t numPoints, vec4* points, vec3* rgb, float* thermal, bool readTemperature, glm::dvec3& origin, AABB& aabb, TaskProgress* progress)
 {
-	std::unique_ptr<std::istream> fileStream;
-	std::vector<uint8_t> byteBuffer;
 	std::shared_ptr<tinyply::PlyData> plyPoints, plyColors, plyThermals;
-	unsigned baseIndex;
-	float* pointsRaw;
-	uint8_t* colorsRaw, *tempRaw;
 
 	try
 	{
-		const std::string filename = _filename + PLY_EXTENSION;
-		bool hasTemperature = true;
-		fileStream.reset(new std::ifstream(filename, std::ios::binary));
-
-		if (!fileStream || fileStream->fail()) return false;
+		std::ifstream fileStream(filename, std::ios::binary);
+		if (fileStream.fail()) return false;
 
-		fileStream->seekg(0, std::ios::end);
-		const float size_mb = fileStream->tellg() * float(1e-6);
-		fileStream->seekg(0, std::ios::beg);
+		std::error_code error;
+		const size_t fileSize = size_t(std::filesystem::file_size(filename, error));
 
 		tinyply::PlyFile file;
-		file.parse_header(*fileStream);
+		file.parse_header(fileStream);
 
 		try { plyPoints = file.request_properties_from_element("vertex", { "x", "y", "z" }); }
 		catch (const std::exception& e) { std::cerr << "tinyply exception: " << e.what() << std::endl; }
@@ -103,54 +628,77 @@ bool PointCloud::loadModelFromPLY(const mat4& modelMatrix)
 		try { plyColors = file.request_properties_from_element("vertex", { "red", "green", "blue" }); }
 		catch (const std::exception& e) { std::cerr << "tinyply exception: " << e.what() << std::endl; }
 
-		try { plyThermals = file.request_properties_from_element("vertex", { "temperature" }); }
-		catch (const std::exception& e) { hasTemperature = false; }
+		if (readTemperature)
+		{
+			try { plyThermals = file.request_properties_from_element("vertex", { "temperature" }); }
+			catch (const std::exception& e) { std::cerr << "tinyply exception: " << e.what() << std::endl; }
+		}
 
-		file.read(*fileStream);
+		file.read(fileStream);
+		progress->advance(fileSize);
 
+		if (!plyPoints || plyPoints->count != numPoints || (plyPoints->t != tinyply::Type::FLOAT32 && plyPoints->t != tinyply::Type::FLOAT64))
 		{
-			const size_t numPoints = plyPoints->count;
-			const size_t numPointsBytes = numPoints * 4 * 3;
+			std::cerr << filename << " does not hold float coordinates" << std::endl;
+			return false;
+		}
 
-			const size_t numColors = plyColors->count;
-			const size_t numColorsBytes = numColors * 1 * 3;
+		// Georeferenced coordinates need doubles, which are made relative to the file origin before they are narrowed to floats
+		const bool doubleCoordinates = plyPoints->t == tinyply::Type::FLOAT64;
+		const float* pointsRaw = reinterpret_cast<const float*>(plyPoints->buffer.get());
+		const double* pointsRawDouble = reinterpret_cast<const double*>(plyPoints->buffer.get());
+		const auto getCoordinate = [&](size_t index) { return doubleCoordinates ? pointsRawDouble[index] : double(pointsRaw[index]); };
 
-			// Allocate space
-			_points.resize(numPoints); _rgb.resize(numPoints); _thermal.resize(numPoints);
-			pointsRaw = new float[numPoints * 3];
-			colorsRaw = new uint8_t[numColors * 3];
+		origin = glm::dvec3(std::numeric_limits<double>::max());
+		for (size_t ind = 0; ind < numPoints; ++ind)
+			origin = glm::min(origin, glm::dvec3(getCoordinate(ind * 3), getCoordinate(ind * 3 + 2), getCoordinate(ind * 3 + 1)));
 
-			std::memcpy(pointsRaw, plyPoints->buffer.get(), numPointsBytes);
-			std::memcpy(colorsRaw, plyColors->buffer.get(), numColorsBytes);
+		origin = glm::floor(origin);
 
-			if (hasTemperature)
-			{
-				const size_t numThermalValues = plyThermals->count;
-				const size_t numThermalValuesBytes = numThermalValues * 1 * 3;
+		const uint8_t* colorsRaw = plyColors && plyColors->count == numPoints ? plyColors->buffer.get() : nullptr;
 
-				tempRaw = new uint8_t[numPoints * 3];
-				std::memcpy(tempRaw, plyThermals->buffer.get(), numThermalValuesBytes);
-			}
-			else
+		if (readTemperature && (!plyThermals || plyThermals->count != numPoints))
+		{
+			std::cerr << filename << " does not hold a temperature per vertex" << std::endl;
+			return false;
+		}
+
+		// Temperatures are decoded as they are stored and normalized once every file is read, whereas the red channel is already within [0, 255]
+		const uint8_t* tempRaw = readTemperature ? plyThermals->buffer.get() : nullptr;
+		const tinyply::Type tempType = readTemperature ? plyThermals->t : tinyply::Type::INVALID;
+		const auto getTemperature = [&](size_t index) -> float
+		{
+			switch (tempType)
 			{
-				tempRaw = colorsRaw;
+			case tinyply::Type::INT8:		return float(reinterpret_cast<const int8_t*>(tempRaw)[index]);
+			case tinyply::Type::UINT8:		return float(tempRaw[index]);
+			case tinyply::Type::INT16:		return float(reinterpret_cast<const int16_t*>(tempRaw)[index]);
+			case tinyply::Type::UINT16:		return float(reinterpret_cast<const uint16_t*>(tempRaw)[index]);
+			case tinyply::Type::INT32:		return float(reinterpret_cast<const int32_t*>(tempRaw)[index]);
+			case tinyply::Type::UINT32:		return float(reinterpret_cast<const uint32_t*>(tempRaw)[index]);
+			case tinyply::Type::FLOAT32:	return reinterpret_cast<const float*>(tempRaw)[index];
+			case tinyply::Type::FLOAT64:	return float(reinterpret_cast<const double*>(tempRaw)[index]);
+			default:						return colorsRaw ? colorsRaw[index * 3] / 255.0f : .0f;
 			}
+		};
 
-			for (unsigned ind = 0; ind < numPoints; ++ind)
-			{
-				baseIndex = ind * 3;
+		for (size_t ind = 0; ind < numPoints; ++ind)
+		{
+			const size_t baseIndex = ind * 3;
+			if ((ind & 0xFFFF) == 0xFFFF) progress->checkpoint();
 
-				_points[ind] = vec4(pointsRaw[baseIndex], pointsRaw[baseIndex + 2], pointsRaw[baseIndex + 1], 1.0f);
-				_rgb[ind] = vec3(colorsRaw[baseIndex] / 255.0f, colorsRaw[baseIndex + 1] / 255.0f, colorsRaw[baseIndex + 2] / 255.0f);
-				_thermal[ind] = float(tempRaw[baseIndex] / 255.0f);
-				_aabb.update(vec3(_points[ind]));
-			}
+			points[ind] = vec4(vec3(glm::dvec3(getCoordinate(baseIndex), getCoordinate(baseIndex + 2), getCoordinate(baseIndex + 1)) - origin), 1.0f);
+			rgb[ind] = colorsRaw ? vec3(colorsRaw[baseIndex] / 255.0f, colorsRaw[baseIndex + 1] / 255.0f, colorsRaw[baseIndex + 2] / 255.0f) : vec3(.0f);
 
-			delete[] pointsRaw;
-			delete[] colorsRaw;
-			if (hasTemperature) delete[] tempRaw;
+			thermal[ind] = getTemperature(ind);
+
+			aabb.update(vec3(points[ind]));
 		}
 	}
+	catch (const TaskCancelled&)
+	{
+		throw;
+	}
 	catch (const std::exception& e)
 	{
 		std::cerr << "Caught tinyply exception: " << e.what() << std::endl;
@@ -161,6 +709,38 @@ bool PointCloud::loadModelFromPLY(const mat4& modelMatrix)
 	return true;
 }
 
+bool PointCloud::matchWildcard(const std::string& name, const std::string& pattern)
+{
+	// Greedy matching which backtracks to the last star, so each character is visited a bounded number of times per star
+	size_t nameIdx = 0, patternIdx = 0, starIdx = std::string::npos, starNameIdx = 0;
+
+	while (nameIdx < name.size())
+	{
+		if (patternIdx < pattern.size() && (pattern[patternIdx] == '?' || pattern[patternIdx] == name[nameIdx]))
+		{
+			++nameIdx; ++patternIdx;
+		}
+		else if (patternIdx < pattern.size() && pattern[patternIdx] == '*')
+		{
+			starIdx = patternIdx++;
+			starNameIdx = nameIdx;
+		}
+		else if (starIdx != std::string::npos)
+		{
+			patternIdx = starIdx + 1;
+			nameIdx = ++starNameIdx;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	while (patternIdx < pattern.size() && pattern[patternIdx] == '*') ++patternIdx;
+
+	return patternIdx == pattern.size();
+}
+
 bool PointCloud::readBinary(const std::string& filename, const std::vector<Model3D::ModelComponent*>& modelComp)
 {
 	std::ifstream fin(filename, std::ios::in | std::ios::binary);
@@ -169,16 +749,27 @@ bool PointCloud::readBinary(const std::string& filename, const std::vector<Model
 		return false;
 	}
 
-	size_t numPoints;
+	if (!_points.read(fin))
+	{
+		return false;
+	}
 
-	fin.read((char*)&numPoints, sizeof(size_t));
-	_points.resize(numPoints); _rgb.resize(numPoints); _thermal.resize(numPoints);
-	fin.read((char*)&_points[0], numPoints * sizeof(vec4));
-	fin.read((char*)&_rgb[0], numPoints * sizeof(vec3));
-	fin.read((char*)&_thermal[0], numPoints * sizeof(float));
 	fin.read((char*)&_aabb, sizeof(AABB));
+	fin.read((char*)&_offset, sizeof(glm::dvec3));
 
-	fin.close();
+	// Binaries written before offsets or filters were kept end after the bounding box
+	float duplicateTolerance, outlierStdFactor;
+	unsigned outlierNeighbors;
+
+	fin.read((char*)&duplicateTolerance, sizeof(float));
+	fin.read((char*)&outlierNeighbors, sizeof(unsigned));
+	fin.read((char*)&outlierStdFactor, sizeof(float));
+
+	if (!fin || duplicateTolerance != _duplicateTolerance || outlierNeighbors != _outlierNeighbors || (_outlierNeighbors && outlierStdFactor != _outlierStdFactor))
+	{
+		_points.clear();
+		return false;
+	}
 
 	return true;
 }
@@ -188,16 +779,42 @@ void PointCloud::setVAOData()
 	VAO* vao = new VAO(false);
 	ModelComponent* modelComp = _modelComp[0];
 
+	// The preview stands for the whole cloud on the GPU, whereas the analysis keeps reading _points
+	const PackedPoints& rendered = _preview.size() ? _preview : _points;
+
 	// Refresh point cloud length
-	modelComp->_pointCloud.resize(_points.size());
+	modelComp->_pointCloud.resize(rendered.size());
 	std::iota(modelComp->_pointCloud.begin(), modelComp->_pointCloud.end(), 0);
 	modelComp->_topologyIndicesLength[RendEnum::IBO_POINT_CLOUD] = unsigned(modelComp->_pointCloud.size());
 
+	// Buffers keep the expanded layout expected by shaders, hence packed points are expanded chunk by chunk while they are uploaded
+	const size_t numPoints = rendered.size(), chunkSize = std::min(numPoints, size_t(UPLOAD_CHUNK_SIZE));
+	std::vector<vec4> chunkPoints(chunkSize);
+	std::vector<vec3> chunkColors(chunkSize);
+
 	vao->defineVBO(RendEnum::VBO_COLOR_01, vec3(.0f), GL_FLOAT);
-	vao->setVBOData(RendEnum::VBO_POSITION, _points, GL_STATIC_DRAW);
-	vao->setVBOData(RendEnum::VBO_COLOR_01, _rgb, GL_STATIC_DRAW);
+	vao->setVBOData(RendEnum::VBO_POSITION, static_cast<vec4*>(nullptr), GLuint(numPoints), GL_STATIC_DRAW);
+	vao->setVBOData(RendEnum::VBO_COLOR_01, static_cast<vec3*>(nullptr), GLuint(numPoints), GL_STATIC_DRAW);
+
+	for (size_t firstPoint = 0; firstPoint < numPoints; firstPoint += chunkSize)
+	{
+		const size_t numChunkPoints = std::min(numPoints - firstPoint, chunkSize), numBlocks = (numChunkPoints + PackedPoints::BLOCK_SIZE - 1) / PackedPoints::BLOCK_SIZE;
+
+		ThreadPool::getInstance()->parallelFor(numBlocks, [&](size_t blockIdx)
+		{
+			const size_t blockOffset = blockIdx * PackedPoints::BLOCK_SIZE;
+			rendered.decode(firstPoint + blockOffset, std::min(numChunkPoints, blockOffset + PackedPoints::BLOCK_SIZE) - blockOffset, &chunkPoints[blockOffset], &chunkColors[blockOffset], nullptr);
+		});
+
+		vao->setVBOSubData(RendEnum::VBO_POSITION, chunkPoints.data(), GLuint(firstPoint), GLuint(numChunkPoints));
+		vao->setVBOSubData(RendEnum::VBO_COLOR_01, chunkColors.data(), GLuint(firstPoint), GLuint(numChunkPoints));
+	}
+
 	vao->setIBOData(RendEnum::IBO_POINT_CLOUD, modelComp->_pointCloud);
 
+	// Indices are only needed by the GPU, whereas their length is kept for drawing
+	std::vector<GLuint>().swap(modelComp->_pointCloud);
+
 	modelComp->_vao = vao;
 }
 
@@ -209,12 +826,12 @@ bool PointCloud::writeToBinary(const std::string& filename)
 		return false;
 	}
 
-	const size_t numPoints = _points.size();
-	fout.write((char*)&numPoints, sizeof(size_t));
-	fout.write((char*)&_points[0], numPoints * sizeof(vec4));
-	fout.write((char*)&_rgb[0], numPoints * sizeof(vec3));
-	fout.write((char*)&_thermal[0], numPoints * sizeof(float));
+	_points.write(fout);
 	fout.write((char*)&_aabb, sizeof(AABB));
+	fout.write((char*)&_offset, sizeof(glm::dvec3));
+	fout.write((char*)&_duplicateTolerance, sizeof(float));
+	fout.write((char*)&_outlierNeighbors, sizeof(unsigned));
+	fout.write((char*)&_outlierStdFactor, sizeof(float));
 
 	fout.close();
 
@@ -6,42 +6,139 @@
 *	@date 18/10/2021
 */
 
+#include "DataStructures/KdTree.h"
+#include "DataStructures/PackedPoints.h"
+#include "DataStructures/PointDecimation.h"
 #include "Graphics/Core/Model3D.h"
+#include "Utilities/TaskProgress.h"
 
 /**
-*	@brief Point cloud wrapper for PLY files and its binaries.
+*	@brief Point cloud wrapper for PLY and LAS files and its binaries. A cloud may be merged from several files, given as a list, a folder or a wildcard pattern.
 */
 class PointCloud: public Model3D
 {
+public:
+	/**
+	*	@brief Receives the points of a cloud while it is being loaded, e.g., to render them before the whole cloud is read. Methods are called
+	*	from the loading threads, and append may be called from several of them at once.
+	*/
+	class LoadListener
+	{
+	public:
+		/**
+		*	@brief Destructor.
+		*/
+		virtual ~LoadListener() {}
+
+		/**
+		*	@brief Announces the number of points of the cloud, before any range of them is appended.
+		*/
+		virtual void reserve(size_t numPoints) = 0;
+
+		/**
+		*	@brief Hands over a range of decoded points, which are copied if needed. Colours are provisional, as they may be normalized once every point is read.
+		*	@param origin Georeferenced position, as (x, z, y), which positions are relative to.
+		*/
+		virtual void append(size_t firstPoint, size_t numPoints, const vec4* points, const vec3* rgb, const glm::dvec3& origin) = 0;
+
+		/**
+		*	@brief Every point is packed, and so the points, bounding box and offset are final. The preview and binary copy are built afterwards,
+		*	but they only read the points.
+		*/
+		virtual void pointsReady() = 0;
+	};
+
 protected:
+	const static unsigned		ANOMALY_BLOCK_SIZE;					//!< Number of points whose neighbourhood is evaluated by a single task
+	const static unsigned		LAS_BLOCK_SIZE;						//!< Number of LAS records decoded by a single task
+	const static float			MAD_TO_STD;							//!< Scale of the median absolute deviation to estimate a standard deviation
+	const static float			MIN_TEMPERATURE_SPREAD;				//!< Lower bound of the neighbourhood deviation, so that uniform surroundings do not yield infinite scores
+	const static unsigned		UPLOAD_CHUNK_SIZE;					//!< Points expanded and uploaded to the GPU at once
 	const static std::string	WRITE_POINT_CLOUD_FOLDER;			//!<
 
 protected:
-	std::string			_filename;									//!<
+	std::string			_filename;									//!< Path of the cloud without extension, a folder or a wildcard pattern
+	std::vector<std::string> _inputFiles;							//!< Explicit list of files to be merged, if any
 	bool				_useBinary;									//!<
 
+	// Cleaning of loaded files
+	float				_duplicateTolerance;						//!< Maximum distance between removed duplicates, negative to keep them
+	unsigned			_outlierNeighbors;							//!< Neighbours whose mean distance flags outliers, zero to keep them
+	float				_outlierStdFactor;							//!< Deviations above the mean neighbour distance beyond which points are outliers
+
 	// Spatial information
 	AABB				_aabb;										//!<
-	vec3				_offset;									//!<
-	std::vector<vec4>	_points;									//!<
-	std::vector<vec3>	_rgb;										//!<
-	std::vector<float>	_thermal;									//!<
+	glm::dvec3			_offset;									//!< Georeferenced position of the local origin, as (x, z, y), so that points are stored as small floats
+	PackedPoints		_points;									//!< Quantized positions, colours and temperatures
+	PackedPoints		_preview;									//!< Decimated points which are rendered instead of _points, empty if every point is rendered
+	size_t				_previewBudget;								//!< Maximum number of rendered points, zero to render every point
+	PointDecimation::CellPoint _previewCellPoint;					//!< Point kept by each voxel of the preview
+	bool				_previewBlueNoise;							//!< Preview voxels are thinned into a Poisson-disk set
+	std::vector<float>	_anomalyScore;								//!< Signed deviation of each temperature from its neighbourhood, in deviation units
+	std::vector<uint8_t> _anomalyFlag;								//!< LOCAL_PEAK_NONE, LOCAL_PEAK_MIN or LOCAL_PEAK_MAX per point
+	KdTree*				_kdTree;									//!< Spatial index over _points, built on demand
+	uint64_t			_contentHash;								//!< Hash of points and temperatures, zero until it is requested
 
 protected:
+	/**
+	*	@brief Decimates the cloud into the preview if it exceeds the budget of rendered points, whereas the analysis keeps every point.
+	*/
+	void buildPreview(TaskProgress* progress);
+
 	/**
 	*	@brief Computes a triangle mesh buffer composed only by indices.
 	*/
 	void computeCloudData();
 
+	/**
+	*	@brief Removes duplicates and then statistical outliers from points read from LAS or PLY files, so that neither of them reaches the grids.
+	*	The bounding box is shrunk to the kept points.
+	*/
+	void filterPoints(TaskProgress* progress);
+
+	/**
+	*	@return Path of the binary copy of the cloud.
+	*/
+	std::string getBinaryFilename() const;
+
+	/**
+	*	@return Files to be loaded with the given extension: those of the explicit list, or else the file named after the cloud, or else every such file
+	*	in the folder or matching the wildcard pattern named after it, sorted by name.
+	*/
+	std::vector<std::string> getInputFiles(const std::string& extension) const;
+
 	/**
 	*	@brief Fills the content of model component with binary file data.
 	*/
 	bool loadModelFromBinaryFile();
 
 	/**
-	*	@brief Generates geometry via GPU.
+	*	@brief Decodes one or several LAS files in parallel. Temperatures are normalized to [0, 1] over all files, as in PLY clouds.
+	*	The offset is the lower corner of the header bounds of every file, rounded down to whole units.
+	*	@return False if there is no readable LAS file.
+	*/
+	bool loadModelFromLAS(TaskProgress* progress, LoadListener* listener);
+
+	/**
+	*	@brief Reads one or several PLY files concurrently. Headers are scanned first, so that the cloud is allocated once and each file fills its own slice.
+	*	PLY headers carry no bounds, hence each file is read relative to its own origin and then moved to the lowest origin, which becomes the offset.
+	*	@return False if there is no PLY file or any of them cannot be read.
 	*/
-	bool loadModelFromPLY(const mat4& modelMatrix);
+	bool loadModelFromPLY(const mat4& modelMatrix, TaskProgress* progress, LoadListener* listener);
+
+	/**
+	*	@return True if the name matches a pattern with '*' and '?' wildcards.
+	*/
+	static bool matchWildcard(const std::string& name, const std::string& pattern);
+
+	/**
+	*	@brief Reads a single PLY file into the given slices of the full-precision arrays, which are packed once every file is read.
+	*	Coordinates may be stored as float or double, and are made relative to the file origin in double precision.
+	*	@param readTemperature Temperatures are read from the temperature attribute, of any type and not yet normalized, instead of the red channel.
+	*	@param origin Lower corner of the file points rounded down to whole units, as (x, z, y).
+	*	@param aabb Bounding box of the file points, relative to its origin.
+	*/
+	bool readPLY(const std::string& filename, size_t numPoints, vec4* points, vec3* rgb, float* thermal, bool readTemperature, glm::dvec3& origin, AABB& aabb, TaskProgress* progress);
 
 	/**
 	*	@brief Loads the PLY point cloud from a binary file, if possible.
@@ -49,7 +146,7 @@ protected:
 	virtual bool readBinary(const std::string& filename, const std::vector<Model3D::ModelComponent*>& modelComp);
 
 	/**
-	*	@brief Communicates the model structure to GPU for rendering purposes.
+	*	@brief Communicates the model structure to GPU for rendering purposes. Only the preview is uploaded if there is one.
 	*/
 	virtual void setVAOData();
 
@@ -65,23 +162,63 @@ public:
 	*/
 	PointCloud(const std::string& filename, const bool useBinary, const mat4& modelMatrix = mat4(1.0f));
 
+	/**
+	*	@brief Cloud merged from several files.
+	*	@param name Path without extension of the binary copy.
+	*/
+	PointCloud(const std::vector<std::string>& filenames, const std::string& name, const bool useBinary, const mat4& modelMatrix = mat4(1.0f));
+
 	/**
 	*	@brief
 	*/
 	virtual ~PointCloud();
 
 	/**
-	*	@brief Loads the point cloud, either from a binary or a PLY file.
+	*	@brief Loads the point cloud, either from a binary, LAS or PLY file.
 	*	@param modelMatrix Model transformation matrix.
 	*	@return True if the point cloud could be properly loaded.
 	*/
 	virtual bool load(const mat4& modelMatrix = mat4(1.0f));
 
+	/**
+	*	@brief Loads the point cloud reporting progress through the given channel. A cancelled load leaves the cloud empty.
+	*	@param listener Receives the points while they are read, if any. Loading may then run on a worker thread, as GPU buffers are left to
+	*	uploadRenderedPoints.
+	*	@return True if the point cloud could be properly loaded.
+	*/
+	bool load(const mat4& modelMatrix, TaskProgress* progress, LoadListener* listener = nullptr);
+
 	/**
 	*	@brief Updates the current Axis-Aligned Bounding-Box.
 	*/
 	void updateBoundaries(const vec3& xyz) { _aabb.update(xyz); }
 
+	/**
+	*	@brief Compares the temperature of each point against its neighbourhood and flags those beyond stdFactor deviations.
+	*	@param robust Median and MAD are used instead of mean and standard deviation.
+	*	@param numNeighbors Number of nearest points used when the radius is zero or finds fewer points.
+	*	@param radius Search radius; a neighbourhood grows to the numNeighbors nearest points where the cloud is sparser.
+	*	@param progress Optional progress channel, checked for cancellation after every block of points.
+	*	@return Number of flagged points.
+	*/
+	size_t locateAnomalies(bool robust, unsigned numNeighbors, float radius, float stdFactor, TaskProgress* progress = nullptr);
+
+	/**
+	*	@brief Uploads points into their slots of the buffers allocated by reserveRenderedPoints, which are drawn from now on in the order they arrive.
+	*	Must be called from the OpenGL thread.
+	*/
+	void appendRenderedPoints(size_t firstPoint, size_t numPoints, const vec4* points, const vec3* rgb);
+
+	/**
+	*	@brief Allocates GPU buffers for the given number of points, which are drawn as they are appended. Must be called from the OpenGL thread.
+	*/
+	void reserveRenderedPoints(size_t numPoints);
+
+	/**
+	*	@brief Replaces the GPU buffers with the preview, or every point if there is none. Must be called from the OpenGL thread.
+	*/
+	void uploadRenderedPoints();
+
 	// Getters
 
 	/**
@@ -89,31 +226,71 @@ public:
 	*/
 	AABB getAABB() { return _aabb; }
 
+	/**
+	*	@return Hash of the offset and the packed point positions and temperatures, computed the first time it is requested.
+	*/
+	uint64_t getContentHash();
+
 	/**
 	*	@return Path where the point cloud is saved.
 	*/
 	std::string getFilename() { return _filename; }
 
+	/**
+	*	@return Spatial index over the points, which is built the first time it is requested.
+	*/
+	KdTree* getKdTree();
+
+	/**
+	*	@return Georeferenced position of the local origin, as (x, z, y).
+	*/
+	glm::dvec3 getOffset() const { return _offset; }
+
 	/**
 	*	@brief
 	*/
 	unsigned getNumberOfPoints() { return unsigned(_points.size()); }
 
 	/**
-	*	@return
+	*	@return Number of points uploaded for rendering, i.e., those of the preview if there is one.
 	*/
-	std::vector<vec4>* getPoints() { return &_points; }
+	unsigned getNumberOfRenderedPoints() { return unsigned(_preview.size() ? _preview.size() : _points.size()); }
 
 	/**
-	*	@return Temperature values of each point.
+	*	@return Packed positions, colours and temperatures of the points.
 	*/
-	std::vector<float>* getTemperature() { return &_thermal; }
+	PackedPoints* getPoints() { return &_points; }
+
+	/**
+	*	@return Anomaly score of each point, empty until locateAnomalies is called.
+	*/
+	std::vector<float>* getAnomalyScore() { return &_anomalyScore; }
+
+	/**
+	*	@return Anomaly flag of each point, empty until locateAnomalies is called.
+	*/
+	std::vector<uint8_t>* getAnomalyFlag() { return &_anomalyFlag; }
 
 	/// Setters
 
 	/**
-	*	@brief Sets the offset which translates our local system to UTM.
+	*	@brief Sets the cleaning of points read from LAS or PLY files, which must be set before the cloud is loaded. Binaries written with other
+	*	settings are rejected, and then replaced once the source files are read.
+	*	@param duplicateTolerance Maximum distance between removed duplicates, zero for exact duplicates only and negative to keep them.
+	*	@param outlierNeighbors Neighbours whose mean distance flags outliers, zero to keep them.
+	*	@param outlierStdFactor Deviations above the mean neighbour distance of the cloud beyond which points are outliers.
+	*/
+	void setFilter(float duplicateTolerance, unsigned outlierNeighbors, float outlierStdFactor) { _duplicateTolerance = duplicateTolerance; _outlierNeighbors = outlierNeighbors; _outlierStdFactor = outlierStdFactor; }
+
+	/**
+	*	@brief Sets the offset which translates our local system to UTM, as (x, z, y). Loading a cloud replaces it with that of its files.
+	*/
+	void setOffset(const glm::dvec3& offset) { _offset = offset; _contentHash = 0; }
+
+	/**
+	*	@brief Sets the budget of rendered points, zero to render every point. Loaded clouds are decimated and uploaded again, hence it must be called
+	*	from the rendering thread.
 	*/
-	void setOffset(const vec3& offset) { _offset = offset; }
+	void setPreview(size_t budget, PointDecimation::CellPoint cellPoint, bool blueNoise);
 };
 
@@ -78,6 +78,24 @@ void VAO::setIBOData(const RendEnum::IBOTypes iboType, const std::vector<GLuint>
 	}
 }
 
+void VAO::setIBOData(const RendEnum::IBOTypes iboType, const GLuint* topologyData, const GLuint size, const GLuint changeFrequency)
+{
+	glBindVertexArray(_vao);
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo[iboType]);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(size) * sizeof(GLuint), topologyData, changeFrequency);
+	}
+}
+
+void VAO::setIBOSubData(const RendEnum::IBOTypes iboType, const GLuint* topologyData, const GLuint offset, const GLuint size)
+{
+	glBindVertexArray(_vao);
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo[iboType]);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, GLintptr(offset) * sizeof(GLuint), GLsizeiptr(size) * sizeof(GLuint), topologyData);
+	}
+}
+
 /// [Protected methods]
 
 void VAO::defineSimpleVBO(const RendEnum::VBOTypes vboType, const GLsizei dataSize, const GLuint unitType, const GLuint shaderSlot)
@@ -122,6 +122,13 @@ public:
 	template<typename T>
 	void setVBOData(const RendEnum::VBOTypes vboType, T* geometryData, const GLuint size, const GLuint changeFrequency = GL_STATIC_DRAW);
 
+	/**
+	*	@brief Overwrites part of a VBO which was already allocated, e.g., with setVBOData and a null pointer.
+	*	@param offset First element to be overwritten.
+	*/
+	template<typename T>
+	void setVBOSubData(const RendEnum::VBOTypes vboType, const T* geometryData, const GLuint offset, const GLuint size);
+
 	/**
 	*	@brief Sets the VertexGPUData in VBO.
 	*/
@@ -133,6 +140,18 @@ public:
 	*	@param geometryData Data to be put on the ibo space.
 	*/
 	void setIBOData(const RendEnum::IBOTypes iboType, const std::vector<GLuint>& topologyData, const GLuint changeFrequency = GL_STATIC_DRAW);
+
+	/**
+	*	@brief Sets indices in IBO from a raw array, which may be null to allocate the IBO and fill it later with setIBOSubData.
+	*	@param size Number of indices.
+	*/
+	void setIBOData(const RendEnum::IBOTypes iboType, const GLuint* topologyData, const GLuint size, const GLuint changeFrequency = GL_STATIC_DRAW);
+
+	/**
+	*	@brief Overwrites part of an IBO which was already allocated.
+	*	@param offset First index to be overwritten.
+	*/
+	void setIBOSubData(const RendEnum::IBOTypes iboType, const GLuint* topologyData, const GLuint offset, const GLuint size);
 };
 
 template<typename T>
@@ -198,3 +217,14 @@ void VAO::setVBOData(const RendEnum::VBOTypes vboType, T* geometryData, const GL
 		glBufferData(GL_ARRAY_BUFFER, size * sizeof(T), geometryData, changeFrequency);
 	}
 }
+
+template<typename T>
+void VAO::setVBOSubData(const RendEnum::VBOTypes vboType, const T* geometryData, const GLuint offset, const GLuint size)
+{
+	glBindVertexArray(_vao);
+
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, _vbo[vboType]);
+		glBufferSubData(GL_ARRAY_BUFFER, GLintptr(offset) * sizeof(T), GLsizeiptr(size) * sizeof(T), geometryData);
+	}
+}
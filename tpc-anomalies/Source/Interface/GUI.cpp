@@ -108,21 +108,122 @@ void GUI::showGridSettings()
 			_scene->rebuildGrid(_renderingParams->_gridSubdivisions);
 		}
 
+		if (_scene->isGridBuilding())
+		{
+			ImGui::SameLine(0, 20);
+			if (ImGui::Button("Cancel")) _scene->cancelGridBuild();
+
+			if (std::shared_ptr<TaskProgress> progress = _scene->getGridProgress())
+			{
+				const TaskProgress::Snapshot snapshot = progress->getSnapshot();
+				const std::string overlay = snapshot._stage + " (" + TaskProgress::formatRate(snapshot.getRate(), snapshot._unit) + ")";
+
+				ImGui::ProgressBar(snapshot.getFraction(), ImVec2(-1.0f, .0f), overlay.c_str());
+			}
+		}
+
 		this->leaveSpace(2); ImGui::Text("Algorithm Settings"); ImGui::Separator(); this->leaveSpace(2);	
+		ImGui::Checkbox("Auto Resolution", &_renderingParams->_autoGridResolution);
+
+		if (_renderingParams->_autoGridResolution)
+		{
+			ImGui::SameLine(0, 20);
+			ImGui::SliderFloat("Points per Voxel", &_renderingParams->_targetPointsPerVoxel, 1.0f, 256.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+
+			if (_scene->canEstimateGridResolution(_renderingParams->_orientedGrid))
+			{
+				const GridResolution::Estimate& estimate = _scene->estimateGridResolution(_renderingParams->_targetPointsPerVoxel, _renderingParams->_orientedGrid);
+				_renderingParams->_gridSubdivisions = ivec3(estimate._subdivisions);
+
+				ImGui::Text("Point spacing: %.4f, cell size: %.4f", estimate._pointSpacing, estimate._cellSize);
+				ImGui::Text("Predicted: %zu occupied voxels, %.1f MB, %.1f s", estimate._occupiedVoxels, estimate._memoryBytes / (1024.0f * 1024.0f), estimate._seconds);
+			}
+			else
+			{
+				ImGui::Text("The resolution is estimated once the point cloud and its orientation are ready");
+			}
+		}
+
 		ImGui::SliderInt3("Grid Subdivisions", &_renderingParams->_gridSubdivisions[0], 1, 500); ImGui::SameLine(0, 20);
-		ImGui::Checkbox("Fill columns", &_renderingParams->_fillUnderVoxels);
+		ImGui::Checkbox("Fill columns", &_renderingParams->_fillUnderVoxels); ImGui::SameLine(0, 20);
+		ImGui::Checkbox("Oriented Grid", &_renderingParams->_orientedGrid);
 
 		this->leaveSpace(3); ImGui::Text("Thermal Anomalies"); ImGui::Separator(); this->leaveSpace(2);
+		const char* detectorTitles[] = { "Mean / deviation", "Median / MAD" };
+		ImGui::Combo("Detector", &_renderingParams->_anomalyDetector, detectorTitles, IM_ARRAYSIZE(detectorTitles));
 		ImGui::SliderInt("Grid Neighbors", &_renderingParams->_gridNeighbors, 3, 50);
 		ImGui::SliderFloat("Std Factor", &_renderingParams->_stdFactor, 1.0f, 20.0f);
+		ImGui::Checkbox("Point Anomalies", &_renderingParams->_locatePointAnomalies);
+		ImGui::SliderInt("Point Neighbors", &_renderingParams->_pointNeighbors, 4, 128);
+		ImGui::SliderFloat("Point Radius", &_renderingParams->_pointRadius, .0f, 2.0f);
+		ImGui::SliderFloat("Point Std Factor", &_renderingParams->_pointStdFactor, 1.0f, 20.0f);
+
+		this->leaveSpace(3); ImGui::Text("Hotspots"); ImGui::Separator(); this->leaveSpace(2);
+		const char* connectivityTitles[] = { "6 (faces)", "18 (edges)", "26 (vertices)" };
+		const int connectivityValues[] = { HotspotLabeling::FACES, HotspotLabeling::EDGES, HotspotLabeling::VERTICES };
+		int connectivityIdx = int(std::find(connectivityValues, connectivityValues + 3, _renderingParams->_hotspotConnectivity) - connectivityValues) % 3;
+		if (ImGui::Combo("Connectivity", &connectivityIdx, connectivityTitles, IM_ARRAYSIZE(connectivityTitles))) _renderingParams->_hotspotConnectivity = connectivityValues[connectivityIdx];
+		ImGui::SliderInt("Min. Voxels", &_renderingParams->_hotspotMinVoxels, 1, 500);
+		this->showHotspots();
 
 		this->leaveSpace(3); ImGui::Text("Execution Settings"); ImGui::Separator(); this->leaveSpace(2);
-		ImGui::Checkbox("Use GPU", &_renderingParams->_launchGridGPU); ImGui::SameLine(0, 20);
+		ImGui::Checkbox("Grid Cache", &_renderingParams->_useGridCache); ImGui::SameLine(0, 20);
+		ImGui::Checkbox("Quantize Temperatures", &_renderingParams->_quantizeGridThermal);
+
+		this->leaveSpace(3); ImGui::Text("Live Ingestion"); ImGui::Separator(); this->leaveSpace(2);
+		const char* sourceTitles[] = { "Standard input", "Named pipe", "TCP (localhost)" };
+		ImGui::Combo("Source", &_renderingParams->_liveSource, sourceTitles, IM_ARRAYSIZE(sourceTitles));
+		if (_renderingParams->_liveSource == InputChannel::NAMED_PIPE) ImGui::InputText("Pipe", _renderingParams->_livePipeBuffer, IM_ARRAYSIZE(_renderingParams->_livePipeBuffer));
+		if (_renderingParams->_liveSource == InputChannel::TCP_SOCKET && ImGui::InputInt("Port", &_renderingParams->_livePort)) _renderingParams->_livePort = glm::clamp(_renderingParams->_livePort, 1, 65535);
+		ImGui::SliderInt("Refresh (ms)", &_renderingParams->_liveRefreshMilliseconds, 100, 10000, "%d", ImGuiSliderFlags_Logarithmic);
+
+		if (const LiveIngestion* ingestion = _scene->getLiveIngestion())
+		{
+			if (ImGui::Button("Stop Ingestion")) _scene->stopIngestion();
+
+			ImGui::Text("%zu points in %zu batches, %zu outside the grid, %zu refreshes", ingestion->getNumberOfPoints(), ingestion->getNumberOfBatches(), ingestion->getNumberOfDiscardedPoints(), ingestion->getNumberOfPublishedGrids());
+		}
+		else if (ImGui::Button("Start Ingestion") && !_scene->startIngestion(*_renderingParams))
+		{
+			std::cerr << "Live ingestion could not be started" << std::endl;
+		}
 	}
 
 	ImGui::End();
 }
 
+void GUI::showHotspots()
+{
+	const unsigned MAX_ROWS = 20;
+	const std::vector<HotspotLabeling::Hotspot>& hotspots = _scene->getHotspots();
+
+	ImGui::Text("%d hotspots found", int(hotspots.size()));
+	ImGui::Columns(6, "HotspotColumns");
+	ImGui::Separator();
+	ImGui::Text("Type"); ImGui::NextColumn();
+	ImGui::Text("Voxels"); ImGui::NextColumn();
+	ImGui::Text("Points"); ImGui::NextColumn();
+	ImGui::Text("Peak"); ImGui::NextColumn();
+	ImGui::Text("Mean"); ImGui::NextColumn();
+	ImGui::Text("Centroid"); ImGui::NextColumn();
+	ImGui::Separator();
+
+	for (unsigned hotspotIdx = 0; hotspotIdx < std::min(MAX_ROWS, unsigned(hotspots.size())); ++hotspotIdx)
+	{
+		const HotspotLabeling::Hotspot& hotspot = hotspots[hotspotIdx];
+
+		ImGui::Text(hotspot._peakType == LOCAL_PEAK_MAX ? "Hot" : "Cold"); ImGui::NextColumn();
+		ImGui::Text("%u", hotspot._numVoxels); ImGui::NextColumn();
+		ImGui::Text("%u", hotspot._numPoints); ImGui::NextColumn();
+		ImGui::Text("%.3f", hotspot._peakTemperature); ImGui::NextColumn();
+		ImGui::Text("%.3f", hotspot._meanTemperature); ImGui::NextColumn();
+		ImGui::Text("(%.2f, %.2f, %.2f)", hotspot._centroid.x, hotspot._centroid.y, hotspot._centroid.z); ImGui::NextColumn();
+	}
+
+	ImGui::Columns(1);
+	ImGui::Separator();
+}
+
 void GUI::showRenderingSettings()
 {
 	if (ImGui::Begin("Rendering Settings", &_showRenderingSettings))
@@ -169,6 +270,23 @@ void GUI::showRenderingSettings()
 
 				ImGui::SliderFloat("Point Size", &_renderingParams->_scenePointSize, 0.1f, 50.0f);
 
+				this->leaveSpace(2); ImGui::Text("Preview"); ImGui::Separator(); this->leaveSpace(1);
+				const char* cellPointTitles[] = { "Nearest to voxel centre", "Voxel average" };
+				ImGui::SliderInt("Point Budget", &_renderingParams->_previewBudget, 0, 100000000, "%d", ImGuiSliderFlags_Logarithmic);
+				ImGui::Combo("Voxel Point", &_renderingParams->_previewCellPoint, cellPointTitles, IM_ARRAYSIZE(cellPointTitles));
+				ImGui::Checkbox("Blue Noise", &_renderingParams->_previewBlueNoise); ImGui::SameLine(0, 20);
+				if (ImGui::Button("Apply")) _scene->updatePreview(*_renderingParams);
+
+				if (std::shared_ptr<TaskProgress> progress = _scene->getCloudProgress())
+				{
+					const TaskProgress::Snapshot snapshot = progress->getSnapshot();
+					const std::string overlay = snapshot._stage + " (" + TaskProgress::formatRate(snapshot.getRate(), snapshot._unit) + ")";
+
+					ImGui::ProgressBar(snapshot.getFraction(), ImVec2(-1.0f, .0f), overlay.c_str());
+				}
+				else if (PointCloud* pointCloud = _scene->getPointCloud())
+					ImGui::Text("Rendering %u of %u points", pointCloud->getNumberOfRenderedPoints(), pointCloud->getNumberOfPoints());
+
 				ImGui::EndTabItem();
 			}
 
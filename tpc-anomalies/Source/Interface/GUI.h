@@ -80,6 +80,11 @@ protected:
 	*/
 	void showGridSettings();
 
+	/**
+	*	@brief Shows the largest hotspots found in the last grid rebuild.
+	*/
+	void showHotspots();
+
 	/**
 	*	@brief Shows a window with general rendering configuration.
 	*/
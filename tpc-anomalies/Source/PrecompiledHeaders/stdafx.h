@@ -17,17 +17,21 @@
 // [Standard libraries: basic]
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <chrono>
 #include <climits>
+#include <condition_variable>
 #include <cstdint>
 #include <exception>
 #include <execution>
 #include <fstream>
 #include <functional>
+#include <iomanip>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <random>
 #include <sstream>
@@ -39,6 +43,7 @@
 // [Standard libraries: data structures]
 
 #include <map>
+#include <queue>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
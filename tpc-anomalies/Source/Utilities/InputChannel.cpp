@@ -0,0 +1,244 @@
+#include "stdafx.h"
+#include "InputChannel.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#define CLOSED_SOCKET uintptr_t(INVALID_SOCKET)
+#else
+#define CLOSED_SOCKET -1
+#endif
+
+/// [Public methods]
+
+InputChannel::InputChannel() :
+	_ended(false), _session(0), _source(STANDARD_INPUT), _open(false),
+#ifdef _WIN32
+	_handle(INVALID_HANDLE_VALUE),
+#else
+	_fileDescriptor(-1),
+#endif
+	_clientSocket(CLOSED_SOCKET), _listenSocket(CLOSED_SOCKET)
+{
+}
+
+InputChannel::~InputChannel()
+{
+	this->close();
+}
+
+void InputChannel::close()
+{
+#ifdef _WIN32
+	if (_source == NAMED_PIPE && _handle != INVALID_HANDLE_VALUE) CloseHandle(_handle);
+	if (_clientSocket != CLOSED_SOCKET) closesocket(SOCKET(_clientSocket));
+	if (_listenSocket != CLOSED_SOCKET) closesocket(SOCKET(_listenSocket));
+	if (_open && _source == TCP_SOCKET) WSACleanup();
+
+	_handle = INVALID_HANDLE_VALUE;
+#else
+	if (_source == NAMED_PIPE && _fileDescriptor >= 0) ::close(_fileDescriptor);
+	if (_clientSocket >= 0) ::close(_clientSocket);
+	if (_listenSocket >= 0) ::close(_listenSocket);
+
+	_fileDescriptor = -1;
+#endif
+
+	_clientSocket = _listenSocket = CLOSED_SOCKET;
+	_ended = _open = false;
+}
+
+bool InputChannel::open(Source source, const std::string& pipeName, uint16_t port)
+{
+	this->close();
+
+	_source = source;
+	_session = 0;
+
+#ifdef _WIN32
+	if (source == STANDARD_INPUT)
+	{
+		// Consoles are not binary streams, hence only redirected files and pipes are read
+		_handle = GetStdHandle(STD_INPUT_HANDLE);
+		if (_handle == INVALID_HANDLE_VALUE || _handle == nullptr || GetFileType(_handle) == FILE_TYPE_CHAR) return false;
+	}
+	else if (source == NAMED_PIPE)
+	{
+		// Non-blocking pipes let connections and reads be polled within the timeout
+		_pipeName = pipeName.rfind("\\\\.\\pipe\\", 0) == 0 ? pipeName : "\\\\.\\pipe\\" + pipeName;
+		_handle = CreateNamedPipeA(_pipeName.c_str(), PIPE_ACCESS_INBOUND, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_NOWAIT, 1, 0, 1 << 20, 0, nullptr);
+		if (_handle == INVALID_HANDLE_VALUE) return false;
+	}
+	else
+	{
+		WSADATA wsaData;
+		if (WSAStartup(MAKEWORD(2, 2), &wsaData)) return false;
+
+		_open = true;
+		_listenSocket = uintptr_t(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+	}
+#else
+	if (source == STANDARD_INPUT)
+	{
+		_fileDescriptor = STDIN_FILENO;
+	}
+	else if (source == NAMED_PIPE)
+	{
+		// Non-blocking opens do not wait for a writer, which may connect at any time afterwards
+		_pipeName = pipeName;
+		if (mkfifo(_pipeName.c_str(), 0600) && errno != EEXIST) return false;
+
+		_fileDescriptor = ::open(_pipeName.c_str(), O_RDONLY | O_NONBLOCK);
+		if (_fileDescriptor < 0) return false;
+	}
+	else
+	{
+		_listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	}
+#endif
+
+	if (source == TCP_SOCKET)
+	{
+		// Only local processes may connect, e.g., the driver of the scanner
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(port);
+
+		const int reuse = 1;
+		setsockopt(_listenSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+		if (_listenSocket == CLOSED_SOCKET || bind(_listenSocket, (const sockaddr*)&address, sizeof(address)) || listen(_listenSocket, 1))
+		{
+			this->close();
+			return false;
+		}
+	}
+
+	_open = true;
+
+	return true;
+}
+
+size_t InputChannel::read(void* data, size_t size, unsigned timeoutMilliseconds)
+{
+	if (!_open || _ended)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMilliseconds));
+		return 0;
+	}
+
+	return _source == TCP_SOCKET ? this->readSocket(data, size, timeoutMilliseconds) : this->readStream(data, size, timeoutMilliseconds);
+}
+
+/// [Protected methods]
+
+size_t InputChannel::readSocket(void* data, size_t size, unsigned timeoutMilliseconds)
+{
+	fd_set readable;
+	timeval timeout = { long(timeoutMilliseconds / 1000), long(timeoutMilliseconds % 1000 * 1000) };
+
+	// Either a new connection or the data of the current one is awaited, never both
+	const bool accepting = _clientSocket == CLOSED_SOCKET;
+	const auto waitedSocket = accepting ? _listenSocket : _clientSocket;
+
+	FD_ZERO(&readable);
+	FD_SET(waitedSocket, &readable);
+	if (select(int(waitedSocket + 1), &readable, nullptr, nullptr, &timeout) <= 0) return 0;
+
+	if (accepting)
+	{
+		_clientSocket = accept(_listenSocket, nullptr, nullptr);
+		return 0;
+	}
+
+	const auto numBytes = recv(_clientSocket, (char*)data, int(std::min(size, size_t(INT_MAX))), 0);
+	if (numBytes > 0) return size_t(numBytes);
+
+	// The writer left or the connection failed, so the next one is accepted
+#ifdef _WIN32
+	closesocket(SOCKET(_clientSocket));
+#else
+	::close(_clientSocket);
+#endif
+	_clientSocket = CLOSED_SOCKET;
+	++_session;
+
+	return 0;
+}
+
+size_t InputChannel::readStream(void* data, size_t size, unsigned timeoutMilliseconds)
+{
+#ifdef _WIN32
+	// Pipes cannot be waited on with a timeout, hence they are peeked until data arrives, whereas redirected files are read at once
+	const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+	const bool redirectedFile = _source == STANDARD_INPUT && GetFileType(_handle) != FILE_TYPE_PIPE;
+	DWORD available = 0, numBytes = 0;
+
+	while (!redirectedFile && !available)
+	{
+		if (!PeekNamedPipe(_handle, nullptr, 0, nullptr, &available, nullptr))
+		{
+			if (_source == STANDARD_INPUT)
+			{
+				_ended = true;
+				return 0;
+			}
+
+			// Non-blocking pipes report the state of their client, which must be disconnected once it left so that the next one can connect
+			if (!ConnectNamedPipe(_handle, nullptr) && GetLastError() == ERROR_NO_DATA)
+			{
+				DisconnectNamedPipe(_handle);
+				++_session;
+			}
+		}
+
+		if (!available && std::chrono::steady_clock::now() >= deadline) return 0;
+		if (!available) Sleep(1);
+	}
+
+	if (!ReadFile(_handle, data, DWORD(std::min(size, size_t(UINT32_MAX))), &numBytes, nullptr) || !numBytes)
+	{
+		if (_source == STANDARD_INPUT) _ended = true;
+		return 0;
+	}
+
+	return size_t(numBytes);
+#else
+	pollfd descriptor = { _fileDescriptor, POLLIN, 0 };
+	if (poll(&descriptor, 1, int(timeoutMilliseconds)) <= 0) return 0;
+
+	const ssize_t numBytes = ::read(_fileDescriptor, data, size);
+	if (numBytes > 0) return size_t(numBytes);
+	if (numBytes < 0 && (errno == EAGAIN || errno == EINTR)) return 0;
+
+	if (_source == STANDARD_INPUT)
+	{
+		_ended = true;
+		return 0;
+	}
+
+	// Every writer of the pipe left; it is opened again, as otherwise poll would keep reporting the hang-up
+	::close(_fileDescriptor);
+	_fileDescriptor = ::open(_pipeName.c_str(), O_RDONLY | O_NONBLOCK);
+	if (_fileDescriptor < 0) _open = false;
+
+	++_session;
+	std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMilliseconds));
+
+	return 0;
+#endif
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "stdafx.h"
+
+/**
+*	@file InputChannel.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Local byte stream written by another process, which is either the standard input, a named pipe or a TCP connection to the loopback
+*	interface. Reads wait a bounded time, so that the reading thread can be stopped, and writers may come and go: pipes are opened again and
+*	connections are accepted again once the previous writer leaves.
+*/
+class InputChannel
+{
+public:
+	enum Source : int
+	{
+		STANDARD_INPUT, NAMED_PIPE, TCP_SOCKET
+	};
+
+protected:
+	bool				_ended;										//!< The standard input was closed, hence nothing else will arrive
+	std::string			_pipeName;									//!< Path of the named pipe
+	unsigned			_session;									//!< Number of writers which left since the channel was opened
+	Source				_source;									//!< Kind of stream
+	bool				_open;										//!< The channel is ready to be read
+
+#ifdef _WIN32
+	void*				_handle;									//!< Standard input or server end of the named pipe
+	uintptr_t			_clientSocket;								//!< Accepted connection, if any
+	uintptr_t			_listenSocket;								//!< Socket waiting for connections
+#else
+	int					_fileDescriptor;							//!< Standard input or named pipe
+	int					_clientSocket;								//!< Accepted connection, if any
+	int					_listenSocket;								//!< Socket waiting for connections
+#endif
+
+protected:
+	/**
+	*	@brief Reads from the accepted connection, accepting one first if there is none.
+	*/
+	size_t readSocket(void* data, size_t size, unsigned timeoutMilliseconds);
+
+	/**
+	*	@brief Reads from the standard input or the named pipe.
+	*/
+	size_t readStream(void* data, size_t size, unsigned timeoutMilliseconds);
+
+public:
+	/**
+	*	@brief Constructor.
+	*/
+	InputChannel();
+
+	/**
+	*	@brief Invalid copy constructor.
+	*/
+	InputChannel(const InputChannel& channel) = delete;
+
+	/**
+	*	@brief Destructor. Closes the channel, if open.
+	*/
+	virtual ~InputChannel();
+
+	/**
+	*	@brief Releases the pipe and sockets. The standard input is left open.
+	*/
+	void close();
+
+	/**
+	*	@return Number of writers which left since the channel was opened. A change means that any partial message of the previous writer is lost.
+	*/
+	unsigned getSession() const { return _session; }
+
+	/**
+	*	@return True if the standard input was closed, after which the channel never receives data again.
+	*/
+	bool isEnded() const { return _ended; }
+
+	/**
+	*	@return True if the channel is ready to be read.
+	*/
+	bool isOpen() const { return _open; }
+
+	/**
+	*	@brief Opens a channel, closing the previous one.
+	*	@param pipeName Path of the named pipe, which is created if it does not exist. Windows pipes are placed under \\.\pipe\ unless the name already is.
+	*	@param port Port of the loopback interface where connections are accepted.
+	*	@return True if the channel could be opened.
+	*/
+	bool open(Source source, const std::string& pipeName, uint16_t port);
+
+	/**
+	*	@brief Reads whatever is available, up to the given number of bytes.
+	*	@param timeoutMilliseconds Maximum time waiting for the first byte.
+	*	@return Number of bytes read, zero if nothing arrived in time or the writer left.
+	*/
+	size_t read(void* data, size_t size, unsigned timeoutMilliseconds);
+};
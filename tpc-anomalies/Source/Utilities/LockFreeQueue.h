@@ -0,0 +1,74 @@
+#pragma once
+
+#include "stdafx.h"
+
+/**
+*	@file LockFreeQueue.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Bounded queue shared by a single producer thread and a single consumer thread, which never wait for each other. Each index is only
+*	written by one side, so that a push or a pop costs one acquire load and one release store.
+*/
+template<typename T>
+class LockFreeQueue
+{
+protected:
+	std::vector<T>				_buffer;							//!< Ring of slots, one of which is always left empty to tell a full queue from an empty one
+	alignas(64) std::atomic<size_t>	_head;							//!< Next slot to be popped, only written by the consumer
+	alignas(64) std::atomic<size_t>	_tail;							//!< Next slot to be pushed, only written by the producer
+
+public:
+	/**
+	*	@brief Constructor.
+	*	@param capacity Maximum number of queued elements.
+	*/
+	LockFreeQueue(size_t capacity) : _buffer(capacity + 1), _head(0), _tail(0) {}
+
+	/**
+	*	@brief Invalid copy constructor.
+	*/
+	LockFreeQueue(const LockFreeQueue& queue) = delete;
+
+	/**
+	*	@return Maximum number of queued elements.
+	*/
+	size_t capacity() const { return _buffer.size() - 1; }
+
+	/**
+	*	@return True if nothing is queued. Only reliable from the consumer thread.
+	*/
+	bool empty() const { return _head.load(std::memory_order_relaxed) == _tail.load(std::memory_order_acquire); }
+
+	/**
+	*	@brief Removes the oldest element. Must only be called from the consumer thread.
+	*	@return False if the queue was empty.
+	*/
+	bool pop(T& value)
+	{
+		const size_t head = _head.load(std::memory_order_relaxed);
+		if (head == _tail.load(std::memory_order_acquire)) return false;
+
+		value = std::move(_buffer[head]);
+		_head.store((head + 1) % _buffer.size(), std::memory_order_release);
+
+		return true;
+	}
+
+	/**
+	*	@brief Appends an element. Must only be called from the producer thread.
+	*	@return False if the queue was full, in which case the element is not queued.
+	*/
+	bool push(const T& value)
+	{
+		const size_t tail = _tail.load(std::memory_order_relaxed), next = (tail + 1) % _buffer.size();
+		if (next == _head.load(std::memory_order_acquire)) return false;
+
+		_buffer[tail] = value;
+		_tail.store(next, std::memory_order_release);
+
+		return true;
+	}
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "stdafx.h"
+
+/**
+*	@file MappedFile.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Read-only view of a whole file mapped into memory. Pages are loaded by the system as they are touched,
+*	so large files can be decoded in place by several threads without reading them into a buffer first.
+*/
+class MappedFile
+{
+protected:
+	const uint8_t*		_data;										//!< First byte of the mapped view
+	size_t				_size;										//!< Length of the file in bytes
+
+#ifdef _WIN32
+	void*				_fileHandle;								//!< Handle of the open file
+	void*				_mappingHandle;								//!< Handle of the file mapping
+#else
+	int					_fileDescriptor;							//!< Descriptor of the open file
+#endif
+
+public:
+	/**
+	*	@brief Constructor.
+	*/
+	MappedFile();
+
+	/**
+	*	@brief Invalid copy constructor.
+	*/
+	MappedFile(const MappedFile& file) = delete;
+
+	/**
+	*	@brief Destructor. Unmaps the file, if open.
+	*/
+	virtual ~MappedFile();
+
+	/**
+	*	@brief Unmaps the file, if open.
+	*/
+	void close();
+
+	/**
+	*	@return First byte of the file, or nullptr if it is not open.
+	*/
+	const uint8_t* data() const { return _data; }
+
+	/**
+	*	@return True if a file is mapped.
+	*/
+	bool isOpen() const { return _data != nullptr; }
+
+	/**
+	*	@brief Maps a whole file, closing the previous one. Empty files cannot be mapped.
+	*	@return True if the file could be mapped.
+	*/
+	bool open(const std::string& filename);
+
+	/**
+	*	@return Length of the file in bytes.
+	*/
+	size_t size() const { return _size; }
+};
+
@@ -0,0 +1,83 @@
+#include "stdafx.h"
+#include "TaskProgress.h"
+
+// Initialization of static attributes
+const unsigned TaskProgress::REPORT_STEPS = 10;
+
+/// [Public methods]
+
+TaskProgress::TaskProgress(bool verbose) :
+	_cancelled(false), _completed(0), _stageStart(std::chrono::steady_clock::now()), _total(0), _verbose(verbose)
+{
+}
+
+void TaskProgress::advance(size_t amount)
+{
+	this->checkpoint();
+
+	const size_t previous = _completed.fetch_add(amount), total = _total;
+
+	// Only the thread which crosses a report step writes it, so reports are not repeated
+	if (_verbose && total && previous < total && (previous * REPORT_STEPS / total) != (std::min(total, previous + amount) * REPORT_STEPS / total))
+	{
+		this->report(false);
+	}
+}
+
+void TaskProgress::beginStage(const std::string& stage, size_t total, const std::string& unit)
+{
+	this->checkpoint();
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_stage = stage;
+	_unit = unit;
+	_completed = 0;
+	_total = total;
+	_stageStart = std::chrono::steady_clock::now();
+}
+
+void TaskProgress::endStage()
+{
+	if (_verbose) this->report(true);
+}
+
+TaskProgress::Snapshot TaskProgress::getSnapshot()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	return Snapshot{ _stage, _unit, _completed, _total, std::chrono::duration<float>(std::chrono::steady_clock::now() - _stageStart).count(), _cancelled };
+}
+
+std::string TaskProgress::formatRate(float rate, const std::string& unit)
+{
+	const char* prefixes[] = { "", " K", " M", " G" };
+	unsigned prefixIdx = 0;
+
+	while (rate >= 1000.0f && prefixIdx < 3)
+	{
+		rate /= 1000.0f;
+		++prefixIdx;
+	}
+
+	std::ostringstream stream;
+	stream << std::fixed << std::setprecision(1) << rate << prefixes[prefixIdx] << " " << unit << "/s";
+
+	return stream.str();
+}
+
+/// [Protected methods]
+
+void TaskProgress::report(bool finished)
+{
+	const Snapshot snapshot = this->getSnapshot();
+	std::ostringstream stream;
+
+	if (finished)
+		stream << snapshot._stage << ": " << snapshot._completed << " " << snapshot._unit << " in " << std::fixed << std::setprecision(2) << snapshot._seconds << " s";
+	else
+		stream << snapshot._stage << ": " << unsigned(snapshot.getFraction() * 100.0f + .5f) << "%";
+
+	// A single insertion keeps lines from different threads apart
+	stream << " (" << TaskProgress::formatRate(snapshot.getRate(), snapshot._unit) << ")\n";
+	std::cout << stream.str();
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "stdafx.h"
+
+/**
+*	@file TaskProgress.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Thrown from progress checkpoints once a task has been cancelled.
+*/
+class TaskCancelled: public std::runtime_error
+{
+public:
+	/**
+	*	@brief Constructor.
+	*/
+	TaskCancelled() : std::runtime_error("Task cancelled") {}
+};
+
+/**
+*	@brief Cooperative cancellation token and progress channel of a long operation split in stages.
+*	Progress can be advanced from several threads at once, and every advance is also a cancellation point.
+*/
+class TaskProgress
+{
+public:
+	/**
+	*	@brief Copy of the current stage state, safe to read from another thread.
+	*/
+	struct Snapshot
+	{
+		std::string		_stage;									//!< Name of the current stage
+		std::string		_unit;									//!< Name of the processed items
+		size_t			_completed;								//!< Items processed so far
+		size_t			_total;									//!< Items of the stage, zero if unknown
+		float			_seconds;								//!< Time since the stage began
+		bool			_cancelled;								//!< Cancellation was requested
+
+		/**
+		*	@return Completed fraction of the stage, or zero if the total is unknown.
+		*/
+		float getFraction() const { return _total ? float(_completed) / _total : .0f; }
+
+		/**
+		*	@return Processed items per second.
+		*/
+		float getRate() const { return _seconds > .0f ? _completed / _seconds : .0f; }
+	};
+
+protected:
+	const static unsigned REPORT_STEPS;							//!< Number of console reports during a stage
+
+protected:
+	std::atomic<bool>						_cancelled;			//!< Cancellation was requested
+	std::atomic<size_t>						_completed;			//!< Items processed in the current stage
+	std::mutex								_mutex;				//!< Protects stage description
+	std::string								_stage;				//!< Name of the current stage
+	std::chrono::steady_clock::time_point	_stageStart;		//!< Time when the current stage began
+	std::atomic<size_t>						_total;				//!< Items of the current stage
+	std::string								_unit;				//!< Name of processed items
+	bool									_verbose;			//!< Stages are reported in the console
+
+protected:
+	/**
+	*	@brief Writes the state of the current stage in the console.
+	*/
+	void report(bool finished);
+
+public:
+	/**
+	*	@brief Constructor.
+	*	@param verbose Stage progress and throughput are written in the console.
+	*/
+	TaskProgress(bool verbose = true);
+
+	/**
+	*	@brief Adds processed items to the current stage.
+	*	@throw TaskCancelled If the task was cancelled.
+	*/
+	void advance(size_t amount);
+
+	/**
+	*	@brief Starts a new stage. The total can be zero if it is unknown.
+	*	@throw TaskCancelled If the task was cancelled.
+	*/
+	void beginStage(const std::string& stage, size_t total, const std::string& unit);
+
+	/**
+	*	@brief Requests the task to stop at its next checkpoint.
+	*/
+	void cancel() { _cancelled = true; }
+
+	/**
+	*	@throw TaskCancelled If the task was cancelled.
+	*/
+	void checkpoint() const { if (_cancelled) throw TaskCancelled(); }
+
+	/**
+	*	@brief Finishes the current stage, reporting its throughput.
+	*/
+	void endStage();
+
+	/**
+	*	@return Copy of the current stage state.
+	*/
+	Snapshot getSnapshot();
+
+	/**
+	*	@return True if cancellation was requested.
+	*/
+	bool isCancelled() const { return _cancelled; }
+
+	/**
+	*	@return Human-readable rate, e.g. 12.5 M points/s.
+	*/
+	static std::string formatRate(float rate, const std::string& unit);
+};
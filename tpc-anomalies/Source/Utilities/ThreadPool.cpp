@@ -0,0 +1,122 @@
+#include "stdafx.h"
+#include "ThreadPool.h"
+
+/// [Public methods]
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+
+	_condition.notify_all();
+
+	for (std::thread& worker: _workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::enqueue(const std::function<void()>& job)
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_jobs.push(job);
+	}
+
+	_condition.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t numTasks, const std::function<void(size_t)>& task)
+{
+	if (numTasks == 0) return;
+
+	if (numTasks == 1 || _workers.empty())
+	{
+		for (size_t taskIdx = 0; taskIdx < numTasks; ++taskIdx) task(taskIdx);
+		return;
+	}
+
+	std::shared_ptr<ParallelTask> parallelTask = std::make_shared<ParallelTask>();
+	parallelTask->_task = task;
+	parallelTask->_numTasks = numTasks;
+	parallelTask->_nextTask = 0;
+	parallelTask->_completedTasks = 0;
+	parallelTask->_failed = false;
+
+	// Helpers that start late find no task left and return, so nested launches from a worker cannot deadlock
+	const size_t numHelpers = std::min(numTasks - 1, _workers.size());
+	for (size_t helperIdx = 0; helperIdx < numHelpers; ++helperIdx)
+	{
+		this->enqueue([parallelTask]() { ThreadPool::runTasks(parallelTask); });
+	}
+
+	ThreadPool::runTasks(parallelTask);
+
+	std::unique_lock<std::mutex> lock(parallelTask->_mutex);
+	parallelTask->_completed.wait(lock, [&]() { return parallelTask->_completedTasks.load() == parallelTask->_numTasks; });
+
+	if (parallelTask->_exception) std::rethrow_exception(parallelTask->_exception);
+}
+
+/// [Protected methods]
+
+ThreadPool::ThreadPool() : _stop(false)
+{
+	const unsigned numThreads = std::max(2u, std::thread::hardware_concurrency());
+
+	for (unsigned threadIdx = 0; threadIdx < numThreads - 1; ++threadIdx)
+	{
+		_workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+void ThreadPool::runTasks(const std::shared_ptr<ParallelTask>& parallelTask)
+{
+	size_t taskIdx;
+
+	while ((taskIdx = parallelTask->_nextTask.fetch_add(1)) < parallelTask->_numTasks)
+	{
+		// Once a task fails, e.g. because it was cancelled, the remaining indices are only counted
+		if (!parallelTask->_failed)
+		{
+			try
+			{
+				parallelTask->_task(taskIdx);
+			}
+			catch (...)
+			{
+				std::unique_lock<std::mutex> lock(parallelTask->_mutex);
+				if (!parallelTask->_exception) parallelTask->_exception = std::current_exception();
+				parallelTask->_failed = true;
+			}
+		}
+
+		if (parallelTask->_completedTasks.fetch_add(1) + 1 == parallelTask->_numTasks)
+		{
+			std::unique_lock<std::mutex> lock(parallelTask->_mutex);
+			parallelTask->_completed.notify_all();
+		}
+	}
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this]() { return _stop || !_jobs.empty(); });
+
+			if (_stop && _jobs.empty()) return;
+
+			job = std::move(_jobs.front());
+			_jobs.pop();
+		}
+
+		job();
+	}
+}
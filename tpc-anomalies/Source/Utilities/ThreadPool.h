@@ -0,0 +1,96 @@
+#pragma once
+
+#include "stdafx.h"
+#include "Utilities/Singleton.h"
+
+/**
+*	@file ThreadPool.h
+*	@authors Alfonso Lpez Ruiz (alr00048@red.ujaen.es)
+*	@date 19/10/2026
+*/
+
+/**
+*	@brief Shared pool of worker threads for CPU passes over grids and point clouds.
+*/
+class ThreadPool: public Singleton<ThreadPool>
+{
+	friend class Singleton<ThreadPool>;
+
+protected:
+	/**
+	*	@brief Shared state of a single parallel-for launch.
+	*/
+	struct ParallelTask
+	{
+		std::function<void(size_t)>	_task;								//!< Work to be done for each task index
+		size_t						_numTasks;							//!< Number of task indices
+		std::atomic<size_t>			_nextTask;							//!< Next task index to be claimed
+		std::atomic<size_t>			_completedTasks;					//!< Number of finished task indices
+		std::exception_ptr			_exception;							//!< First exception thrown by a task, rethrown in the calling thread
+		std::atomic<bool>			_failed;							//!< A task threw, hence remaining indices are skipped
+		std::mutex					_mutex;								//!< Protects the completion signal and the exception
+		std::condition_variable		_completed;							//!< Signaled once every task index has been processed
+	};
+
+protected:
+	std::queue<std::function<void()>>	_jobs;							//!< Pending jobs
+	std::mutex							_mutex;							//!< Protects the job queue
+	std::condition_variable				_condition;						//!< Wakes workers up when jobs are queued
+	bool								_stop;							//!< Marks the pool as being destroyed
+	std::vector<std::thread>			_workers;						//!< Worker threads
+
+protected:
+	/**
+	*	@brief Constructor. Launches as many workers as hardware threads minus the calling one.
+	*/
+	ThreadPool();
+
+	/**
+	*	@brief Claims and runs task indices until none is left.
+	*/
+	static void runTasks(const std::shared_ptr<ParallelTask>& parallelTask);
+
+	/**
+	*	@brief Loop of each worker thread.
+	*/
+	void workerLoop();
+
+public:
+	/**
+	*	@brief Destructor. Waits for the queued jobs to finish.
+	*/
+	virtual ~ThreadPool();
+
+	/**
+	*	@brief Queues a job to be run by any worker.
+	*/
+	void enqueue(const std::function<void()>& job);
+
+	/**
+	*	@return Number of threads (workers + calling thread) that take part in a parallel-for.
+	*/
+	unsigned getNumThreads() const { return unsigned(_workers.size()) + 1; }
+
+	/**
+	*	@brief Runs task(i) for every i in [0, numTasks). The calling thread takes part and returns once all of them are finished, rethrowing the first exception of any task.
+	*/
+	void parallelFor(size_t numTasks, const std::function<void(size_t)>& task);
+
+	/**
+	*	@brief Runs map(i) for every i in [0, numTasks) and folds the results in task order through combine(accumulated, partial).
+	*/
+	template<typename T, typename Map, typename Combine>
+	T parallelReduce(size_t numTasks, const T& identity, Map map, Combine combine);
+};
+
+template<typename T, typename Map, typename Combine>
+inline T ThreadPool::parallelReduce(size_t numTasks, const T& identity, Map map, Combine combine)
+{
+	std::vector<T> partialResult(numTasks, identity);
+	this->parallelFor(numTasks, [&](size_t taskIdx) { partialResult[taskIdx] = map(taskIdx); });
+
+	T result = identity;
+	for (T& partial: partialResult) combine(result, partial);
+
+	return result;
+}